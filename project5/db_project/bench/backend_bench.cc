@@ -0,0 +1,55 @@
+#include "bench_util.h"
+#include <iostream>
+
+//throughput of tree operations on each storage backend
+//memory backend removes disk I/O, so it shows CPU cost of tree and buffer manager
+//buffer pool is small so that pages are evicted and read again
+//usage: backend_bench [num_keys] [num_queries] [num_buf]
+int main(int argc, char** argv){
+    const int num_keys = argc > 1 ? atoi(argv[1]) : 200000;
+    const int num_queries = argc > 2 ? atoi(argv[2]) : 200000;
+    const int num_buf = argc > 3 ? atoi(argv[3]) : 256;
+    const char* path = "./backend_bench.db";
+
+    printf("%-8s %12s %12s %12s\n", "backend", "insert/s", "find/s", "scan rec/s");
+    for(const storage_backend_t* backend : {storage_get_posix_backend(), storage_get_memory_backend()}){
+        file_set_storage_backend(backend);
+        file_remove_table_file(path);
+
+        //load phase
+        init_db(num_buf);
+        double begin = BENCH::now();
+        int64_t tid = BENCH::load_table(path, num_keys);
+        double insert_elapsed = BENCH::now() - begin;
+        shutdown_db();
+
+        //random point lookups
+        init_db(num_buf);
+        tid = open_table(const_cast<char*>(path));
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<int64_t> key_dis(0, num_keys - 1);
+        char val[MAX_VALUE_SIZE];
+        uint16_t val_size;
+        begin = BENCH::now();
+        for(int i = 0; i < num_queries; i++){
+            db_find(tid, key_dis(gen), val, &val_size);
+        }
+        double find_elapsed = BENCH::now() - begin;
+
+        //full range scan
+        uint64_t checksum = 0;
+        auto sum = [](int64_t key, const char* value, uint16_t val_size, void* arg){
+            *reinterpret_cast<uint64_t*>(arg) += key + val_size;
+        };
+        begin = BENCH::now();
+        int scanned = db_scan(tid, 0, num_keys - 1, sum, &checksum);
+        double scan_elapsed = BENCH::now() - begin;
+        shutdown_db();
+
+        printf("%-8s %12.0f %12.0f %12.0f\n", backend->name,
+            num_keys / insert_elapsed, num_queries / find_elapsed, scanned / scan_elapsed);
+        file_remove_table_file(path);
+    }
+    file_set_storage_backend(nullptr);
+    return 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "api.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+//common helpers shared by benchmark programs
+namespace BENCH{
+    //monotonic wall clock in seconds
+    inline double now(){
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    //resident set size of this process in KiB (VmRSS in /proc/self/status)
+    inline long rss_kib(){
+        FILE* fp = fopen("/proc/self/status", "r");
+        if(!fp) return -1;
+        char line[256];
+        long ret = -1;
+        while(fgets(line, sizeof(line), fp)){
+            if(!strncmp(line, "VmRSS:", 6)){
+                ret = atol(line + 6);
+                break;
+            }
+        }
+        fclose(fp);
+        return ret;
+    }
+
+    //amount of given file resident in kernel page cache in KiB
+    inline long file_cached_kib(const char* path){
+        int fd = open(path, O_RDONLY);
+        if(fd == -1) return -1;
+        struct stat st;
+        fstat(fd, &st);
+        void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if(addr == MAP_FAILED) return -1;
+
+        size_t sys_page = sysconf(_SC_PAGESIZE);
+        std::vector<unsigned char> vec((st.st_size + sys_page - 1) / sys_page);
+        mincore(addr, st.st_size, vec.data());
+        munmap(addr, st.st_size);
+
+        long cnt = 0;
+        for(unsigned char c : vec) cnt += c & 1;
+        return cnt * (long)(sys_page / 1024);
+    }
+
+    //drop given file's pages from kernel page cache
+    inline void drop_file_cache(const char* path){
+        int fd = open(path, O_RDONLY);
+        if(fd == -1) return;
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+
+    //p-th percentile (0 <= p <= 1) of samples (sorts samples)
+    inline double percentile(std::vector<double>& samples, double p){
+        if(samples.empty()) return 0;
+        std::sort(samples.begin(), samples.end());
+        size_t idx = std::min(samples.size() - 1, (size_t)(p * samples.size()));
+        return samples[idx];
+    }
+
+    //make random value of given size
+    inline std::string make_value(std::mt19937& gen, int size){
+        std::string ret(size, 'A');
+        for(char& c : ret) c = 'A' + gen() % 26;
+        return ret;
+    }
+
+    //create table file in given path and insert keys [0, num_keys) in random order
+    //return table id
+    inline int64_t load_table(const char* path, int num_keys, int flag = FILE_DEFAULT_FLAG, uint32_t seed = 1234){
+        std::mt19937 gen(seed);
+        std::vector<int64_t> keys(num_keys);
+        for(int i = 0; i < num_keys; i++) keys[i] = i;
+        std::shuffle(keys.begin(), keys.end(), gen);
+
+        int64_t tid = open_table(const_cast<char*>(path), flag);
+        for(int64_t key : keys){
+            std::string val = make_value(gen, MIN_VALUE_SIZE + gen() % (MAX_VALUE_SIZE - MIN_VALUE_SIZE));
+            db_insert(tid, key, const_cast<char*>(val.c_str()), val.size());
+        }
+        return tid;
+    }
+}
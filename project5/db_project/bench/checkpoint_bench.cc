@@ -0,0 +1,59 @@
+#include "bench_util.h"
+#include <iostream>
+
+//checkpoint (db_flush_all) of a large buffer full of dirty pages of several tables
+//table files live in memory backend and the latency backend adds write delay per request,
+//so time shows the number of write requests and how many run in parallel
+//first checkpoint follows bulk load (every page dirty), later ones follow random deletes
+//report dirty pages, write requests, pages per request and time
+//(serial time is what one write per page in frame order would take)
+//usage: checkpoint_bench [num_tables] [num_keys] [write_us]
+int main(int argc, char** argv){
+    const int num_tables = argc > 1 ? atoi(argv[1]) : 4;
+    const int num_keys = argc > 2 ? atoi(argv[2]) : 50000;
+    const uint32_t write_us = argc > 3 ? atoi(argv[3]) : 50;
+    const int num_buf = 32768;
+
+    storage_latency_config_t config = {{0, 0}, {write_us, 0}, 0, 0, 1};
+    file_set_storage_backend(storage_get_latency_backend(storage_get_memory_backend(), &config));
+    init_db(num_buf);
+    std::vector<std::string> paths;
+    std::vector<int64_t> tids;
+    for(int t = 0; t < num_tables; t++){
+        paths.push_back("./checkpoint_bench_" + std::to_string(t) + ".db");
+        file_remove_table_file(paths.back().c_str());
+        tids.push_back(BENCH::load_table(paths.back().c_str(), num_keys, FILE_CHECKPOINT_SYNC_FLAG, t));
+    }
+
+    printf("%-12s %10s %10s %12s %10s %12s\n", "after", "dirty", "writes", "pages/write", "time(ms)", "serial(ms)");
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int64_t> key_dis(0, num_keys - 1);
+    for(int round = 0; round < 3; round++){
+        if(round){
+            //random changes of every table
+            for(int64_t tid : tids){
+                for(int i = 0; i < num_keys / 20; i++) db_delete(tid, key_dis(gen));
+            }
+        }
+
+        db_stats_t before, after;
+        storage_latency_stats_t io_before, io_after;
+        db_get_stats(&before);
+        storage_get_latency_stats(&io_before);
+        double begin = BENCH::now();
+        db_flush_all();
+        double elapsed = BENCH::now() - begin;
+        db_get_stats(&after);
+        storage_get_latency_stats(&io_after);
+
+        uint64_t dirty = after.total.dirty_flushes - before.total.dirty_flushes;
+        uint64_t writes = io_after.number_of_writes - io_before.number_of_writes;
+        printf("%-12s %10lu %10lu %12.1f %10.1f %12.1f\n", round ? "deletes" : "load", dirty, writes,
+            (double)dirty / std::max<uint64_t>(writes, 1), elapsed * 1e3, dirty * write_us / 1e3);
+    }
+
+    shutdown_db();
+    for(const std::string& path : paths) file_remove_table_file(path.c_str());
+    file_set_storage_backend(nullptr);
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "bench_util.h"
+#include <iostream>
+
+//same memory given to buffer only or split into buffer and compressed cache
+//random point lookups on a table larger than memory
+//table lives in memory backend and the latency backend adds SSD-like read delay
+//values are random letters (compress poorly) or words from small vocabulary (compress well)
+//report lookup throughput, file reads and misses served from compressed cache
+//usage: compressed_cache_bench [mem_frames] [num_keys] [num_queries] [read_us]
+int main(int argc, char** argv){
+    const int mem_frames = argc > 1 ? atoi(argv[1]) : 1024;
+    const int num_keys = argc > 2 ? atoi(argv[2]) : 100000;
+    const int num_queries = argc > 3 ? atoi(argv[3]) : 200000;
+    const uint32_t read_us = argc > 4 ? atoi(argv[4]) : 80;
+    const char* path = "./compressed_cache_bench.db";
+    const char* words[] = {"order", "customer", "status", "shipped", "pending", "amount", "district",
+        "warehouse", "item", "price", "quantity", "delivery", "payment", "credit", "balance", "history"};
+
+    storage_latency_config_t config = {{read_us, read_us / 4}, {0, 0}, 0, 0, 1};
+    printf("%-8s %-8s %8s %12s %12s %12s %12s %14s\n", "values", "mode", "frames", "cache(KiB)", "lookup/s",
+        "file reads", "comp hits", "cached pages");
+    for(const char* value_kind : {"letters", "words"}){
+        //load into memory backend without delay
+        file_set_storage_backend(storage_get_memory_backend());
+        file_remove_table_file(path);
+        init_db(mem_frames);
+        int64_t tid = open_table(const_cast<char*>(path));
+        std::mt19937 gen(1234);
+        for(int i = 0; i < num_keys; i++){
+            int size = MIN_VALUE_SIZE + gen() % (MAX_VALUE_SIZE - MIN_VALUE_SIZE);
+            std::string val;
+            if(!strcmp(value_kind, "letters")) val = BENCH::make_value(gen, size);
+            else while((int)val.size() < size) val += std::string(words[gen() % 16]) + " ";
+            val.resize(size);
+            db_insert(tid, (int64_t)i * 7919 % num_keys, const_cast<char*>(val.c_str()), val.size());
+        }
+        shutdown_db();
+
+        file_set_storage_backend(storage_get_latency_backend(storage_get_memory_backend(), &config));
+        for(int buffer_percent : {100, 50, 25}){
+            const int num_buf = mem_frames * buffer_percent / 100;
+            const uint64_t cache_bytes = (uint64_t)(mem_frames - num_buf) * PAGE_SIZE;
+            init_db(num_buf);
+            buffer_set_readahead_pages(0);
+            db_set_compressed_cache_size(cache_bytes);
+            tid = open_table(const_cast<char*>(path));
+
+            std::uniform_int_distribution<int64_t> key_dis(0, num_keys - 1);
+            char val[MAX_VALUE_SIZE];
+            uint16_t val_size;
+
+            //warm up memory, then measure
+            for(int i = 0; i < num_queries / 4; i++) db_find(tid, key_dis(gen), val, &val_size);
+            io_stats_t before, after;
+            db_get_table_stats(tid, &before);
+            double begin = BENCH::now();
+            for(int i = 0; i < num_queries; i++) db_find(tid, key_dis(gen), val, &val_size);
+            double elapsed = BENCH::now() - begin;
+            db_get_table_stats(tid, &after);
+
+            size_t cached_pages, bytes;
+            buffer_get_compressed_cache_usage(&cached_pages, &bytes);
+            printf("%-8s %-8s %8d %12lu %12.0f %12lu %12lu %14lu\n", value_kind, cache_bytes ? "tiered" : "buffer",
+                num_buf, cache_bytes / 1024, num_queries / elapsed, after.reads - before.reads,
+                after.compressed_hits - before.compressed_hits, cached_pages);
+            shutdown_db();
+        }
+    }
+
+    file_remove_table_file(path);
+    file_set_storage_backend(nullptr);
+    return 0;
+}
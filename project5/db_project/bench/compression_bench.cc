@@ -0,0 +1,56 @@
+#include "bench_util.h"
+#include <iostream>
+
+//compare raw page file and compressed table file
+//on loading and random point lookups with small buffer
+//report bytes on disk, physical I/O bytes and codec CPU time
+//usage: compression_bench [num_keys] [num_queries] [num_buf]
+int main(int argc, char** argv){
+    const int num_keys = argc > 1 ? atoi(argv[1]) : 100000;
+    const int num_queries = argc > 2 ? atoi(argv[2]) : 200000;
+    const int num_buf = argc > 3 ? atoi(argv[3]) : 256;
+    const char* path = "./compression_bench.db";
+
+    printf("%-6s %10s %12s %12s %12s %12s %12s %12s\n", "mode", "load(s)", "lookup/s",
+        "file(KiB)", "written(KiB)", "read(KiB)", "comp(ms)", "decomp(ms)");
+    for(int flag : {FILE_DEFAULT_FLAG, FILE_COMPRESSION_FLAG}){
+        remove(path);
+        init_db(num_buf);
+        double begin = BENCH::now();
+        //text-like values (random letters compress about half)
+        int64_t tid = BENCH::load_table(path, num_keys, flag | FILE_CHECKPOINT_SYNC_FLAG);
+        db_flush_all();
+        double load_elapsed = BENCH::now() - begin;
+        file_compression_stats_t load_stats = {};
+        file_get_compression_stats(tid, &load_stats);
+        shutdown_db();
+
+        BENCH::drop_file_cache(path);
+        init_db(num_buf);
+        tid = open_table(const_cast<char*>(path), FILE_CHECKPOINT_SYNC_FLAG);
+
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<int64_t> key_dis(0, num_keys - 1);
+        char val[MAX_VALUE_SIZE];
+        uint16_t val_size;
+        begin = BENCH::now();
+        for(int i = 0; i < num_queries; i++){
+            db_find(tid, key_dis(gen), val, &val_size);
+        }
+        double lookup_elapsed = BENCH::now() - begin;
+
+        file_compression_stats_t stats = {};
+        struct stat st;
+        stat(path, &st);
+        bool is_compressed = !file_get_compression_stats(tid, &stats);
+        shutdown_db();
+
+        printf("%-6s %10.3f %12.0f %12ld %12lu %12lu %12.1f %12.1f\n", is_compressed ? "lz" : "raw",
+            load_elapsed, num_queries / lookup_elapsed, (long)st.st_size / 1024,
+            load_stats.physical_write_bytes / 1024, stats.physical_read_bytes / 1024,
+            load_stats.compress_ns / 1e6, stats.decompress_ns / 1e6);
+    }
+
+    remove(path);
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "bench_util.h"
+#include <iostream>
+#include <thread>
+
+//buffer manager microbenchmarks
+//hit: threads read random pages that are all cached (page latch and hash table cost)
+//victim: most LRU-side frames are pinned, so every miss scans past them to find a victim
+//usage: ctrl_blk_bench [num_buf] [num_ops] [max_threads]
+int main(int argc, char** argv){
+    const int num_buf = argc > 1 ? atoi(argv[1]) : 4096;
+    const int num_ops = argc > 2 ? atoi(argv[2]) : 1000000;
+    const int max_threads = argc > 3 ? atoi(argv[3]) : 4;
+    const char* path = "./ctrl_blk_bench.db";
+
+    //table larger than buffer
+    remove(path);
+    init_db(num_buf);
+    int64_t tid = BENCH::load_table(path, num_buf * 60);
+    const uint64_t number_of_pages = file_get_number_of_pages(tid);
+    shutdown_db();
+
+    //hit path
+    printf("%-8s %8s %14s\n", "test", "threads", "ops/s");
+    init_db(num_buf);
+    buffer_set_readahead_pages(0);
+    tid = open_table(const_cast<char*>(path));
+    const uint64_t hot_pages = std::min<uint64_t>(num_buf / 2, number_of_pages - 1);
+    page_t page;
+    for(uint64_t p = 1; p <= hot_pages; p++) buffer_read_page(tid, p, &page, BUFFER_NO_LOCK_MODE);
+    for(int num_threads = 1; num_threads <= max_threads; num_threads *= 2){
+        std::vector<std::thread> threads;
+        double begin = BENCH::now();
+        for(int t = 0; t < num_threads; t++){
+            threads.emplace_back([&, t]{
+                std::mt19937 gen(t);
+                std::uniform_int_distribution<uint64_t> page_dis(1, hot_pages);
+                page_t page;
+                for(int i = 0; i < num_ops / num_threads; i++){
+                    buffer_read_page(tid, page_dis(gen), &page, BUFFER_NO_LOCK_MODE);
+                }
+            });
+        }
+        for(auto& th : threads) th.join();
+        printf("%-8s %8d %14.0f\n", "hit", num_threads, num_ops / (BENCH::now() - begin));
+    }
+    shutdown_db();
+
+    //victim search
+    //pin pages read first (they stay at LRU front), then miss on the rest
+    init_db(num_buf);
+    buffer_set_readahead_pages(0);
+    tid = open_table(const_cast<char*>(path));
+    const uint64_t pinned = num_buf - 16;
+    for(uint64_t p = 1; p <= pinned; p++) buffer_direct_read_page(tid, p);
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<uint64_t> page_dis(pinned + 1, number_of_pages - 1);
+    const int num_misses = std::max(num_ops / 100, 1);
+    double begin = BENCH::now();
+    for(int i = 0; i < num_misses; i++){
+        buffer_read_page(tid, page_dis(gen), &page, BUFFER_NO_LOCK_MODE);
+    }
+    printf("%-8s %8d %14.0f\n", "victim", 1, num_misses / (BENCH::now() - begin));
+    for(uint64_t p = 1; p <= pinned; p++) buffer_direct_write_page(tid, p, false);
+    shutdown_db();
+
+    remove(path);
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include "bench_util.h"
+#include <iostream>
+
+//compare buffered I/O and direct I/O(O_DIRECT) on random point lookups
+//report throughput, process RSS and table file pages held in kernel page cache
+//usage: direct_io_bench [num_keys] [num_queries]
+int main(int argc, char** argv){
+    const int num_keys = argc > 1 ? atoi(argv[1]) : 100000;
+    const int num_queries = argc > 2 ? atoi(argv[2]) : 200000;
+    const int buffer_sizes[] = {256, 1024, 4096, 16384};
+    const char* path = "./direct_io_bench.db";
+
+    //build data set once
+    remove(path);
+    init_db();
+    BENCH::load_table(path, num_keys);
+    shutdown_db();
+
+    printf("%-10s %-9s %12s %10s %14s\n", "buffer", "mode", "ops/s", "rss(KiB)", "pagecache(KiB)");
+    for(int num_buf : buffer_sizes){
+        for(int flag : {FILE_DEFAULT_FLAG, FILE_DIRECT_IO_FLAG}){
+            //start every run with cold kernel cache
+            BENCH::drop_file_cache(path);
+
+            init_db(num_buf);
+            int64_t tid = open_table(const_cast<char*>(path), flag);
+
+            std::mt19937 gen(42);
+            std::uniform_int_distribution<int64_t> key_dis(0, num_keys - 1);
+            char val[MAX_VALUE_SIZE];
+            uint16_t val_size;
+
+            double begin = BENCH::now();
+            for(int i = 0; i < num_queries; i++){
+                db_find(tid, key_dis(gen), val, &val_size);
+            }
+            double elapsed = BENCH::now() - begin;
+
+            long rss = BENCH::rss_kib();
+            long cached = BENCH::file_cached_kib(path);
+            shutdown_db();
+
+            printf("%-10d %-9s %12.0f %10ld %14ld\n", num_buf,
+                flag == FILE_DIRECT_IO_FLAG ? "direct" : "buffered",
+                num_queries / elapsed, rss, cached);
+        }
+    }
+
+    remove(path);
+    return 0;
+}
@@ -0,0 +1,37 @@
+#include "bench_util.h"
+#include <iostream>
+
+//compare write throughput of each durability mode
+//insert records with a small buffer so that most inserts cause write-back,
+//then take a checkpoint(db_flush_all) to make every mode equally durable at the end
+//usage: durability_bench [num_keys] [num_buf]
+int main(int argc, char** argv){
+    const int num_keys = argc > 1 ? atoi(argv[1]) : 20000;
+    const int num_buf = argc > 2 ? atoi(argv[2]) : 64;
+    const char* path = "./durability_bench.db";
+
+    struct { const char* name; int flag; } modes[] = {
+        {"o_sync", FILE_DEFAULT_FLAG},
+        {"periodic", FILE_PERIODIC_SYNC_FLAG},
+        {"checkpoint", FILE_CHECKPOINT_SYNC_FLAG},
+    };
+
+    printf("%-11s %12s %12s %14s\n", "mode", "inserts/s", "insert(s)", "checkpoint(s)");
+    for(auto& mode : modes){
+        remove(path);
+        init_db(num_buf);
+
+        double begin = BENCH::now();
+        BENCH::load_table(path, num_keys, mode.flag);
+        double inserted = BENCH::now();
+        db_flush_all();
+        double flushed = BENCH::now();
+
+        shutdown_db();
+        printf("%-11s %12.0f %12.3f %14.3f\n", mode.name,
+            num_keys / (flushed - begin), inserted - begin, flushed - inserted);
+    }
+
+    remove(path);
+    return 0;
+}
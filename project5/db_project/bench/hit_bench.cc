@@ -0,0 +1,57 @@
+#include "bench_util.h"
+#include <iostream>
+#include <thread>
+
+//buffer hit throughput from 1 to max_threads threads
+//every page read is cached, so this measures page table lookup and page latch only
+//no_lock: read without page lock (looked up in hash table stripe without buffer manager latch)
+//shared: read with shared lock and release it by write api (takes buffer manager latch twice)
+//only no_lock hits skip buffer manager latch, read/write lock modes, direct read and write
+//(pin and unpin) still take it, since pin counts own the LRU list
+//usage: hit_bench [num_buf] [num_ops] [max_threads]
+int main(int argc, char** argv){
+    const int num_buf = argc > 1 ? atoi(argv[1]) : 4096;
+    const int num_ops = argc > 2 ? atoi(argv[2]) : 4000000;
+    const int max_threads = argc > 3 ? atoi(argv[3]) : 64;
+    const char* path = "./hit_bench.db";
+
+    remove(path);
+    init_db(num_buf);
+    buffer_set_readahead_pages(0);
+    int64_t tid = BENCH::load_table(path, num_buf * 20);
+
+    //cache hot pages
+    const uint64_t hot_pages = std::min<uint64_t>(num_buf / 2, file_get_number_of_pages(tid) - 1);
+    page_t page;
+    for(uint64_t p = 1; p <= hot_pages; p++) buffer_read_page(tid, p, &page, BUFFER_NO_LOCK_MODE);
+
+    printf("# latch-free hit path covers no_lock reads only\n");
+    printf("# shared mode pins page and takes buffer manager latch on read and write\n");
+    printf("%-8s %8s %14s %14s\n", "mode", "threads", "ops/s", "ops/s/thread");
+    for(int lock_policy : {BUFFER_NO_LOCK_MODE, BUFFER_READ_LOCK_MODE}){
+        for(int num_threads = 1; num_threads <= max_threads; num_threads *= 2){
+            std::vector<std::thread> threads;
+            double begin = BENCH::now();
+            for(int t = 0; t < num_threads; t++){
+                threads.emplace_back([&, t]{
+                    std::mt19937 gen(t);
+                    std::uniform_int_distribution<uint64_t> page_dis(1, hot_pages);
+                    page_t page;
+                    for(int i = 0; i < num_ops / num_threads; i++){
+                        pagenum_t pagenum = page_dis(gen);
+                        buffer_read_page(tid, pagenum, &page, lock_policy);
+                        if(lock_policy != BUFFER_NO_LOCK_MODE) buffer_write_page(tid, pagenum, nullptr);
+                    }
+                });
+            }
+            for(auto& th : threads) th.join();
+            double ops = num_ops / (BENCH::now() - begin);
+            printf("%-8s %8d %14.0f %14.0f\n", lock_policy == BUFFER_NO_LOCK_MODE ? "no_lock" : "shared",
+                num_threads, ops, ops / num_threads);
+        }
+    }
+
+    shutdown_db();
+    remove(path);
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "bench_util.h"
+#include <iostream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+//random point lookups on large fully cached table in each huge page mode of buffer pool
+//data TLB misses are counted by perf event (shown as -1 if perf event isn't allowed)
+//usage: huge_page_bench [num_keys] [num_queries]
+namespace{
+    //open counter of data TLB read misses of this thread
+    int open_dtlb_counter(){
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+}
+
+int main(int argc, char** argv){
+    const int num_keys = argc > 1 ? atoi(argv[1]) : 1000000;
+    const int num_queries = argc > 2 ? atoi(argv[2]) : 2000000;
+    const char* path = "./huge_page_bench.db";
+
+    //load once
+    remove(path);
+    init_db(1 << 14);
+    long file_pages = file_get_number_of_pages(BENCH::load_table(path, num_keys));
+    shutdown_db();
+
+    //buffer holds every page of table
+    const int num_buf = file_pages + 16;
+    const char* names[] = {"none", "transparent", "explicit"};
+    printf("%-12s %-12s %10s %12s %14s %12s\n", "requested", "used", "pool(MiB)", "find/s", "dTLB miss/op", "rss(MiB)");
+    for(int mode : {BUFFER_HUGE_PAGE_NONE, BUFFER_HUGE_PAGE_TRANSPARENT, BUFFER_HUGE_PAGE_EXPLICIT}){
+        db_set_huge_page_mode(mode);
+        init_db(num_buf);
+        int64_t tid = open_table(const_cast<char*>(path));
+
+        //warm up every page
+        uint64_t checksum = 0;
+        auto sum = [](int64_t key, const char* value, uint16_t val_size, void* arg){
+            *reinterpret_cast<uint64_t*>(arg) += key + val_size;
+        };
+        db_scan(tid, 0, num_keys - 1, sum, &checksum);
+
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<int64_t> key_dis(0, num_keys - 1);
+        char val[MAX_VALUE_SIZE];
+        uint16_t val_size;
+        int counter = open_dtlb_counter();
+        if(counter != -1){
+            ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+            ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        double begin = BENCH::now();
+        for(int i = 0; i < num_queries; i++){
+            db_find(tid, key_dis(gen), val, &val_size);
+        }
+        double elapsed = BENCH::now() - begin;
+        long long misses = -1;
+        if(counter != -1){
+            ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+            if(read(counter, &misses, sizeof(misses)) != sizeof(misses)) misses = -1;
+            close(counter);
+        }
+
+        printf("%-12s %-12s %10ld %12.0f %14.3f %12ld\n", names[mode], names[buffer_get_huge_page_mode()],
+            (long)num_buf * PAGE_SIZE >> 20, num_queries / elapsed,
+            misses < 0 ? -1.0 : (double)misses / num_queries, BENCH::rss_kib() >> 10);
+        shutdown_db();
+    }
+
+    db_set_huge_page_mode(BUFFER_HUGE_PAGE_NONE);
+    remove(path);
+    return 0;
+}
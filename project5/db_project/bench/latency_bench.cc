@@ -0,0 +1,83 @@
+#include "bench_util.h"
+#include <iostream>
+#include <thread>
+
+//tail latency of operations when storage is slow or stalls
+//reader thread finds hot keys (mostly buffer hits) while updater thread
+//updates random keys, so the buffer manager evicts and writes back pages
+//table lives in memory backend and the latency backend adds configured delay
+//usage: latency_bench [num_keys] [num_ops] [num_buf] [hot_keys]
+int main(int argc, char** argv){
+    const int num_keys = argc > 1 ? atoi(argv[1]) : 50000;
+    const int num_ops = argc > 2 ? atoi(argv[2]) : 5000;
+    const int num_buf = argc > 3 ? atoi(argv[3]) : 128;
+    const int hot_keys = argc > 4 ? atoi(argv[4]) : 1000;
+    const char* path = "./latency_bench.db";
+
+    struct { const char* name; storage_latency_config_t config; } scenarios[] = {
+        {"none", {{0, 0}, {0, 0}, 0, 0, 1}},
+        {"ssd", {{20, 10}, {30, 20}, 0, 0, 1}},
+        {"ssd+stall", {{20, 10}, {30, 20}, 0.001, 20000, 1}},
+        {"slow", {{500, 500}, {500, 500}, 0, 0, 1}},
+    };
+
+    //load once into memory backend without delay
+    file_set_storage_backend(storage_get_memory_backend());
+    file_remove_table_file(path);
+    init_db(num_buf);
+    BENCH::load_table(path, num_keys);
+    shutdown_db();
+
+    printf("%-10s %-6s %9s %9s %9s %9s %9s\n", "scenario", "op", "p50(us)", "p99(us)", "p999(us)", "max(us)", "stalls");
+    for(auto& scenario : scenarios){
+        file_set_storage_backend(storage_get_latency_backend(storage_get_memory_backend(), &scenario.config));
+        init_db(num_buf);
+        int64_t tid = open_table(const_cast<char*>(path));
+
+        std::vector<double> find_us, update_us;
+        find_us.reserve(num_ops);
+        update_us.reserve(num_ops);
+
+        std::thread reader([&]{
+            std::mt19937 gen(1);
+            std::uniform_int_distribution<int64_t> key_dis(0, hot_keys - 1);
+            char val[MAX_VALUE_SIZE];
+            uint16_t val_size;
+            for(int i = 0; i < num_ops; i++){
+                double begin = BENCH::now();
+                db_find(tid, key_dis(gen), val, &val_size);
+                find_us.push_back((BENCH::now() - begin) * 1e6);
+            }
+        });
+        std::thread updater([&]{
+            std::mt19937 gen(2);
+            std::uniform_int_distribution<int64_t> key_dis(0, num_keys - 1);
+            char val[MIN_VALUE_SIZE];
+            memset(val, 'U', sizeof(val));
+            uint16_t old_val_size;
+            for(int i = 0; i < num_ops; i++){
+                double begin = BENCH::now();
+                int trx_id = trx_begin();
+                if(db_update(tid, key_dis(gen), val, sizeof(val), &old_val_size, trx_id) == 0) trx_commit(trx_id);
+                update_us.push_back((BENCH::now() - begin) * 1e6);
+            }
+        });
+        reader.join();
+        updater.join();
+        shutdown_db();
+
+        storage_latency_stats_t stats;
+        storage_get_latency_stats(&stats);
+        for(auto op : {std::make_pair("find", &find_us), std::make_pair("update", &update_us)}){
+            std::vector<double>& samples = *op.second;
+            double p50 = BENCH::percentile(samples, 0.5);
+            printf("%-10s %-6s %9.1f %9.1f %9.1f %9.1f %9lu\n", scenario.name, op.first,
+                p50, BENCH::percentile(samples, 0.99),
+                BENCH::percentile(samples, 0.999), samples.back(), stats.number_of_stalls);
+        }
+    }
+
+    file_remove_table_file(path);
+    file_set_storage_backend(nullptr);
+    return 0;
+}
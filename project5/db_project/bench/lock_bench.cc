@@ -0,0 +1,83 @@
+#include "bench_util.h"
+#include <iostream>
+#include <thread>
+
+//record locking throughput on disjoint keys
+//each thread runs transactions updating its own key range (no lock conflict between threads)
+//so only lock table latching is shared
+//report updates per second and speedup over one thread for growing number of threads,
+//and lock objects made against heap allocations of lock object pool (one per lock object without pool)
+//hot page part: threads update their own records of first HOT_KEYS keys (a few leaf pages),
+//so every page holds many locks of different records at once
+//usage: lock_bench [num_keys] [trx_per_thread] [updates_per_trx]
+#define HOT_KEYS 64
+
+int main(int argc, char** argv){
+    const int num_keys = argc > 1 ? atoi(argv[1]) : 64000;
+    const int trx_per_thread = argc > 2 ? atoi(argv[2]) : 2000;
+    const int updates_per_trx = argc > 3 ? atoi(argv[3]) : 10;
+    const char* path = "./lock_bench.db";
+
+    //table lives in memory so that no I/O is measured
+    file_set_storage_backend(storage_get_memory_backend());
+    file_remove_table_file(path);
+    init_db(8192);
+    int64_t tid = BENCH::load_table(path, num_keys);
+
+    printf("cpus: %u\n", std::thread::hardware_concurrency());
+    printf("%-8s %14s %10s %12s %12s\n", "threads", "updates/s", "speedup", "lock objs", "heap allocs");
+    double base = 0;
+    for(int num_threads : {1, 2, 4, 8, 16}){
+        const int range = num_keys / num_threads;
+        std::vector<std::thread> threads;
+        uint64_t locks_before, slabs_before, locks_after, slabs_after;
+        lock_get_pool_stats(&locks_before, &slabs_before);
+        double begin = BENCH::now();
+        for(int t = 0; t < num_threads; t++){
+            threads.emplace_back([&, t]{
+                std::mt19937 gen(t);
+                std::uniform_int_distribution<int64_t> key_dis((int64_t)t * range, (int64_t)(t + 1) * range - 1);
+                char val[MIN_VALUE_SIZE];
+                memset(val, 'a' + t % 26, sizeof(val));
+                uint16_t old_size;
+                for(int i = 0; i < trx_per_thread; i++){
+                    int trx_id = trx_begin();
+                    for(int j = 0; j < updates_per_trx; j++) db_update(tid, key_dis(gen), val, sizeof(val), &old_size, trx_id);
+                    trx_commit(trx_id);
+                }
+            });
+        }
+        for(std::thread& thread : threads) thread.join();
+        double throughput = (double)num_threads * trx_per_thread * updates_per_trx / (BENCH::now() - begin);
+        if(num_threads == 1) base = throughput;
+        lock_get_pool_stats(&locks_after, &slabs_after);
+        printf("%-8d %14.0f %10.2f %12lu %12lu\n", num_threads, throughput, throughput / base,
+            locks_after - locks_before, slabs_after - slabs_before);
+    }
+
+    printf("\nhot page\n%-8s %14s\n", "threads", "updates/s");
+    for(int num_threads : {1, 2, 4, 8, 16}){
+        std::vector<std::thread> threads;
+        double begin = BENCH::now();
+        for(int t = 0; t < num_threads; t++){
+            threads.emplace_back([&, t]{
+                char val[MIN_VALUE_SIZE];
+                memset(val, 'a' + t % 26, sizeof(val));
+                uint16_t old_size;
+                for(int i = 0; i < trx_per_thread; i++){
+                    //every record of this thread in one trx
+                    int trx_id = trx_begin();
+                    for(int key = t; key < HOT_KEYS; key += num_threads) db_update(tid, key, val, sizeof(val), &old_size, trx_id);
+                    trx_commit(trx_id);
+                }
+            });
+        }
+        for(std::thread& thread : threads) thread.join();
+        printf("%-8d %14.0f\n", num_threads, (double)trx_per_thread * HOT_KEYS / (BENCH::now() - begin));
+    }
+
+    shutdown_db();
+    file_remove_table_file(path);
+    file_set_storage_backend(nullptr);
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include "bench_util.h"
+#include <iostream>
+
+//compare buffer manager read path and read-only mmap read path
+//on random point lookups and full range scan
+//usage: mmap_read_bench [num_keys] [num_queries] [num_buf]
+int main(int argc, char** argv){
+    const int num_keys = argc > 1 ? atoi(argv[1]) : 100000;
+    const int num_queries = argc > 2 ? atoi(argv[2]) : 200000;
+    const int num_buf = argc > 3 ? atoi(argv[3]) : 1024;
+    const char* path = "./mmap_read_bench.db";
+
+    //build data set once
+    remove(path);
+    init_db();
+    BENCH::load_table(path, num_keys);
+    shutdown_db();
+
+    printf("%-9s %14s %14s\n", "mode", "lookup(ops/s)", "scan(rec/s)");
+    for(int flag : {FILE_DEFAULT_FLAG, FILE_READ_ONLY_MMAP_FLAG}){
+        init_db(num_buf);
+        int64_t tid = open_table(const_cast<char*>(path), flag);
+
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<int64_t> key_dis(0, num_keys - 1);
+        char val[MAX_VALUE_SIZE];
+        uint16_t val_size;
+
+        double begin = BENCH::now();
+        for(int i = 0; i < num_queries; i++){
+            db_find(tid, key_dis(gen), val, &val_size);
+        }
+        double lookup_elapsed = BENCH::now() - begin;
+
+        uint64_t checksum = 0;
+        auto sum = [](int64_t key, const char* value, uint16_t val_size, void* arg){
+            *reinterpret_cast<uint64_t*>(arg) += key + val_size;
+        };
+        begin = BENCH::now();
+        int scanned = db_scan(tid, 0, num_keys - 1, sum, &checksum);
+        double scan_elapsed = BENCH::now() - begin;
+
+        shutdown_db();
+
+        printf("%-9s %14.0f %14.0f\n", flag == FILE_READ_ONLY_MMAP_FLAG ? "mmap" : "buffer",
+            num_queries / lookup_elapsed, scanned / scan_elapsed);
+    }
+
+    remove(path);
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "bench_util.h"
+#include <iostream>
+
+//tree shape and throughput of this build's page size (DB_PAGE_SIZE)
+//buffer pool has the same memory budget in every page size
+//direct I/O is used so that kernel page cache doesn't hide the difference
+//page_size_matrix target runs this program built with every page size
+//usage: page_size_bench [num_keys] [num_queries] [buffer_mib]
+int main(int argc, char** argv){
+    const int num_keys = argc > 1 ? atoi(argv[1]) : 200000;
+    const int num_queries = argc > 2 ? atoi(argv[2]) : 200000;
+    const int buffer_mib = argc > 3 ? atoi(argv[3]) : 4;
+    const int num_buf = std::max(buffer_mib * (1 << 20) / PAGE_SIZE, 16);
+    const char* path = "./page_size_bench.db";
+
+    //load phase
+    remove(path);
+    init_db(num_buf);
+    double begin = BENCH::now();
+    int64_t tid = BENCH::load_table(path, num_keys, FILE_DIRECT_IO_FLAG);
+    double insert_elapsed = BENCH::now() - begin;
+
+    //walk leftmost path for tree height, then leaf chain for the number of leaves
+    FIM::_fim_page_t page;
+    buffer_read_page(tid, 0, &page._raw_page, BUFFER_NO_LOCK_MODE);
+    pagenum_t pagenum = page._header_page.root_page_number;
+    int height = 0;
+    long leaves = 0;
+    while(pagenum){
+        buffer_read_page(tid, pagenum, &page._raw_page, BUFFER_NO_LOCK_MODE);
+        if(!page._leaf_page.page_header.is_leaf){
+            height++;
+            pagenum = page._internal_page.leftmost_page_number;
+            continue;
+        }
+        if(!leaves) height++;
+        leaves++;
+        pagenum = page._leaf_page.right_sibling_page_number;
+    }
+    long file_kib = file_get_number_of_pages(tid) * (PAGE_SIZE / 1024);
+    shutdown_db();
+
+    //random point lookups from cold cache
+    BENCH::drop_file_cache(path);
+    init_db(num_buf);
+    tid = open_table(const_cast<char*>(path), FILE_DIRECT_IO_FLAG);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int64_t> key_dis(0, num_keys - 1);
+    char val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    begin = BENCH::now();
+    for(int i = 0; i < num_queries; i++){
+        db_find(tid, key_dis(gen), val, &val_size);
+    }
+    double find_elapsed = BENCH::now() - begin;
+    shutdown_db();
+
+    //full range scan from cold cache
+    BENCH::drop_file_cache(path);
+    init_db(num_buf);
+    tid = open_table(const_cast<char*>(path), FILE_DIRECT_IO_FLAG);
+    uint64_t checksum = 0;
+    auto sum = [](int64_t key, const char* value, uint16_t val_size, void* arg){
+        *reinterpret_cast<uint64_t*>(arg) += key + val_size;
+    };
+    begin = BENCH::now();
+    int scanned = db_scan(tid, 0, num_keys - 1, sum, &checksum);
+    double scan_elapsed = BENCH::now() - begin;
+    shutdown_db();
+
+    printf("%-6s %-7s %7s %9s %10s %12s %12s %12s\n",
+        "page", "buffer", "height", "leaves", "file(KiB)", "insert/s", "find/s", "scan rec/s");
+    printf("%-6d %-7d %7d %9ld %10ld %12.0f %12.0f %12.0f\n",
+        PAGE_SIZE, num_buf, height, leaves, file_kib,
+        num_keys / insert_elapsed, num_queries / find_elapsed, scanned / scan_elapsed);
+
+    remove(path);
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "bench_util.h"
+#include <iostream>
+#include <thread>
+
+//buffer misses while concurrent readers keep many pages pinned
+//each reader thread pins its share of pinned frames (read first, so they sit at LRU front)
+//and then reads random pages of a table larger than buffer while holding the pins
+//victim search cost shouldn't depend on how many frames are pinned
+//usage: pin_bench [num_buf] [num_ops] [num_threads]
+int main(int argc, char** argv){
+    const int num_buf = argc > 1 ? atoi(argv[1]) : 4096;
+    const int num_ops = argc > 2 ? atoi(argv[2]) : 200000;
+    const int num_threads = argc > 3 ? atoi(argv[3]) : 4;
+    const char* path = "./pin_bench.db";
+
+    //table larger than buffer
+    remove(path);
+    init_db(num_buf);
+    int64_t tid = BENCH::load_table(path, num_buf * 60);
+    const uint64_t number_of_pages = file_get_number_of_pages(tid);
+    shutdown_db();
+
+    printf("%-8s %8s %10s %14s\n", "pinned", "threads", "frames", "reads/s");
+    for(double ratio : {0.0, 0.5, 0.9, 0.99}){
+        init_db(num_buf);
+        buffer_set_readahead_pages(0);
+        tid = open_table(const_cast<char*>(path));
+        const uint64_t pins_per_thread = (uint64_t)(num_buf * ratio) / num_threads;
+
+        std::vector<std::thread> threads;
+        double begin = BENCH::now();
+        for(int t = 0; t < num_threads; t++){
+            threads.emplace_back([&, t]{
+                //pin own pages
+                const uint64_t first = 1 + t * pins_per_thread;
+                for(uint64_t p = first; p < first + pins_per_thread; p++) buffer_direct_read_page(tid, p);
+
+                std::mt19937 gen(t);
+                std::uniform_int_distribution<uint64_t> page_dis(1, number_of_pages - 1);
+                page_t page;
+                for(int i = 0; i < num_ops / num_threads; i++){
+                    buffer_read_page(tid, page_dis(gen), &page, BUFFER_NO_LOCK_MODE);
+                }
+
+                for(uint64_t p = first; p < first + pins_per_thread; p++) buffer_direct_write_page(tid, p, false);
+            });
+        }
+        for(auto& th : threads) th.join();
+        double elapsed = BENCH::now() - begin;
+        printf("%-8.2f %8d %10lu %14.0f\n", ratio, num_threads, pins_per_thread * num_threads, num_ops / elapsed);
+        shutdown_db();
+    }
+
+    remove(path);
+    return 0;
+}
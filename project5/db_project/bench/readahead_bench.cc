@@ -0,0 +1,47 @@
+#include "bench_util.h"
+#include <iostream>
+
+//full range scan from cold cache with and without buffer readahead
+//direct I/O is used so that kernel readahead doesn't hide the difference
+//usage: readahead_bench [num_keys] [num_buf]
+int main(int argc, char** argv){
+    const int num_keys = argc > 1 ? atoi(argv[1]) : 200000;
+    const int num_buf = argc > 2 ? atoi(argv[2]) : 1024;
+    const int windows[] = {0, 8, 32};
+    const char* path = "./readahead_bench.db";
+
+    //build data set once
+    //sequential insert makes leaf chain mostly contiguous in file
+    remove(path);
+    init_db();
+    int64_t tid = open_table(const_cast<char*>(path));
+    std::mt19937 gen(1234);
+    for(int i = 0; i < num_keys; i++){
+        std::string val = BENCH::make_value(gen, MIN_VALUE_SIZE);
+        db_insert(tid, i, const_cast<char*>(val.c_str()), val.size());
+    }
+    shutdown_db();
+
+    printf("%-8s %12s %10s\n", "window", "rec/s", "time(s)");
+    for(int window : windows){
+        BENCH::drop_file_cache(path);
+
+        init_db(num_buf);
+        buffer_set_readahead_pages(window);
+        tid = open_table(const_cast<char*>(path), FILE_DIRECT_IO_FLAG);
+
+        uint64_t checksum = 0;
+        auto sum = [](int64_t key, const char* value, uint16_t val_size, void* arg){
+            *reinterpret_cast<uint64_t*>(arg) += key + val_size;
+        };
+        double begin = BENCH::now();
+        int scanned = db_scan(tid, 0, num_keys - 1, sum, &checksum);
+        double elapsed = BENCH::now() - begin;
+
+        shutdown_db();
+        printf("%-8d %12.0f %10.3f\n", window, scanned / elapsed, elapsed);
+    }
+
+    remove(path);
+    return 0;
+}
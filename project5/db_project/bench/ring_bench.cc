@@ -0,0 +1,91 @@
+#include "bench_util.h"
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+//OLTP working set while a nightly job passes over a large table
+//one thread runs random lookups on a hot table that fits in buffer (with think time between them),
+//another reads every key of a large table by point lookups (normal or bulk mode) or by full scan,
+//or by normal point lookups while hot table has min frame quota of its warm pages
+//report hit ratio and lookup throughput of hot table during the pass
+//and misses when every hot key is read once again after it (working set lost)
+//direct I/O is used so that misses of hot table are real reads
+//usage: ring_bench [num_buf] [hot_keys] [big_keys]
+#define OLTP_THINK_US 100
+
+int main(int argc, char** argv){
+    const int num_buf = argc > 1 ? atoi(argv[1]) : 2048;
+    const int hot_keys = argc > 2 ? atoi(argv[2]) : 20000;
+    const int big_keys = argc > 3 ? atoi(argv[3]) : 400000;
+    const char* hot_path = "./ring_bench_hot.db";
+    const char* big_path = "./ring_bench_big.db";
+
+    remove(hot_path);
+    remove(big_path);
+    init_db(num_buf);
+    BENCH::load_table(hot_path, hot_keys, FILE_DIRECT_IO_FLAG);
+    db_begin_bulk();
+    BENCH::load_table(big_path, big_keys, FILE_DIRECT_IO_FLAG);
+    db_end_bulk();
+    shutdown_db();
+
+    printf("%-8s %10s %10s %14s %12s\n", "job", "job(s)", "hot hit%", "hot finds/s", "misses after");
+    for(const char* job : {"find", "bulk", "scan", "quota"}){
+        init_db(num_buf);
+        int64_t hot_tid = open_table(const_cast<char*>(hot_path), FILE_DIRECT_IO_FLAG);
+        int64_t big_tid = open_table(const_cast<char*>(big_path), FILE_DIRECT_IO_FLAG);
+        char val[MAX_VALUE_SIZE];
+        uint16_t val_size;
+
+        //warm working set
+        for(int i = 0; i < hot_keys; i++) db_find(hot_tid, i, val, &val_size);
+        if(!strcmp(job, "quota")) db_set_table_quota(hot_tid, db_get_table_frames(hot_tid));
+        io_stats_t before, after;
+        db_get_table_stats(hot_tid, &before);
+
+        std::atomic<bool> is_done(false);
+        long hot_finds = 0;
+        std::thread oltp([&]{
+            std::mt19937 gen(7);
+            std::uniform_int_distribution<int64_t> key_dis(0, hot_keys - 1);
+            char val[MAX_VALUE_SIZE];
+            uint16_t val_size;
+            while(!is_done.load()){
+                db_find(hot_tid, key_dis(gen), val, &val_size);
+                hot_finds++;
+                usleep(OLTP_THINK_US);
+            }
+        });
+
+        double begin = BENCH::now();
+        if(!strcmp(job, "scan")){
+            auto ignore = [](int64_t key, const char* value, uint16_t val_size, void* arg){};
+            db_scan(big_tid, 0, big_keys - 1, ignore, nullptr);
+        }
+        else{
+            if(!strcmp(job, "bulk")) db_begin_bulk();
+            for(int i = 0; i < big_keys; i++) db_find(big_tid, i, val, &val_size);
+            if(!strcmp(job, "bulk")) db_end_bulk();
+        }
+        double elapsed = BENCH::now() - begin;
+        is_done.store(true);
+        oltp.join();
+
+        db_get_table_stats(hot_tid, &after);
+        uint64_t hits = after.buffer_hits - before.buffer_hits;
+        uint64_t misses = after.buffer_misses - before.buffer_misses;
+
+        //read working set again
+        for(int i = 0; i < hot_keys; i++) db_find(hot_tid, i, val, &val_size);
+        db_get_table_stats(hot_tid, &before);
+
+        printf("%-8s %10.2f %10.2f %14.0f %12lu\n", job, elapsed,
+            100.0 * hits / std::max<uint64_t>(hits + misses, 1), hot_finds / elapsed,
+            before.buffer_misses - after.buffer_misses);
+        shutdown_db();
+    }
+
+    remove(hot_path);
+    remove(big_path);
+    return 0;
+}
@@ -2,11 +2,14 @@
 
 #include <stdio.h>
 #include "bpt.h"
+#include "compact.h"
 
 //Open existing data file using 'pathname' or create one if not existed.
+//flag is combination of FILE_*_FLAG (e.g. FILE_DIRECT_IO_FLAG to bypass kernel page cache)
+//FILE_READ_ONLY_MMAP_FLAG opens existing table read-only and serves lookups from memory mapping
 //If success, return the unique table id, which represents the own table in this database.
 //Otherwise, return negative value.
-int64_t open_table(char *pathname);
+int64_t open_table(char *pathname, int flag = FILE_DEFAULT_FLAG);
 
 //Insert input record with its size to data file at the right place.
 //If success, return 0. Otherwise, return non zero value.
@@ -22,9 +25,88 @@ int db_find(int64_t table_id, int64_t key, char *ret_val, uint16_t *val_size);
 //If success, return 0. Otherwise, return non zero value.
 int db_delete(int64_t table_id, int64_t key);
 
+//Call callback for each record with begin_key <= key <= end_key in key order.
+//If success, return the number of scanned records. Otherwise, return negative value.
+int db_scan(int64_t table_id, int64_t begin_key, int64_t end_key, scan_callback_t callback, void* arg);
+
+//Online compaction: move live pages to the front of table file in key order
+//and return free pages at the tail to file system.
+//Other operations can run concurrently, at most max_pages_per_sec pages are moved per second (0 means no limit).
+//If success, return the number of pages cut off from file. Otherwise, return negative value.
+int64_t db_compact_table(int64_t table_id, int max_pages_per_sec = 0);
+
+//Bulk operation: buffer misses of calling thread recycle a private ring of ring_frames frames
+//until db_end_bulk, so a bulk load or a pass over large table doesn't push working set out of buffer.
+//Scans longer than SCAN_RING_THRESHOLD leaf pages and compaction do this by themselves.
+//If success, return 0. Otherwise, return non zero value.
+int db_begin_bulk(int ring_frames = DEFAULT_RING_FRAMES);
+int db_end_bulk();
+
+//Tablespace: every table file can hold many tables sharing its pages and file descriptor.
+//Table opened by open_table is table number 0 of its tablespace.
+//Create new empty table in tablespace of given table (no page is preallocated).
+//If success, return table id of new table. Otherwise, return negative value.
+int64_t db_create_table(int64_t space_id);
+
+//Get table id of table_number th table in tablespace of given table
+//(table number is (table id >> TABLE_NUMBER_SHIFT) and stays same after reopen).
+//If there is such table, return its table id. Otherwise, return negative value.
+int64_t db_get_table(int64_t space_id, uint32_t table_number);
+
+//Get I/O statistics of whole database: counters summed over all table files
+//and latency histograms of file reads, file writes and buffer miss service.
+//If success, return 0. Otherwise, return non zero value.
+int db_get_stats(db_stats_t* stats);
+
+//Get I/O counters of table file holding given table (counters are cleared when it is opened).
+//If success, return 0. Otherwise, return non zero value.
+int db_get_table_stats(int64_t table_id, io_stats_t* stats);
+
+//Set buffer frame quota of table file holding given table (tables in a tablespace share it).
+//Pages of the table aren't evicted by misses of other tables while it has min_frames or less pages in buffer,
+//and its misses replace its own pages once it has max_frames pages in buffer (0 means none / no limit).
+//Quota is a preference of victim selection, so pages are still evicted if every frame is against quota.
+//Per table hit ratio is stats_get_hit_ratio of db_get_table_stats counters.
+//If success, return 0. Otherwise, return non zero value.
+int db_set_table_quota(int64_t table_id, int min_frames, int max_frames = 0);
+
+//Get the number of buffer frames holding pages of table file holding given table.
+//If success, return it. Otherwise, return negative value.
+int db_get_table_frames(int64_t table_id);
+
+//Append statistics snapshot to file in pathname every interval_ms until shutdown_db
+//(NULL pathname or non-positive interval stops dumping).
+//If success, return 0. Otherwise, return non zero value.
+int db_set_stats_dump(const char* pathname, int interval_ms);
+
 //Initialize database management system.
+//If warmup_pathname is given, pages resident at the last shutdown_db (saved in that file) are
+//prefetched in background when their table is opened, and resident pages are saved there again on shutdown.
+//If success, return 0. Otherwise, return non zero value.
+int init_db(int num_buf = DEFAULT_BUFFER_SIZE, const char* warmup_pathname = nullptr);
+
+//Set huge page mode of buffer pool (BUFFER_HUGE_PAGE_*) used from the next init_db.
+//Explicit hugetlb pages fall back to transparent huge pages, and those to normal pages, if not available.
+//If success, return 0. Otherwise, return non zero value.
+int db_set_huge_page_mode(int mode);
+
+//Change the number of buffer frames online (up to MAX_BUFFER_BYTES of frames,
+//or num_buf of init_db if address space for MAX_BUFFER_BYTES can't be reserved).
+//Growing keeps every cached page, shrinking evicts pages of removed frames and returns their memory.
+//Other operations keep running while buffer is resized.
+//If success, return 0. Otherwise, return non zero value.
+int db_resize_buffer(int num_buf);
+
+//Set memory size (bytes) of compressed second tier cache between buffer and table files (0 disables it, default).
+//Evicted pages are compressed into it and later misses are served from it without reading file,
+//so more of working set stays in memory (compressed_hits of stats counts them).
+//If success, return 0. Otherwise, return non zero value.
+int db_set_compressed_cache_size(uint64_t max_bytes);
+
+//Checkpoint: write all dirty pages in buffer to table files
+//and make them durable regardless of durability mode of each table
 //If success, return 0. Otherwise, return non zero value.
-int init_db(int num_buf = DEFAULT_BUFFER_SIZE);
+int db_flush_all();
 
 //Shutdown your database management system
 //If success, return 0. Otherwise, return non zero value.
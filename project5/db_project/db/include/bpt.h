@@ -7,15 +7,19 @@
 #include "buffer.h"
 #include "trx.h"
 
-#define DEFAULT_ORDER 124
+//page layout constants follow PAGE_SIZE (see page.h)
+#define DEFAULT_ORDER ((PAGE_SIZE - PAGE_HEADER_SIZE) / 32) //half of internal page capacity (124 in 4KiB page)
+#define MAX_KEY_NUMBER (DEFAULT_ORDER*2) //max number of keys in internal page
+#define MAX_FREE_SPACE (PAGE_SIZE / 4096 * 2500) //max free space in leaf page (2500 in 4KiB page)
 
+//catalog of tablespace
+//header page points catalog pages and catalog page has root page number of each table
+#define CATALOG_ENTRY_NUMBER (PAGE_SIZE / sizeof(pagenum_t)) //number of root entries in catalog page
+#define MAX_CATALOG_PAGE_NUMBER ((PAGE_SIZE - 64) / sizeof(pagenum_t)) //max number of catalog pages in header page
+#define MAX_TABLE_NUMBER (CATALOG_ENTRY_NUMBER * MAX_CATALOG_PAGE_NUMBER) //max table number in tablespace
 
-#define PAGE_HEADER_SIZE 128 //128bytes page header
-#define MAX_SLOT_NUMBER 64 // max # of slot
-#define MIN_VALUE_SIZE 46 //min size of value
-#define MAX_VALUE_SIZE 108 // max size of value
-#define MAX_KEY_NUMBER DEFAULT_ORDER*2 //max number of keys in internal page
-#define MAX_FREE_SPACE 2500 //max free space in leaf page
+//number of tree latch stripes for tablespaces and for tables (tables of one stripe share latch)
+#define TREE_LATCH_STRIPES 64
 
 //Insert input record with its size to data file at the right place.
 //If success, return 0. Otherwise, return non zero value.
@@ -50,11 +54,43 @@ int idx_update_by_key(int64_t table_id, int64_t key, char *values, uint16_t new_
 //Note that all tasks that need to be handled should be completed in db_update
 int idx_update_by_key_trx(int64_t table_id, int64_t key, char *values, uint16_t new_val_size, uint16_t *old_val_size, int trx_id);
 
+//callback called for each record in db_scan (record value is valid only in callback)
+typedef void (*scan_callback_t)(int64_t key, const char* value, uint16_t val_size, void* arg);
+
+//Call callback for each record with begin_key <= key <= end_key in key order.
+//If success, return the number of scanned records. Otherwise, return negative value.
+int idx_scan_by_range(int64_t table_id, int64_t begin_key, int64_t end_key, scan_callback_t callback, void* arg);
+
+//try to acquire tree structure latch of tablespace of given table exclusively
+//no find, insert, delete, update or scan runs in tablespace while it is held
+//return 0 if success or non-zero if busy
+int idx_try_lock_tree_structure(int64_t table_id);
+
+//release tree structure latch acquired by idx_try_lock_tree_structure
+void idx_unlock_tree_structure(int64_t table_id);
+
+//Create new empty table in tablespace of given table.
+//Table is only recorded in catalog (no page is preallocated).
+//If success, return table id of new table. Otherwise, return negative value.
+int64_t idx_create_table(int64_t space_id);
+
+//Get table id of table_number th table in tablespace of given table.
+//If there is such table, return its table id. Otherwise, return negative value.
+int64_t idx_get_table(int64_t space_id, uint32_t table_number);
+
 //get trx id in given slot for implicit locking
 int idx_get_trx_id_in_slot(int64_t table_id, pagenum_t page_id, uint32_t slot_number);
 
-//set trx id in given slot for implicit locking
-void idx_set_trx_id_in_slot(int64_t table_id, pagenum_t page_id, uint32_t slot_number, int trx_id);
+//set trx id in record with given key for implicit locking
+//slot_number is where record was, other slots of page are searched if record moved
+//nothing is written if record is not in page
+void idx_set_trx_id_in_slot(int64_t table_id, pagenum_t page_id, uint32_t slot_number, int64_t key, int trx_id);
+
+//write old value back into record with given key in given page (rollback)
+//slot_number is where record was, other slots of page are searched if record moved
+//no tree latch is taken (caller's trx locks the record, so page is not moved)
+//return 0 if success or -1 if record is not in page
+int idx_restore_record_in_slot(int64_t table_id, pagenum_t page_id, uint32_t slot_number, int64_t key, const char* values, uint16_t val_size);
 
 //inner struct and function used in FileandIndexManager
 namespace FIM{
@@ -63,7 +99,17 @@ namespace FIM{
         pagenum_t free_page_number; //point to the first free page(head of free page list) or indicate no free page if 0
         uint64_t number_of_pages; //the number of pages paginated in db file
         pagenum_t root_page_number; //pointing the root page within the data file or indicate no root page if 0
-        uint8_t __reserved__[PAGE_SIZE - 2*sizeof(pagenum_t) - sizeof(uint64_t)]; //not used for now
+        uint64_t __page_size__; //used by DSM
+        uint64_t number_of_tables; //number of tables in catalog (table number 1 ~ number_of_tables)
+        pagenum_t catalog_page_number[MAX_CATALOG_PAGE_NUMBER]; //catalog pages in table number order
+        uint8_t __reserved__[PAGE_SIZE - (MAX_CATALOG_PAGE_NUMBER + 2)*sizeof(pagenum_t) - 4*sizeof(uint64_t)]; //not used for now
+        uint64_t __format_magic__; //used by DSM
+    };
+
+    //catalog page structure
+    //table number n's root is in (n-1) % CATALOG_ENTRY_NUMBER th entry of (n-1) / CATALOG_ENTRY_NUMBER th catalog page
+    struct catalog_page_t{
+        pagenum_t root_page_number[CATALOG_ENTRY_NUMBER]; //root page number or 0 if table is empty
     };
 
     //internal, leaf page header structure
@@ -113,16 +159,74 @@ namespace FIM{
         FIM::header_page_t _header_page;
         FIM::internal_page_t _internal_page;
         FIM::leaf_page_t _leaf_page;
+        FIM::catalog_page_t _catalog_page;
+    };
+
+    //every page type should fill exactly one page
+    static_assert(sizeof(FIM::page_slot_t) == SLOT_SIZE, "slot size mismatch");
+    static_assert(sizeof(FIM::header_page_t) == PAGE_SIZE, "header page size mismatch");
+    static_assert(sizeof(FIM::internal_page_t) == PAGE_SIZE, "internal page size mismatch");
+    static_assert(sizeof(FIM::leaf_page_t) == PAGE_SIZE, "leaf page size mismatch");
+    static_assert(sizeof(FIM::catalog_page_t) == PAGE_SIZE, "catalog page size mismatch");
+    static_assert(sizeof(FIM::_fim_page_t) == PAGE_SIZE, "page union size mismatch");
+
+    //tree latch of one stripe (own cache line)
+    //writer preferred so that insert, delete and compaction are not starved by readers
+    struct alignas(64) tree_latch_t{
+        pthread_rwlock_t latch = PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP;
     };
 
+    //get space latch of tablespace of given table
+    //shared by every operation in tablespace, exclusive for page relocation (compaction) and catalog change
+    pthread_rwlock_t* get_space_latch(int64_t table_id);
+
+    //get table latch of given table
+    //shared by operations that don't change tree structure (find, update, scan), exclusive for insert and delete
+    pthread_rwlock_t* get_table_latch(int64_t table_id);
+
+    //take space latch (shared) and table latch of given table in this order
+    void lock_tree(int64_t table_id, bool is_structure_changed);
+
+    //release latches taken by lock_tree
+    void unlock_tree(int64_t table_id);
+
+    //acquire record lock while holding tree latches of given table in shared mode
+    //tree latches are released while waiting for conflicting locks
+    //return 0 if success or -1 if trx should be aborted
+    int acquire_record_lock(int64_t table_id, pagenum_t leaf_page_number, int64_t key, uint32_t slot_number, int trx_id, int lock_mode);
+
+    //find slot of given key in leaf page, trying slot_number first
+    //return slot number or -1 if there is no such record
+    int64_t find_slot_in_leaf_page(const _fim_page_t* leaf_page, uint32_t slot_number, int64_t key);
+
     //get page from BM and return new page number
     pagenum_t make_page(int64_t table_id);
     
-    //change root page number in header page
+    //find catalog page and entry index holding root page number of given table
+    //table number should be 1 ~ number of tables in catalog
+    pagenum_t find_catalog_entry(int64_t table_id, uint32_t* entry_index);
+
+    //get root page number of given table from header page or catalog page
+    //return 0 if tree is empty
+    pagenum_t get_root_page(int64_t table_id);
+
+    //change root page number in header page (table 0) or catalog page (other tables)
     //you can set root page number to 0 when del_tree_flag is on
     //return 0 if success or -1 if fail
     int change_root_page(int64_t table_id, pagenum_t root_page_number, bool del_tree_flag = false);
 
+    //add new table into catalog of tablespace and return its table number
+    //catalog page is allocated only when the last one is full
+    uint32_t add_table_to_catalog(int64_t space_id);
+
+    //check given table is opened as read-only mmap table
+    bool is_read_only_table(int64_t table_id);
+
+    //get page for lookup only
+    //return page in memory mapping if table is read-only mmap table
+    //otherwise read page from BM into buf and return buf
+    const _fim_page_t* read_page_for_lookup(int64_t table_id, pagenum_t pagenum, _fim_page_t* buf);
+
     //find the leaf page in which given key is likely to be
     //return 0 if there is no tree
     //throw msg in looping situation (doesn't has key but not leaf)
@@ -134,9 +238,15 @@ namespace FIM{
     //return 0 if success or -1 if fail
     int find_record(int64_t table_id, int64_t key, char *ret_val = NULL, uint16_t* val_size = NULL);
 
+    //scan records with begin_key <= key <= end_key in key order following leaf sibling
+    //call callback for each record
+    //return the number of scanned records
+    int scan_records(int64_t table_id, int64_t begin_key, int64_t end_key, scan_callback_t callback, void* arg);
+
     //find the record value with given key with strict 2PL
     //save record value in ret_val(caller must provide it) and set size in val_size
     //you can get existence state by using key only and setting ret_val and val_size null
+    //record moved by insert or delete during lock wait is looked up and locked again
     //return 0 if success or -1 if fail
     int find_record_trx(int64_t table_id, int64_t key, char *ret_val, uint16_t* val_size, int trx_id);
     
@@ -151,6 +261,7 @@ namespace FIM{
     //i.e. update into given values with the size of new_val_size
     //store original value in old_val_size
     //as no structure changed, new value's length should be less or equal to original length
+    //record moved by insert or delete during lock wait is looked up and locked again
     //return 0 if success or -1 if fail
     int update_record_trx(int64_t table_id, int64_t key, char *values, uint16_t new_val_size, uint16_t *old_val_size, int trx_id);
     
@@ -4,10 +4,59 @@
 #include "file.h"
 #include <unordered_map>
 #include <utility>
+#include <deque>
+#include <list>
+#include <vector>
 #include <pthread.h>
+#include <limits.h>
+#include <atomic>
+#include <string>
 #include <ext/pb_ds/assoc_container.hpp>
 
 #define DEFAULT_BUFFER_SIZE 1024
+#define MAX_BUFFER_BYTES (64ULL << 30) //address space reserved for frames (pool can grow up to it, num_buf frames if it can't be reserved)
+#define HUGE_PAGE_SIZE (2 << 20) //size of huge page
+
+//huge page mode of frame and control block arrays
+//explicit huge pages are reserved at init for num_buf frames only,
+//so pool can't grow beyond it and shrinking doesn't return memory
+#define BUFFER_HUGE_PAGE_NONE 0 //normal pages
+#define BUFFER_HUGE_PAGE_TRANSPARENT 1 //transparent huge pages (madvise(MADV_HUGEPAGE))
+#define BUFFER_HUGE_PAGE_EXPLICIT 2 //hugetlb pages (MAP_HUGETLB), falls back to transparent
+
+#define DEFAULT_READAHEAD_PAGES 8 //number of pages read ahead on sequential access
+#define READAHEAD_TRIGGER_COUNT 2 //number of consecutive sequential misses to start readahead
+#define MAX_READAHEAD_QUEUE_SIZE 64 //pending readahead requests (drop hint when full)
+
+//ring access strategy: misses of bulk operation (large scan, bulk load, compaction)
+//recycle a small private ring of frames instead of evicting working set
+#define DEFAULT_RING_FRAMES 32 //ring size of bulk operation
+#define SCAN_RING_THRESHOLD 64 //scan switches to ring after reading this many leaf pages
+
+//compressed cache: second tier of evicted pages compressed in memory (off by default)
+//page read back into buffer keeps its compressed copy until it's written back changed,
+//so clean page evicted again isn't compressed again
+#define COMPRESSED_PAGE_OVERHEAD 96 //bytes of index entry and list node per page (counted in cache size)
+#define COMPRESSED_PAGE_MAX_SIZE (PAGE_SIZE * 3 / 4) //page compressed to larger size isn't cached
+
+//checkpoint flush writes dirty pages in (table, pagenum) order in batches
+//contiguous pages go in one vectored write and table files are written in parallel
+#define FLUSH_BATCH_FRAMES 4096 //max frames held by one batch (at most quarter of buffer)
+
+//warm-up file: list of resident pages saved at close and prefetched at next init
+//line "table <index> <path>" names table file, line "page <index> <pagenum>" is one page
+//pages are listed from most recently used one
+#define WARMUP_FILE_HEADER "# buffer warm-up v1"
+
+//page latch word
+#define LATCH_EXCLUSIVE (1U << 31) //held exclusively
+#define LATCH_WAITERS (1U << 30) //some thread sleeps on the word
+#define LATCH_SHARED_MASK (LATCH_WAITERS - 1) //number of shared holders
+#define LATCH_SPIN_COUNT 64 //checks before sleeping on futex
+
+//hash table (page id -> block) is split into stripes with own latch
+//so buffer hit can look up page without buffer manager latch
+#define HASH_TABLE_STRIPES 64
 
 #define BUFFER_WRITE_LOCK_MODE 0
 #define BUFFER_NO_LOCK_MODE 1
@@ -18,9 +67,30 @@ typedef int64_t framenum_t;
 typedef int64_t blknum_t;
 typedef std::pair<int64_t, pagenum_t> page_id;
 
+//frames are kept per table file
+//so every table in a tablespace shares the frames of tablespace pages
+
 //allocate the buffer pool with the given number of entries
+//if warm-up file is given, its page list is loaded (pages are prefetched when their table is opened)
+//and resident pages are saved into it on close
 //return 0 if success or non-zero if fail
-int init_buffer(int num_buf = DEFAULT_BUFFER_SIZE);
+int init_buffer(int num_buf = DEFAULT_BUFFER_SIZE, const char* warmup_pathname = nullptr);
+
+// Set huge page mode (BUFFER_HUGE_PAGE_*) used by the next init_buffer
+void buffer_set_huge_page_mode(int mode);
+
+// Get huge page mode actually used by current buffer pool (after fallback)
+int buffer_get_huge_page_mode();
+
+// Change the number of frames in buffer pool without dropping cached pages
+// growing adds unused frames, shrinking evicts pages of removed frames (writing back dirty ones)
+// and returns their memory to the system, other threads keep running meanwhile
+// (caller shouldn't hold any page latch)
+// return 0 if success or -1 if num_buf is out of range or write-back fails
+int buffer_resize(int num_buf);
+
+// Get the number of frames in buffer pool
+int buffer_get_size();
 
 // Allocate a page
 pagenum_t buffer_alloc_page(int64_t table_id);
@@ -44,24 +114,106 @@ void buffer_write_page(int64_t table_id, pagenum_t pagenum, const page_t* src);
 // unlock latch and apply dirty flag
 void buffer_direct_write_page(int64_t table_id, pagenum_t pagenum, bool is_dirty);
 
+// Hint that given contiguous pages will be read soon
+// pages are read into clean frames asynchronously by background readahead thread
+void buffer_prefetch_pages(int64_t table_id, pagenum_t pagenum, uint64_t count);
+
+// Prefetch pages of given table file listed in warm-up file
+// pages are read in page number order with large vectored reads by background readahead thread
+// only unused frames are filled, so warm-up stops when buffer is full
+void buffer_warm_up_table(int64_t table_id);
+
+// Set readahead window size (number of pages), 0 disables sequential readahead
+void buffer_set_readahead_pages(int num_pages);
+
+// Set access strategy of calling thread
+// with non-zero ring size, its buffer misses recycle a private ring of that many frames
+// (frame used by other operation meanwhile is replaced in ring by normal victim)
+// so it takes at most that many frames from working set of buffer
+// 0 means normal replacement (default)
+void buffer_set_ring_size(int num_frames);
+
+// Get ring size of calling thread's access strategy (0 if it uses normal replacement)
+int buffer_get_ring_size();
+
+// Set frame quota of table file holding given table (tables in a tablespace share it)
+// other tables' misses don't evict its pages while it has min_frames or less pages in buffer (0 means none)
+// and its misses replace its own page once it has max_frames pages in buffer (0 means no limit)
+// quota is only a preference, any frame is evicted if every candidate is against it
+// (pages above lowered max are moved to front of LRU list, so they are evicted first)
+// return 0 if success or -1 if quota is invalid
+int buffer_set_table_quota(int64_t table_id, int min_frames, int max_frames);
+
+// Get the number of frames holding pages of table file holding given table
+int buffer_get_table_frames(int64_t table_id);
+
+// Set memory size (bytes) of compressed cache of evicted pages, 0 disables it (default)
+// evicted pages are compressed into it and buffer misses are served from it before reading file
+// shrinking drops least recently cached pages
+void buffer_set_compressed_cache_size(size_t max_bytes);
+
+// Get the number of pages and bytes (with index overhead) in compressed cache
+void buffer_get_compressed_cache_usage(size_t* number_of_pages, size_t* bytes);
+
+// Drop frames of pages in [begin, end) of given table without write-back
+// used when pages are moved or cut off from file
+void buffer_discard_pages(int64_t table_id, pagenum_t begin, pagenum_t end);
+
+// Flush all dirty frames to disk without eviction (checkpoint)
+// pages are sorted and contiguous ones are coalesced into vectored writes,
+// one thread per table file, other threads keep running meanwhile
+void buffer_flush_all_frames();
+
 // Flush all and destroy
 void buffer_close_table_file();
 
 //inner struct and function used in BufferManager
 namespace BM{
 
-    //buffer control block structure
-    struct ctrl_blk{
-        frame_t* frame_ptr; //point to real frame(page)
-        int64_t table_id;
-        pagenum_t pagenum;
-        blknum_t lru_prv_blk_number; //prev block number in LRU list or -1 if not existed
-        blknum_t lru_nxt_blk_number; //next block number in LRU list or -1 if not existed
-        bool is_dirty; //set on if it need flush (identify content's changes)
-        pthread_rwlock_t page_latch = PTHREAD_RWLOCK_INITIALIZER; //identify this buffer is-use
-        pthread_cond_t cond = PTHREAD_COND_INITIALIZER; //cond var for sleeping
+    //buffer control block structure (hot part)
+    //frame of block n is frame_list[n] and its LRU links are lru_list[n]
+    //pinned block (page latch is held through API) is out of LRU list,
+    //so LRU list holds evictable blocks only and its front is the victim
+    struct alignas(32) ctrl_blk{
+        int64_t table_id = 0;
+        pagenum_t pagenum = 0;
+        std::atomic<uint32_t> latch{0}; //page latch word (LATCH_* bits, 0 means free)
+        uint32_t pin_count = 0; //number of holders of page (protected by buffer manager latch)
+        bool is_dirty = false; //set on if it need flush (identify content's changes)
+        std::atomic<bool> is_prefetched{false}; //set on if page is read by readahead and not accessed yet
+        std::atomic<bool> is_referenced{false}; //set on by hit without buffer manager latch (second chance in victim search)
+        bool is_io_pinned = false; //set on while pinned by readahead or checkpoint I/O (released without caller)
     };
 
+    static_assert(sizeof(BM::ctrl_blk) == 32, "control block should fit in half cache line");
+
+    //LRU links of unpinned control block (cold part)
+    struct lru_node{
+        blknum_t prv; //prev block number in LRU list or -1 if not existed
+        blknum_t nxt; //next block number in LRU list or -1 if not existed
+    };
+
+    //page latch (reader-writer latch in one word)
+    //try functions return 0 on success or EBUSY like pthread_rwlock_try*lock
+    int latch_try_exclusive(std::atomic<uint32_t>* latch);
+    int latch_try_shared(std::atomic<uint32_t>* latch);
+
+    //release exclusive or shared hold and wake up sleeping threads
+    void latch_unlock(std::atomic<uint32_t>* latch);
+
+    //wait until latch word changes (caller failed try function)
+    //caller holds buffer manager latch, it is released while waiting and acquired again
+    //spin a while first, then sleep on futex
+    void latch_wait(std::atomic<uint32_t>* latch);
+
+    extern frame_t* frame_list;
+    extern ctrl_blk* ctrl_blk_list;
+
+    //get frame of given control block
+    inline frame_t* get_frame(const ctrl_blk* blk){
+        return &BM::frame_list[blk - BM::ctrl_blk_list];
+    }
+
     //inner structure for hashing pair object
     //hash algorithm used in boost lib + std::hash
     // https://www.boost.org/doc/libs/1_64_0/boost/functional/hash/hash.hpp
@@ -70,6 +222,15 @@ namespace BM{
         size_t operator()(const std::pair<T1, T2>& p) const;
     };
 
+    //one stripe of hash table
+    //writers hold buffer manager latch and stripe latch exclusively,
+    //so holder of buffer manager latch reads it without stripe latch
+    //and reader without buffer manager latch holds stripe latch shared
+    struct alignas(64) hash_table_stripe{
+        pthread_rwlock_t latch = PTHREAD_RWLOCK_INITIALIZER;
+        __gnu_pbds::gp_hash_table<page_id, blknum_t, BM::hash_pair> table;
+    };
+
     //header page(first page) structure
     struct header_page_t{
         pagenum_t free_page_number; //point to the first free page(head of free page list) or indicate no free page if 0
@@ -90,26 +251,220 @@ namespace BM{
         BM::free_page_t _free_page;
     };
 
+    static_assert(sizeof(BM::header_page_t) == PAGE_SIZE, "header page size mismatch");
+    static_assert(sizeof(BM::free_page_t) == PAGE_SIZE, "free page size mismatch");
+
+    //readahead request (read count pages from pagenum)
+    struct readahead_req{
+        int64_t table_id;
+        pagenum_t pagenum;
+        uint64_t count;
+        bool is_warmup; //fill unused frames only
+        bool is_bulk; //requested by bulk operation (pages go to front of LRU list)
+    };
+
+    //page in compressed cache
+    struct compressed_page{
+        std::vector<uint8_t> data; //compressed page
+        std::list<page_id>::iterator lru_it; //position in compressed cache LRU list
+    };
+
+    //frame in ring of bulk operation
+    //page put into frame is kept to detect frame taken by other operation
+    struct ring_slot{
+        blknum_t blknum;
+        page_id pid;
+    };
+
+    //buffer access strategy of one thread
+    struct access_strategy{
+        size_t ring_size = 0; //0 means normal replacement
+        std::vector<BM::ring_slot> ring;
+        size_t cursor = 0; //next slot to recycle once ring is full
+    };
+
+    //frame quota and usage of table file
+    struct table_quota{
+        size_t min_frames = 0; //0 means none
+        size_t max_frames = 0; //0 means no limit
+        size_t frames = 0; //number of its pages in hash table
+    };
+
+    //sequential access detector per table
+    struct readahead_state{
+        pagenum_t last_miss_pagenum; //pagenum of last buffer miss
+        int seq_count; //number of consecutive sequential misses
+    };
+
+    //reserve address space of given length (MAP_NORESERVE)
+    //memory is taken from system on first touch
+    //return address or null if fail
+    void* reserve_memory(size_t length);
+
+    //map given length of hugetlb pages (length should be multiple of HUGE_PAGE_SIZE)
+    //return address or null if system has no such free huge pages
+    void* map_huge_pages(size_t length);
+
+    //reserve memory in given huge page mode
+    //length is rounded up to HUGE_PAGE_SIZE for explicit huge pages
+    //mode is lowered to the mode actually used on fallback
+    //return address or null if fail
+    void* alloc_memory(size_t* length, int* mode);
+
+    //connect given block to front (next victim) or end (MRU) of LRU list
+    void link_blk(blknum_t blknum, bool is_front);
+
+    //init control block and connect it to front of LRU list (unused frame)
+    void add_blk(blknum_t blknum);
+
+    //disconnect given block from LRU list
+    void unlink_blk(blknum_t blknum);
+
+    //pin given block (first pin takes it out of LRU list)
+    void pin_blk(blknum_t blknum);
+
+    //unpin given block (last unpin puts it at end of LRU list)
+    void unpin_blk(blknum_t blknum);
+
+    //unpin given block, last unpin puts it back right after prv if prv is still in LRU list
+    //(prv -1 means front of LRU list, otherwise it goes to end like unpin_blk)
+    void unpin_blk_after(blknum_t blknum, blknum_t prv);
+
+    //find block pinned by readahead or checkpoint I/O
+    //return its number or -1 if every pin is held by caller of buffer API
+    blknum_t find_io_pinned_blk();
+
+    //dirty pages of one table file in a checkpoint batch
+    struct flush_job{
+        int64_t table_id;
+        std::vector<blknum_t> blks; //pinned and shared locked, sorted by pagenum
+        bool is_failed;
+    };
+
+    //write pages of flush job with vectored writes of contiguous runs (thread function)
+    void* flush_thread_func(void* arg);
+
+    //write back given dirty pages (sorted by page id) as one batch
+    //free ones are pinned and shared locked (dirty flag cleared) under buffer manager latch
+    //and written without it (pinned frames are out of LRU list, so victim search never waits on them), busy ones are written one by one afterwards
+    //(waiting for page latch while holding others could deadlock with tree operation)
+    //throw msg if write fails (pages stay dirty)
+    void flush_blks(const std::pair<page_id, blknum_t>* dirty, size_t count);
+
     //flush frame in given control block 
+    //(its compressed copy is dropped, it's old content)
     void flush_frame_to_file(blknum_t blknum);
 
+    //compress page of given block into compressed cache (no-op if cache is disabled)
+    //block should hold clean page being evicted, caller holds buffer manager latch
+    //page which still has its compressed copy is only moved to end of cache LRU list
+    void put_page_into_compressed_cache(blknum_t blknum);
+
+    //decompress page in compressed cache into dest (caller holds buffer manager latch)
+    //return true if page was cached
+    bool read_page_from_compressed_cache(const page_id& pid, page_t* dest);
+
+    //drop pages in [begin, end) of given table from compressed cache (caller holds buffer manager latch)
+    void erase_from_compressed_cache(int64_t table_id, pagenum_t begin, pagenum_t end);
+
+    //drop least recently cached pages until cache fits in max_bytes
+    void shrink_compressed_cache(size_t max_bytes);
+
+    //get hash table stripe of given page
+    hash_table_stripe* get_hash_table_stripe(const page_id& pid);
+
     //find ctrl block number in hash table
     //where it's pagenum and table id is same with given parameter
+    //caller holds buffer manager latch
     //return ctrl block number or -1 if not found
     blknum_t find_ctrl_blk_in_hash_table(int64_t table_id, pagenum_t pagenum);
 
+    //insert or erase page in hash table (caller holds buffer manager latch)
+    //frame count of its table is updated together
+    //erase returns true if page was in hash table
+    void insert_into_hash_table(const page_id& pid, blknum_t blknum);
+    bool erase_from_hash_table(const page_id& pid);
+
+    //erase every page in hash table
+    void clear_hash_table();
+
+    //copy cached page into dest without buffer manager latch (buffer hit fast path)
+    //block is found through stripe latch and checked again under shared page latch,
+    //since it can be evicted between them
+    //return false if page isn't cached or it is locked, prefetched or changed (take slow path)
+    //only for no lock read, pinning reads and writes take buffer manager latch (pin counts own LRU list)
+    bool read_cached_page(int64_t table_id, pagenum_t pagenum, page_t* dest);
+
+    //check if given block holds page of table file which has min_frames or less pages in buffer
+    bool is_protected_blk(blknum_t blknum);
+
+    //find victim block for miss of given table following quotas
+    //table at its max quota takes its own least recently used page,
+    //others skip pages of table below its min quota (moved to end of LRU list, so skipped once)
+    //return ctrl block number (pinned and write locked) or -1 if no quota is set or no block matches
+    blknum_t find_victim_blk_in_quota(int64_t table_id);
+
     //find victim block for eviction by following the LRU policy
+    //take front of LRU list (unpinned blocks only) in constant time
+    //(block referenced by fast path hit is moved to end once instead,
+    //and block latched by fast path reader or checkpoint writer right now is skipped)
+    //quotas are honored first if any table has one (see find_victim_blk_in_quota)
+    //and return it pinned and write locked
     //return ctrl block number or -1 if not found(i.e. all pinned)
-    blknum_t find_victim_blk_from_buffer();
+    blknum_t find_victim_blk_from_buffer(int64_t table_id);
+
+    //give back victim block which is not used
+    //(unlock, unpin and put it to front of LRU list again)
+    void release_victim_blk(blknum_t blknum);
+
+    //take next frame of calling thread's ring for its miss
+    //frame is recycled only if it still holds the page ring put there and nobody uses it
+    //return ctrl block number (pinned and write locked) or -1 if ring isn't full or frame is taken
+    blknum_t find_victim_blk_in_ring();
+
+    //record frame given to calling thread's miss in its ring (no-op without ring)
+    void put_blk_into_ring(blknum_t blknum, const page_id& pid);
 
     //move given block to end of LRU list
     //by reconnecting some block's pointer
-    //caused by page access
+    //caused by page access (pinned block is out of list, so it's left as it is)
     void move_blk_to_end(blknum_t blknum);
 
+    //move given block to front of LRU list (next victim)
+    //used for page read ahead for bulk operation (pinned block is left as it is)
+    void move_blk_to_front(blknum_t blknum);
+
+    //push readahead request into queue and wake readahead thread
+    //drop request if queue is full (it is only a hint)
+    void push_readahead_req(int64_t table_id, pagenum_t pagenum, uint64_t count);
+
+    //update sequential access detector on buffer miss
+    //and request readahead if access is sequential
+    //caller should hold buffer manager latch
+    void detect_sequential_miss(int64_t table_id, pagenum_t pagenum);
+
+    //read pages of given request into clean victim frames
+    //frames are claimed(hashed, pinned and write locked) under buffer manager latch
+    //and read without buffer manager latch, so readers of them wait on page latch
+    void do_readahead(const readahead_req& req);
+
+    //load page list of warm-up file (at most BUFFER_SIZE most recently used pages)
+    void load_warmup_file();
+
+    //save resident pages into warm-up file (caller holds buffer manager latch)
+    void save_warmup_file();
+
+    //background readahead thread function
+    void* readahead_thread_func(void* arg);
+
+    //start/stop background readahead thread
+    void start_readahead_thread();
+    void stop_readahead_thread();
+
     //get ctrl block from buffer (core function)
     //find block in buffer or get from disk
     //return control block pointer or
     //throw msg if it can't evict
-    ctrl_blk* get_ctrl_blk_from_buffer(int64_t table_id, pagenum_t pagenum);
+    //is_miss is set if page is loaded from disk (hits and misses are counted by caller)
+    ctrl_blk* get_ctrl_blk_from_buffer(int64_t table_id, pagenum_t pagenum, bool* is_miss = nullptr);
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "bpt.h"
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#define COMPACTION_BATCH_PAGES 16 //max number of page moves while holding tree structure latch
+#define COMPACTION_BACKOFF_US 1000 //sleep time when tree is busy or page is locked
+#define COMPACTION_MAX_RETRY 1000 //give up after this many consecutive busy batches
+
+//Move live pages of table to the front of file in tree order
+//(internal pages in level order, then leaf pages in key order)
+//and truncate free pages at the tail of file.
+//Foreground operations keep running, page moves are done in small batches
+//and at most max_pages_per_sec pages are moved per second (0 means no limit).
+//Tablespace holding tables other than table 0 can't be compacted.
+//Compressed table file doesn't shrink by the number of cut pages,
+//since only free slots at its end are cut off (see file_truncate_table_file).
+//Return the number of pages cut off from file, or negative value if failed.
+int64_t cm_compact_table(int64_t table_id, int max_pages_per_sec = 0);
+
+//inner struct and function used in Compaction
+namespace CM{
+    //compaction state kept across batches
+    struct compaction_t{
+        int64_t table_id;
+        std::vector<pagenum_t> order; //live pages in target order (order[i] should be at page i+1)
+        size_t number_of_internal_pages; //order[0, number_of_internal_pages) is internal page
+        std::unordered_map<pagenum_t, size_t> position; //page number -> index in order
+        std::set<pagenum_t> free_pages; //free page list (sorted, same as file)
+        uint64_t free_list_epoch; //free list epoch when free_pages is made
+        uint64_t number_of_pages; //number of pages in file when free_pages is made
+        size_t cursor; //order[0, cursor) are already in place
+    };
+
+    //walk tree from root and make live page order
+    //internal pages in level order, then leaf pages in key order
+    void make_page_order(compaction_t* cm);
+
+    //reload free page list if it is changed by foreground alloc or free
+    //(make it sorted so the smallest free page is always the head)
+    void refresh_free_pages(compaction_t* cm);
+
+    //take the smallest free page from free page list
+    //return its page number or 0 if list is empty
+    pagenum_t take_first_free_page(compaction_t* cm);
+
+    //put given page into free page list at sorted position
+    void put_free_page(compaction_t* cm, pagenum_t pagenum);
+
+    //check given page can be moved now
+    //leaf page locked by active transaction (explicit or implicit) can't be moved
+    //nor can leaf page while lock manager latch is busy (commit or abort is running)
+    bool is_page_movable(compaction_t* cm, pagenum_t pagenum);
+
+    //copy page to dst (free page already taken from list)
+    //and fix root, parent, child and left sibling pointers to point dst
+    //src page is dropped from buffer but not put into free page list
+    void move_page(compaction_t* cm, size_t idx, pagenum_t dst);
+
+    //do page moves while holding tree structure latch
+    //return the number of moved pages, 0 if everything is in place
+    //or -1 if it should retry later (page is locked)
+    int compact_batch(compaction_t* cm, int max_moves);
+}
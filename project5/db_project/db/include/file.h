@@ -1,19 +1,76 @@
 #pragma once
 #include "page.h"
 #include "wildcard.h"
+#include "lz.h"
+#include "storage.h"
+#include "stats.h"
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <errno.h>
 #include <unistd.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <time.h>
 #include <utility>
+#include <algorithm>
+#include <vector>
+#include <unordered_map>
 
-#define DEFAULT_PAGE_NUMBER 2560 //10MiB INIT DB SIZE
+#define DEFAULT_PAGE_NUMBER ((10 << 20) / PAGE_SIZE) //10MiB INIT DB SIZE (2560 pages in 4KiB page)
 #define MAX_DB_FILE_NUMBER 32 //max number of table
 
+#define DEFAULT_SYNC_INTERVAL_MS 1000 //period of background fdatasync
+#define MAX_IOV_PAGES 64 //max number of pages in one vectored I/O
+
+//table file is a tablespace that can hold many tables (B+trees)
+//table id = (table number << TABLE_NUMBER_SHIFT) | table id of table file
+//table number 0 is the table rooted at header page (table id of table file itself)
+//tables in one tablespace share file descriptor, pages and free page list
+#define TABLE_NUMBER_SHIFT 32
+
+//open flag for table file
+//flags can be combined with bitwise or
+#define FILE_DEFAULT_FLAG 0 //buffered I/O through kernel page cache, O_SYNC durability
+#define FILE_DIRECT_IO_FLAG 1 //bypass kernel page cache (O_DIRECT)
+#define FILE_PERIODIC_SYNC_FLAG 2 //periodic fdatasync durability instead of O_SYNC
+#define FILE_CHECKPOINT_SYNC_FLAG 4 //flush-on-checkpoint durability instead of O_SYNC
+#define FILE_READ_ONLY_MMAP_FLAG 8 //read-only table read directly from memory mapping
+#define FILE_COMPRESSION_FLAG 16 //store pages compressed (only when new table file is created)
+
+//compressed table file
+//header page is stored raw at page 0 and marked with COMPRESSED_FILE_MAGIC
+//other pages are stored in variable-sized slots (multiple of sector) after header page
+//slot: [slot header][compressed page image], newest slot(largest sequence) of each page is valid
+#define COMPRESSED_FILE_MAGIC 0x325a50432d425044ULL //"DPB-CPZ2"
+#define COMPRESSED_FILE_MAGIC_V1 0x315a50432d425044ULL //"DPB-CPZ1" (slot without checksum, not supported)
+#define COMPRESSED_SLOT_MAGIC 0x534c4f54 //"TOLS"
+#define COMPRESSION_SECTOR_SIZE 512 //slot size unit
+#define COMPRESSION_SCAN_CHUNK_SIZE (1 << 20) //read size when scanning slots on open
+
+//durability guarantee of each mode
+//(only for page writes that reached the file layer,
+// dirty frames in buffer are written back on eviction, db_flush_all or shutdown)
+//O_SYNC(default): every page write is on the device when file_write_page returns
+//periodic: every page write is on the device within one sync interval after it returns
+//          (a crash can lose writes of the last interval)
+//checkpoint: page writes are on the device only after file_sync_table_files
+//            (db_flush_all) or close returns
+//            (a crash can lose every write after the last checkpoint)
+
 // Open existing table file or create one if it doesn't exist
-int64_t file_open_table_file(const char* pathname);
+// flag is combination of FILE_*_FLAG
+int64_t file_open_table_file(const char* pathname, int flag = FILE_DEFAULT_FLAG);
+
+// Get table id of table file (tablespace) holding given table
+int64_t file_get_space_id(int64_t table_id);
+
+// Get table number of given table in its tablespace
+uint32_t file_get_table_number(int64_t table_id);
 
 // Allocate an on-disk page from the free page list
 pagenum_t file_alloc_page(int64_t table_id);
@@ -27,24 +84,138 @@ void file_read_page(int64_t table_id, pagenum_t pagenum, page_t* dest);
 // Write an in-memory page(src) to the on-disk page
 void file_write_page(int64_t table_id, pagenum_t pagenum, const page_t* src);
 
+// Read count contiguous on-disk pages starting from pagenum into dests[0..count-1]
+// (one vectored I/O instead of count reads)
+void file_read_pages(int64_t table_id, pagenum_t pagenum, uint64_t count, page_t* const* dests);
+
+// Write srcs[0..count-1] into count contiguous on-disk pages starting from pagenum
+// (one vectored I/O instead of count writes, so O_SYNC table syncs once)
+void file_write_pages(int64_t table_id, pagenum_t pagenum, uint64_t count, const page_t* const* srcs);
+
+// Get the number of pages in table file (boundary of valid pagenum)
+uint64_t file_get_number_of_pages(int64_t table_id);
+
+// Get canonical path of table file holding given table
+// (valid until table file is closed)
+const char* file_get_table_path(int64_t table_id);
+
+// Get free page list version of table
+// it changes whenever file_alloc_page or file_free_page changes the list
+uint64_t file_get_free_list_epoch(int64_t table_id);
+
+// Rewrite free page list in ascending page number order (no write if already sorted)
+// return free page numbers in ascending order
+std::vector<pagenum_t> file_sort_free_page_list(int64_t table_id);
+
+// Insert given page into free page list right after prev_pagenum (0 means head of the list)
+// it doesn't change free list epoch
+void file_link_free_page(int64_t table_id, pagenum_t prev_pagenum, pagenum_t pagenum);
+
+// Remove given free page from free page list, prev_pagenum should be its predecessor (0 means head)
+// it doesn't change free list epoch
+void file_unlink_free_page(int64_t table_id, pagenum_t prev_pagenum, pagenum_t pagenum);
+
+// Shrink table file to given number of pages
+// every page from number_of_pages should be free (or unused) page
+// compressed table file shrinks only by free slots at its end (slots of cut pages elsewhere are reused)
+void file_truncate_table_file(int64_t table_id, uint64_t number_of_pages);
+
+//I/O statistics of compressed table
+struct file_compression_stats_t{
+    uint64_t logical_read_bytes; //page bytes requested to read
+    uint64_t logical_write_bytes; //page bytes requested to write
+    uint64_t physical_read_bytes; //slot bytes read from file
+    uint64_t physical_write_bytes; //slot bytes written to file
+    uint64_t compress_ns; //CPU time spent in compression
+    uint64_t decompress_ns; //CPU time spent in decompression
+    uint64_t number_of_raw_pages; //written pages that don't shrink (stored raw)
+    uint64_t number_of_bad_slots; //torn or corrupted slots skipped when file was opened
+    uint64_t file_bytes; //current file size
+};
+
+// Get I/O statistics of compressed table
+// return 0 if success or -1 if given table isn't compressed table
+int file_get_compression_stats(int64_t table_id, file_compression_stats_t* stats);
+
+// Get page pointer in memory mapping of read-only mmap table
+// return null if given table is not opened with FILE_READ_ONLY_MMAP_FLAG
+const page_t* file_get_mapped_page(int64_t table_id, pagenum_t pagenum);
+
+// Hint that given pages of read-only mmap table will be read soon
+// (start reading them asynchronously)
+void file_prefetch_mapped_pages(int64_t table_id, pagenum_t pagenum, uint64_t count);
+
+// Make all page writes of non-O_SYNC table files durable (fdatasync)
+void file_sync_table_files();
+
+// Set period of background fdatasync for FILE_PERIODIC_SYNC_FLAG tables
+void file_set_sync_interval(int interval_ms);
+
+// Set storage backend of table files opened (or created) after this call
+// null means POSIX file backend (default)
+// tables already opened keep their backend
+void file_set_storage_backend(const storage_backend_t* backend);
+
+// Remove table file of given path through current storage backend (file should be closed)
+// return 0 if success or -1 if fail
+int file_remove_table_file(const char* pathname);
+
 // Close the database file
 void file_close_table_file();
 
 //inner struct and function used in DiskSpaceManager
 namespace DSM{
+    //compressed slot header structure
+    struct slot_header_t{
+        uint32_t magic; //COMPRESSED_SLOT_MAGIC
+        uint16_t length; //length of page image (PAGE_SIZE means stored raw)
+        uint16_t sectors; //slot size in sector
+        pagenum_t pagenum; //logical page number
+        uint64_t sequence; //write sequence (newest slot is valid)
+        uint32_t checksum; //CRC-32C of slot header (this field 0) and page image
+        uint32_t __reserved__;
+    };
+
+    //physical location of page in compressed table file
+    struct slot_location_t{
+        uint64_t offset; //file offset of slot
+        uint16_t sectors; //slot size in sector
+        uint64_t sequence; //write sequence of slot
+    };
+
+    //compressed table state
+    struct compression_t{
+        pthread_mutex_t latch = PTHREAD_MUTEX_INITIALIZER; //protect everything below
+        std::unordered_map<pagenum_t, slot_location_t> page_map; //logical pagenum -> slot
+        std::vector<std::vector<uint64_t>> free_slots; //free slot offsets by size in sector
+        std::vector<slot_location_t> superseded_slots; //old slots kept until new ones are durable (lazy sync table)
+        uint64_t end_offset; //end of last slot (append position)
+        uint64_t next_sequence; //sequence of next slot write
+        file_compression_stats_t stats;
+    };
+
     //table(file) info struct
     struct table_info{
         int64_t table_id;
         char *path; //path to database file
         int fd; //file descriptor
-        
+        int flag; //open flag (FILE_*_FLAG)
+        uint64_t number_of_pages; //cached number of pages in header page (use for boundary check)
+        page_t* mapped_pages; //memory mapped file (read-only mmap table) or null
+        size_t mapped_size; //length of memory mapping
+        uint64_t free_list_epoch; //increased on every alloc and free (detect free list change)
+        compression_t* compression; //compressed table state or null
+        const storage_backend_t* backend; //storage backend of file
     };
 
     //header page(first page) structure
     struct header_page_t{
         pagenum_t free_page_number; //point to the first free page(head of free page list) or indicate no free page if 0
         uint64_t number_of_pages; //the number of pages paginated in db file
-        uint8_t __reserved__[PAGE_SIZE - sizeof(pagenum_t) - sizeof(uint64_t)]; //not used for now
+        pagenum_t __root_page_number__; //used by index layer (index layer also uses reserved area for catalog)
+        uint64_t page_size; //PAGE_SIZE of file (0 in file made before page size is recorded)
+        uint8_t __reserved__[PAGE_SIZE - 2*sizeof(pagenum_t) - 3*sizeof(uint64_t)]; //not used for now
+        uint64_t format_magic; //file format (COMPRESSED_FILE_MAGIC or 0 for raw page file)
     };
 
     //free page structure
@@ -60,6 +231,11 @@ namespace DSM{
         DSM::free_page_t _free_page;
     };
 
+    static_assert(sizeof(DSM::header_page_t) == PAGE_SIZE, "header page size mismatch");
+    static_assert(sizeof(DSM::free_page_t) == PAGE_SIZE, "free page size mismatch");
+    static_assert(sizeof(DSM::slot_header_t) + PAGE_SIZE <= (PAGE_SIZE / COMPRESSION_SECTOR_SIZE + 1) * COMPRESSION_SECTOR_SIZE,
+        "raw page image doesn't fit in largest slot");
+
     //check given file descriptor is valid(is this fd opened and not closed by DSM before)
     bool is_file_opened(int fd);
     //check given path is opened(is this pathed opened and not closed by DSM before)
@@ -72,12 +248,95 @@ namespace DSM{
     //init given page to free page format
     void init_free_page(page_t* pg, pagenum_t nxt_page_number);
     
+    //get table info corresponding to given file descriptor, if not existed return null
+    table_info* find_table_info(int fd);
+
+    //get thread-local page aligned in PAGE_SIZE
+    //used as bounce buffer when caller's page is not aligned for direct I/O
+    page_t* get_aligned_bounce_page();
+
+    //get storage backend of given file descriptor
+    //file being opened (not in list yet) uses current storage backend
+    const storage_backend_t* get_backend(int fd);
+
+    //get slot size in sector for page image of given length
+    uint16_t get_slot_sectors(uint16_t length);
+
+    //update CRC-32C (Castagnoli) with given data
+    uint32_t crc32c(uint32_t crc, const void* data, size_t length);
+
+    //get checksum of slot (header length should be checked before)
+    uint32_t get_slot_checksum(const uint8_t* slot);
+
+    //scan all slots in compressed table file
+    //and build page map and free slot lists
+    //torn or corrupted slot is skipped (by its size if header is sane, otherwise by one sector)
+    void load_compressed_slots(table_info* info);
+
+    //free slot whose page has newer image or is dropped (YOU SHOULD HOLD compression latch)
+    //on lazy sync table it's kept until next sync, so it stays valid on device until newer image is durable
+    void free_superseded_slot(table_info* info, const slot_location_t& loc);
+
+    //sync table file and free slots superseded before sync
+    //return 0 if success or -1 if fail
+    int sync_table_file(table_info* info);
+
+    //compress page and write it into new slot
+    //old slot of the page is freed after new slot is written (see free_superseded_slot)
+    void store_compressed_page(table_info* info, pagenum_t pagenum, const page_t* src);
+
+    //read slot of page and decompress it
+    //page never written is read as zero page
+    void load_compressed_page(table_info* info, pagenum_t pagenum, page_t* dest);
+
+    //free slots of pages from given pagenum (file truncation)
+    void drop_compressed_pages(table_info* info, pagenum_t begin);
+
+    //cut free slots at the end of slot area off from file
+    void trim_compressed_slots(table_info* info);
+
     //inner function to store page to file
     void store_page_to_file(int fd, pagenum_t pagenum, const page_t* src);
     //inner function to load page from file
     void load_page_from_file(int fd, pagenum_t pagenum, page_t* dest);
+    //inner function to load contiguous pages from file with vectored I/O
+    void load_pages_from_file(int fd, pagenum_t pagenum, uint64_t count, page_t* const* dests);
+    //inner function to store contiguous pages to file with vectored I/O
+    void store_pages_to_file(int fd, pagenum_t pagenum, uint64_t count, const page_t* const* srcs);
 
     //get file descriptor corresponding to given table id, if not existed return -1
     int get_file_descriptor(int64_t table_id);
+
+    //check given file descriptor is opened as read-only mmap table
+    bool is_read_only_table(int fd);
+
+    //get file descriptor of writable table
+    //throw msg if table id is not valid or table is read-only
+    int get_writable_file_descriptor(int64_t table_id);
+
+    //set next pointer of free page (or header page if pagenum is 0) in free page list
+    void set_nxt_free_page_number(int64_t table_id, int fd, pagenum_t pagenum, pagenum_t nxt_page_number);
+
+    //map whole read-only table file into memory
+    //and set access pattern hint for point lookup
+    void map_table_file(table_info* info);
+
+    //check given table is opened without O_SYNC
+    //(periodic or checkpoint durability)
+    bool is_lazy_sync_table(const table_info* info);
+
+    //get tables opened with any of given flags (YOU SHOULD HOLD file list latch)
+    //entries stay valid until file_close_table_file, which stops sync thread first
+    std::vector<table_info*> get_tables_to_sync(int flag);
+
+    //background sync thread function
+    //fdatasync periodic sync tables every sync interval until stop flag is on
+    void* sync_thread_func(void* arg);
+
+    //start background sync thread if it is not running
+    void start_sync_thread();
+
+    //stop background sync thread and wait for it
+    void stop_sync_thread();
 }
 
@@ -3,14 +3,33 @@
 #include "page.h"
 #include "trx.h"
 #include <pthread.h>
+#include <atomic>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #define SHARED_LOCK_MODE 0
 #define EXCLUSIVE_LOCK_MODE 1
 
+//number of lock table partitions (each has its own latch and hash table)
+#define LOCK_TABLE_PARTITIONS 64
+
+//number of lock objects in one slab of partition lock object pool
+#define LOCK_POOL_SLAB_OBJECTS 64
+
+//returned by inner acquire when lock manager latch is held in shared mode
+//but request needs it in exclusive mode (conflict or implicit lock conversion)
+#define LOCK_RETRY_EXCLUSIVE 1
+
 typedef std::pair<int64_t, pagenum_t> page_id;
 
+//parking slot of thread (one per thread, own cache line)
+//waiting lock points to slot of its owner thread only while it waits
+//thread sleeps on futex of state word until waker clears it
+struct alignas(64) lock_wait_slot_t{
+    std::atomic<uint32_t> state{0}; //1 while thread is parked
+};
+
 //Initialize any data structures required for implementing a lock table, such as a hash table, a lock table latch, etc.
 //If success, return 0. Otherwise, return a non zero value.
 int init_lock_table(void);
@@ -22,26 +41,51 @@ int init_lock_table(void);
 //lock_mode : 0 (SHARED) or 1 (EXCLUSIVE)
 int lock_acquire(int64_t table_id, pagenum_t page_id, int64_t key, uint32_t slot_number, int trx_id, int lock_mode);
 
+//set shared latches the calling thread holds while it calls lock_acquire (null for none)
+//they are released while the thread sleeps for conflicting locks and taken again in order after wake up
+//(index layer passes tree latches so that lock waits don't block structure changes)
+void lock_set_wait_latches(pthread_rwlock_t* outer_latch, pthread_rwlock_t* inner_latch);
+
 //Remove the lock_obj from the lock list.
 //If there is a successor’s lock waiting for the transaction releasing the lock, wake up the successor.
 //If success, return 0. Otherwise, return a non zero value.
 int lock_release(lock_t* lock_obj);
 
 //Remove the all lock_obj in trx list from the lock list.
-//NO lock manager latch lock in this API
-//YOU SHOULD LOCK BEFORE AND UNLOCK AFTER
+//partition latch of each lock is acquired here
+//but lock manager latch is not (YOU SHOULD LOCK BEFORE AND UNLOCK AFTER, shared mode is enough)
 //If success, return 0. Otherwise, return a non zero value.
 int lock_release_all(lock_t* lock_obj);
 
-//acquire global lock manager latch
+//check there is any lock object in the lock list of given page
+//NO lock manager latch lock in this API
+//YOU SHOULD LOCK BEFORE AND UNLOCK AFTER (exclusive mode)
+bool lock_is_page_locked(int64_t table_id, pagenum_t page_id);
+
+//acquire global lock manager latch in exclusive mode
+//which stops every lock table partition
 //If success, return 0. Otherwise, return a non zero value.
 int lock_acquire_lock_manager_latch();
 
-//release global lock manager latch
+//try to acquire global lock manager latch in exclusive mode without waiting
+//for callers holding a latch that commit or abort may wait for (tree structure latch)
+//return 0 if success or non-zero if busy
+int lock_try_acquire_lock_manager_latch();
+
+//acquire global lock manager latch in shared mode
+//partitions keep working, only whole table operations (deadlock detection, implicit lock conversion) wait
+//If success, return 0. Otherwise, return a non zero value.
+int lock_acquire_shared_lock_manager_latch();
+
+//release global lock manager latch (either mode)
 //If success, return 0. Otherwise, return a non zero value.
 int lock_release_lock_manager_latch();
 
-//Destroy lock table
+//get lock object pool counters summed over partitions
+//lock_objects: lock objects handed out, slabs: slabs allocated from heap (LOCK_POOL_SLAB_OBJECTS objects each)
+void lock_get_pool_stats(uint64_t* lock_objects, uint64_t* slabs);
+
+//Destroy lock table (and lock object pool)
 void close_lock_table();
 
 //inner struct and function used in LockManager
@@ -54,6 +98,52 @@ namespace LM{
         size_t operator()(const std::pair<T1, T2>& p) const;
     };
 
+    //slab of lock object pool (starts at cache line)
+    struct alignas(64) lock_slab_t{
+        lock_t locks[LOCK_POOL_SLAB_OBJECTS];
+    };
+
+    //slab of record queue node pool (nodes of merged slots in lock compression)
+    struct alignas(64) lock_queue_node_slab_t{
+        lock_queue_node_t nodes[LOCK_POOL_SLAB_OBJECTS];
+    };
+
+    //lock table partition
+    //lock lists of partition are changed only with its latch and lock manager latch (either mode) held
+    //so exclusive lock manager latch holder can read every partition without partition latch
+    struct alignas(64) lock_table_partition_t{
+        pthread_mutex_t latch = PTHREAD_MUTEX_INITIALIZER; //partition latch
+        std::unordered_map<page_id, lock_head_t*, LM::hash_pair> lock_table; //lock heads of partition
+
+        //lock object pool
+        //lock objects of partition's pages are made and freed under partition latch
+        //so they are recycled here without another latch
+        lock_t* free_locks = nullptr; //recycled lock objects (linked by nxt_lock)
+        std::vector<lock_slab_t*> slabs; //slabs owned by partition
+        uint64_t lock_objects = 0; //lock objects handed out
+
+        //record queue node pool (same rule as lock object pool)
+        lock_queue_node_t* free_nodes = nullptr; //recycled nodes (linked by nxt_node)
+        std::vector<lock_queue_node_slab_t*> node_slabs; //node slabs owned by partition
+    };
+
+    //get partition where lock list of given page lives
+    lock_table_partition_t* get_partition(int64_t table_id, pagenum_t pagenum);
+
+    //get lock object from pool of given partition (new slab when pool is empty)
+    //returned object is default initialized
+    lock_t* alloc_lock_object(lock_table_partition_t* partition);
+
+    //give lock object back to pool of given partition
+    void free_lock_object(lock_table_partition_t* partition, lock_t* lock_obj);
+
+    //get record queue node from pool of given partition (new slab when pool is empty)
+    //returned node is default initialized
+    lock_queue_node_t* alloc_queue_node(lock_table_partition_t* partition);
+
+    //give record queue node back to pool of given partition
+    void free_queue_node(lock_table_partition_t* partition, lock_queue_node_t* node);
+
     //make new lock object
     //and initialize lock object with given parameter
     //return new lock object pointer
@@ -74,20 +164,34 @@ namespace LM{
     //return new lock head object's pointer inserted
     lock_head_t* insert_new_lock_head_in_table(int64_t table_id, pagenum_t pagenum);
 
-    //append lock in the lock list in object's sentinel
+    //get record queue of given slot in lock head (made when not exists)
+    lock_queue_t& get_slot_queue(lock_head_t* lock_head, uint32_t slot_number);
+
+    //link node into record queue right after given node (at the front when prev_node is null)
+    void insert_node_in_slot_queue(lock_queue_t& queue, lock_queue_node_t* prev_node, lock_queue_node_t* node);
+
+    //unlink node from record queue
+    void remove_node_from_slot_queue(lock_queue_t& queue, lock_queue_node_t* node);
+
+    //append lock in the lock list in object's sentinel and record queue of its slot
     //also append in the trx lock list
     void append_lock_in_lock_list(lock_t* lock_obj);
 
-    //remove lock in the lock list in object's sentinel
+    //remove lock in the lock list in object's sentinel and record queues of its bitmap
+    //(through nodes of the lock, nodes of merged slots go back to pool)
     void remove_lock_from_lock_list(lock_t* lock_obj);
 
     //find lock object that compatible with given lock object
-    //in page lock list defined by lock head
+    //in record queue of its slot
     //return object's pointer or null if not found 
     lock_t* find_compatible_lock_in_lock_list(lock_head_t* lock_head, lock_t* lock_obj);
 
-    //find lock object already acquired by given txn for lock compression
-    //in page lock list defined by lock head
+    //check there is lock object of other trx in record queue conflicting with given lock object
+    //(only looks at this record, used before deadlock detection is needed)
+    bool has_conflicting_lock_in_lock_list(lock_head_t* lock_head, lock_t* lock_obj);
+
+    //find S lock object already acquired by given txn for lock compression
+    //in page lock list defined by lock head (looked up in index of lock head)
     //return object's pointer or null if not found 
     lock_t* find_same_trx_lock_in_lock_list(lock_head_t* lock_head, int trx_id);
 
@@ -97,11 +201,14 @@ namespace LM{
     //If there is deadlock, return -1
     //source_trx_id should be first lock object's owner trx id 
     //DO NOT SET is_first flag false at the first time(always return -1)
+    //each step looks only at record queue of the waiting lock's slot
     int detect_deadlock(lock_t* lock_obj, int source_trx_id, bool is_first = true);
 
     //find and wake up the successor
     //if it is waiting for the current transaction releasing the lock
     //and no conflicting transaction left after releasing this lock
+    //only record queues of slots in given lock's bitmap are looked at (from nodes of the lock)
+    //(only the owner thread of the successor is woken, through its wait slot)
     void wake_conflicting_lock_in_lock_list(lock_t* lock_obj);
 
     //convert implicit lock to explicit lock
@@ -114,11 +221,18 @@ namespace LM{
     //remove lock obj when lock compression occurred
     void try_to_lock_compression(lock_t* lock_obj);
     
+    //park calling thread on its wait slot until all conflicting locks are released
+    //caller holds exclusive lock manager latch and partition latch of given lock
+    //both are released while sleeping, lock manager latch is held in shared mode on return
+    void wait_for_conflicting_locks(lock_t* lock_obj);
+
     //Allocate and append a new lock object to the lock list of the record having the page id and the key.
     //If there is a predecessor’s conflicting lock object in the lock list, sleep until the predecessor releases its lock.
     //If there is no predecessor’s conflicting lock object, return 0.
     //If an error occurs, return -1
-    int try_to_acquire_lock_object(int64_t table_id, pagenum_t page_id, int64_t key, uint32_t slot_number, int trx_id, int lock_mode);
+    //caller holds partition latch and lock manager latch (is_exclusive tells the mode)
+    //in shared mode, return LOCK_RETRY_EXCLUSIVE without change when request needs exclusive mode
+    int try_to_acquire_lock_object(int64_t table_id, pagenum_t page_id, int64_t key, uint32_t slot_number, int trx_id, int lock_mode, bool is_exclusive);
 
     //Remove the lock_obj from the lock list.
     //If there is a successor’s lock waiting for the transaction releasing the lock, wake up the successor.
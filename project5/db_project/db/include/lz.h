@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+//LZ77 family block codec (LZ4-like sequence format)
+//sequence: token(literal length 4bit | match length 4bit), [literal length ext],
+//          literals, match offset(2byte LE), [match length ext]
+//last sequence has literals only
+
+#define LZ_HASH_BITS 12 //size of match finder table
+#define LZ_MIN_MATCH 4 //minimum match length
+#define LZ_LAST_LITERALS 5 //last bytes are always literals
+#define LZ_MAX_OFFSET 65535 //max distance of match
+
+// Compress src_size bytes of src into dst which has dst_capacity bytes
+// return compressed size, or 0 if it doesn't fit in dst_capacity
+int lz_compress(const uint8_t* src, int src_size, uint8_t* dst, int dst_capacity);
+
+// Decompress src_size bytes of compressed src into dst which has dst_size bytes
+// return decompressed size, or -1 if src is malformed
+int lz_decompress(const uint8_t* src, int src_size, uint8_t* dst, int dst_size);
+
+//inner function used in LZ codec
+namespace LZ{
+    //read 4 bytes from unaligned position
+    uint32_t read32(const uint8_t* p);
+
+    //hash of 4 bytes sequence
+    uint32_t hash(uint32_t seq);
+
+    //write length extension bytes (255, 255, ..., remainder)
+    //return next output position or null if output is full
+    uint8_t* write_length(uint8_t* op, const uint8_t* op_end, int len);
+
+    //write one sequence (literals and match) into output
+    //match_len 0 means the last sequence (literals only)
+    //return next output position or null if output is full
+    uint8_t* write_sequence(uint8_t* op, const uint8_t* op_end, const uint8_t* literals, int literal_len, int offset, int match_len);
+}
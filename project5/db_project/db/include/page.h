@@ -1,8 +1,27 @@
 #pragma once
 #include <stdint.h>
 #include <pthread.h>
+#include <bitset>
+#include <unordered_map>
+#include <vector>
 
-#define PAGE_SIZE 4096 //4KiB page
+//page size is set at build time (DB_PAGE_SIZE cmake option)
+//table file made with one page size can't be opened with another
+#ifndef DB_PAGE_SIZE
+#define DB_PAGE_SIZE 4096
+#endif
+#define PAGE_SIZE DB_PAGE_SIZE
+
+//in-page offset and value size are stored in uint16_t
+static_assert(PAGE_SIZE >= 4096 && PAGE_SIZE <= 32768 && (PAGE_SIZE & (PAGE_SIZE - 1)) == 0,
+    "PAGE_SIZE should be one of 4096, 8192, 16384 and 32768");
+
+//leaf page layout shared by index and lock manager
+#define PAGE_HEADER_SIZE 128 //128bytes page header
+#define SLOT_SIZE 16 //size of slot in leaf page
+#define MIN_VALUE_SIZE 46 //min size of value
+#define MAX_VALUE_SIZE 108 // max size of value
+#define MAX_SLOT_NUMBER ((PAGE_SIZE - PAGE_HEADER_SIZE) / (SLOT_SIZE + MIN_VALUE_SIZE)) // max # of slot (64 in 4KiB page)
 
 typedef uint64_t pagenum_t; //page_number
 struct page_t {
@@ -10,28 +29,61 @@ struct page_t {
     uint8_t raw_data[PAGE_SIZE];
 };
 
+//bitmap of slots in a leaf page (lock compression)
+typedef std::bitset<MAX_SLOT_NUMBER> slot_bitmap_t;
+
 //lock head declaration for lock object 
 struct lock_head_t;
 
+//parking slot of waiting thread (defined in lock manager)
+struct lock_wait_slot_t;
+
+//lock object declaration for record queue node
+struct lock_t;
+
+//node of record queue (locks of one slot in the order of the list)
+//lock has its own node for the slot it was made for
+//lock compression gives same trx lock one more node (from lock manager pool) for each merged slot
+struct lock_queue_node_t{
+    lock_t *lock = nullptr; //lock that node belongs to
+    lock_queue_node_t *prev_node = nullptr; //previous node in record queue
+    lock_queue_node_t *nxt_node = nullptr; //next node in record queue
+    lock_queue_node_t *nxt_merged_node = nullptr; //next node of same lock (merged slots)
+    uint32_t slot_number = 0; //slot of record queue
+};
+
+//record queue of one slot
+struct lock_queue_t{
+    lock_queue_node_t *head = nullptr; //first node in the queue
+    lock_queue_node_t *tail = nullptr; //last node in the queue
+};
+
 //lock object structure
 struct lock_t{
-    pthread_cond_t cond = PTHREAD_COND_INITIALIZER; //cond var for sleeping
+    lock_wait_slot_t *wait_slot = nullptr; //parking slot of owner thread while lock waits
     lock_t *prev_lock = nullptr; //previous lock in page lock list
     lock_t *nxt_lock = nullptr; //next lock in page lock list
     lock_t *prev_lock_in_trx = nullptr; //prev lock in trx lock list
     lock_t *nxt_lock_in_trx = nullptr; //next lock in trx lock list
     lock_head_t *sentinel = nullptr; //lock header in lock list
     int64_t record_id; //record id that lock refer to
-    uint64_t bitmap; //bitmap for lock compression
+    slot_bitmap_t bitmap; //bitmap for lock compression
+    uint32_t slot_number; //slot that lock was made for
     int lock_mode = 0; //lock mode
     int owner_trx_id = 0; //trx id which try to acquire this lock 
     int waiting_num = 0; //the number of conflicting lock (mark the lock is sleeping or not)
+    lock_queue_node_t slot_node; //node in record queue of slot_number (merged slot nodes follow nxt_merged_node)
 };
 
 //lock header object structure
 struct lock_head_t{
-    int64_t table_id;
-    pagenum_t page_id;
+    int64_t table_id = 0;
+    pagenum_t page_id = 0;
     lock_t *head = nullptr; //first lock in the list
     lock_t *tail = nullptr; //last lock in the list
+    //locks of each slot in the order of the list (compressed lock is in queue of every slot in its bitmap)
+    //grown up to the largest slot locked
+    std::vector<lock_queue_t> slot_queues;
+    //first S lock of each trx in the list (lock compression target)
+    std::unordered_map<int, lock_t*> shared_locks;
 };
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#define STATS_MAX_TABLE_FILE 1024 //table files with id (file descriptor) below this have own counters
+#define STATS_OVERFLOW_TABLE_FILE STATS_MAX_TABLE_FILE //counters of the rest (counted in total only)
+#define STATS_HISTOGRAM_BUCKETS 40 //bucket i counts latency in [2^i, 2^(i+1)) ns
+
+//statistics are collected per thread (shard) without any shared write
+//and summed up when they are read
+//counters of table file are cleared when it is opened
+//table file with id over the range has no own counters, but it is still counted in total
+
+//I/O counters of table file (or sum of all table files)
+//tables in one tablespace share counters of their table file
+struct io_stats_t{
+    uint64_t reads; //read requests to storage (one vectored read is one request)
+    uint64_t writes; //write requests to storage
+    uint64_t read_bytes; //page bytes read
+    uint64_t write_bytes; //page bytes written
+    uint64_t allocs; //allocated pages
+    uint64_t frees; //freed pages
+    uint64_t grows; //file grows (free page list was empty)
+    uint64_t buffer_hits; //page requests served from buffer
+    uint64_t buffer_misses; //page requests read from file
+    uint64_t evictions; //pages evicted from buffer
+    uint64_t dirty_flushes; //dirty frames written back (eviction and checkpoint)
+    uint64_t compressed_hits; //buffer misses served from compressed cache (no read request)
+};
+
+//latency histogram in log2 scale of nanoseconds
+struct latency_histogram_t{
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t buckets[STATS_HISTOGRAM_BUCKETS];
+};
+
+//kind of latency histogram
+#define STATS_FILE_READ 0 //storage read of file layer
+#define STATS_FILE_WRITE 1 //storage write of file layer
+#define STATS_BUFFER_MISS 2 //buffer miss service (eviction write-back and read)
+#define STATS_HISTOGRAM_NUMBER 3
+
+//statistics of whole database
+struct db_stats_t{
+    io_stats_t total; //sum of all table files
+    latency_histogram_t latency[STATS_HISTOGRAM_NUMBER]; //indexed by STATS_* kind
+};
+
+// Get statistics of whole database
+void stats_get(db_stats_t* stats);
+
+// Get I/O counters of table file holding given table
+// return 0 if success or -1 if table file has no own counters
+int stats_get_table(int64_t table_id, io_stats_t* stats);
+
+// Get buffer hit ratio (hits over page requests) of given counters, 0 if there is no request
+double stats_get_hit_ratio(const io_stats_t* stats);
+
+// Get upper bound (ns) of latency at given quantile (0 <= q <= 1) of histogram
+uint64_t stats_get_percentile(const latency_histogram_t* hist, double q);
+
+// Clear counters of table file (called when it is opened)
+void stats_reset_table(int64_t table_id);
+
+// Write snapshot of statistics to given file every interval_ms (appending)
+// null path or non-positive interval stops dumping
+// return 0 if success or -1 if file can't be opened
+int stats_set_dump(const char* path, int interval_ms);
+
+// Stop periodic dump after writing the last snapshot
+void stats_stop_dump();
+
+//inner struct and function used in Statistics
+namespace ST{
+    //counter index in shard
+    enum counter_t{
+        READS, WRITES, READ_BYTES, WRITE_BYTES, ALLOCS, FREES, GROWS,
+        BUFFER_HITS, BUFFER_MISSES, EVICTIONS, DIRTY_FLUSHES, COMPRESSED_HITS,
+        COUNTER_NUMBER
+    };
+
+    //counters written by one thread only
+    //(relaxed load and store is enough, reader may see slightly old value)
+    struct shard_t{
+        std::atomic<uint64_t> counters[STATS_MAX_TABLE_FILE + 1][COUNTER_NUMBER]; //last one is overflow counters
+        std::atomic<uint64_t> histograms[STATS_HISTOGRAM_NUMBER][STATS_HISTOGRAM_BUCKETS];
+        std::atomic<uint64_t> latency_ns[STATS_HISTOGRAM_NUMBER];
+    };
+
+    //measure latency of one operation in its lifetime
+    //record counters and histogram when it goes out of scope
+    struct io_timer_t{
+        int64_t table_id;
+        int kind; //STATS_* kind
+        uint64_t bytes;
+        uint64_t begin_ns;
+        io_timer_t(int64_t table_id, int kind, uint64_t bytes);
+        ~io_timer_t();
+    };
+
+    //monotonic clock in nanoseconds
+    uint64_t now_ns();
+
+    //get shard of calling thread (made on first use)
+    //shard of exited thread is reused by new thread
+    shard_t* get_shard();
+
+    //add n to counter of given table file
+    //table file without own counters goes to overflow counters (warned once)
+    void add(int64_t table_id, counter_t counter, uint64_t n = 1);
+
+    //sum counters at given index over shards
+    void sum_counters(int64_t index, io_stats_t* stats);
+
+    //record one latency sample
+    void record_latency(int kind, uint64_t ns);
+
+    //background dump thread function
+    void* dump_thread_func(void* arg);
+
+    //write one snapshot to file
+    void write_snapshot(FILE* fp);
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+
+//storage backend of table file
+//every file access of disk space manager goes through backend operations
+//operations follow POSIX semantics of same name system call (return -1 and set errno on failure)
+//handle returned by open_file is a file descriptor number unique in process
+//(table id is made from it)
+struct storage_backend_t{
+    const char* name;
+    //canonical path of existing file (malloc-ed string) or null if there is no such file (realpath)
+    char* (*get_path)(const char* pathname);
+    //open or create file (open), O_SYNC and O_DIRECT can be ignored
+    int (*open_file)(const char* pathname, int flags, mode_t mode);
+    int (*close_file)(int fd);
+    ssize_t (*read)(int fd, void* buf, size_t count, uint64_t offset); //pread
+    ssize_t (*write)(int fd, const void* buf, size_t count, uint64_t offset); //pwrite
+    ssize_t (*readv)(int fd, const struct iovec* iov, int iovcnt, uint64_t offset); //preadv
+    ssize_t (*writev)(int fd, const struct iovec* iov, int iovcnt, uint64_t offset); //pwritev
+    int (*sync)(int fd); //fdatasync
+    int (*truncate)(int fd, uint64_t length); //ftruncate
+    int64_t (*get_size)(int fd); //file size (fstat)
+    //read-only mapping of whole file (mmap), return null if failed or not supported
+    void* (*map)(int fd, size_t length);
+    int (*unmap)(void* addr, size_t length);
+    int (*remove_file)(const char* pathname); //unlink
+};
+
+// Get backend storing table files in file system through POSIX I/O (default)
+const storage_backend_t* storage_get_posix_backend();
+
+// Get backend storing table files in process memory
+// files live until removed or process exit, so a table can be closed and opened again
+// nothing is written to disk and sync is no-op
+const storage_backend_t* storage_get_memory_backend();
+
+//latency of one kind of operation
+//each operation waits base_us + exponential random time with mean jitter_us (long tail)
+struct storage_latency_t{
+    uint32_t base_us;
+    uint32_t jitter_us;
+};
+
+//latency injected by latency backend
+struct storage_latency_config_t{
+    storage_latency_t read; //read and readv
+    storage_latency_t write; //write and sync
+    double stall_probability; //probability that an operation stalls additionally
+    uint32_t stall_us; //length of one stall
+    uint32_t seed; //random seed (each thread gets its own stream)
+};
+
+//statistics of latency backend
+struct storage_latency_stats_t{
+    uint64_t number_of_reads;
+    uint64_t number_of_writes;
+    uint64_t number_of_stalls;
+    uint64_t injected_us; //total time slept in backend
+};
+
+// Get backend forwarding every operation to base backend after injected latency
+// there is one latency backend per process, so this replaces previous base and config
+// (set before opening tables through it and don't change while they are open)
+// metadata operations (open, close, size, map, ...) are not delayed
+const storage_backend_t* storage_get_latency_backend(const storage_backend_t* base, const storage_latency_config_t* config);
+
+// Get statistics of latency backend since the last storage_get_latency_backend
+void storage_get_latency_stats(storage_latency_stats_t* stats);
+
+//inner struct and function used in StorageBackend
+namespace SB{
+    //in-memory file
+    //content is kept in anonymous mapping which grows by mremap
+    struct memory_file_t{
+        pthread_rwlock_t latch = PTHREAD_RWLOCK_INITIALIZER; //exclusive only when data is resized
+        uint8_t* data = nullptr; //file content
+        size_t size = 0; //file size
+        size_t capacity = 0; //length of mapping
+        bool is_linked = true; //file has path (not removed)
+        int open_count = 0; //number of open handles
+    };
+
+    //posix backend operations
+    char* posix_get_path(const char* pathname);
+    int posix_open_file(const char* pathname, int flags, mode_t mode);
+    int posix_close_file(int fd);
+    ssize_t posix_read(int fd, void* buf, size_t count, uint64_t offset);
+    ssize_t posix_write(int fd, const void* buf, size_t count, uint64_t offset);
+    ssize_t posix_readv(int fd, const struct iovec* iov, int iovcnt, uint64_t offset);
+    ssize_t posix_writev(int fd, const struct iovec* iov, int iovcnt, uint64_t offset);
+    int posix_sync(int fd);
+    int posix_truncate(int fd, uint64_t length);
+    int64_t posix_get_size(int fd);
+    void* posix_map(int fd, size_t length);
+    int posix_unmap(void* addr, size_t length);
+    int posix_remove_file(const char* pathname);
+
+    //get in-memory file of given handle or null
+    memory_file_t* find_memory_file(int fd);
+
+    //resize in-memory file (caller holds file latch exclusively)
+    //new area is filled with zero
+    //return 0 if success or -1 if fail
+    int resize_memory_file(memory_file_t* file, size_t size);
+
+    //memory backend operations
+    char* memory_get_path(const char* pathname);
+    int memory_open_file(const char* pathname, int flags, mode_t mode);
+    int memory_close_file(int fd);
+    ssize_t memory_read(int fd, void* buf, size_t count, uint64_t offset);
+    ssize_t memory_write(int fd, const void* buf, size_t count, uint64_t offset);
+    ssize_t memory_readv(int fd, const struct iovec* iov, int iovcnt, uint64_t offset);
+    ssize_t memory_writev(int fd, const struct iovec* iov, int iovcnt, uint64_t offset);
+    int memory_sync(int fd);
+    int memory_truncate(int fd, uint64_t length);
+    int64_t memory_get_size(int fd);
+    void* memory_map(int fd, size_t length);
+    int memory_unmap(void* addr, size_t length);
+    int memory_remove_file(const char* pathname);
+
+    //state of latency backend
+    struct latency_state_t{
+        const storage_backend_t* base;
+        storage_latency_config_t config;
+        std::atomic<uint64_t> number_of_reads;
+        std::atomic<uint64_t> number_of_writes;
+        std::atomic<uint64_t> number_of_stalls;
+        std::atomic<uint64_t> injected_us;
+        std::atomic<uint32_t> number_of_streams; //for per-thread random seed
+    };
+
+    //sleep for random time drawn from given latency and stall setting
+    void inject_latency(const storage_latency_t& latency);
+
+    //latency backend operations (delayed ones only, others use base directly)
+    char* latency_get_path(const char* pathname);
+    int latency_open_file(const char* pathname, int flags, mode_t mode);
+    int latency_close_file(int fd);
+    ssize_t latency_read(int fd, void* buf, size_t count, uint64_t offset);
+    ssize_t latency_write(int fd, const void* buf, size_t count, uint64_t offset);
+    ssize_t latency_readv(int fd, const struct iovec* iov, int iovcnt, uint64_t offset);
+    ssize_t latency_writev(int fd, const struct iovec* iov, int iovcnt, uint64_t offset);
+    int latency_sync(int fd);
+    int latency_truncate(int fd, uint64_t length);
+    int64_t latency_get_size(int fd);
+    void* latency_map(int fd, size_t length);
+    int latency_unmap(void* addr, size_t length);
+    int latency_remove_file(const char* pathname);
+}
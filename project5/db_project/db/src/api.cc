@@ -1,7 +1,7 @@
 #include "api.h"
 
-int init_db(int num_buf){
-    int status_code = init_buffer(num_buf);
+int init_db(int num_buf, const char* warmup_pathname){
+    int status_code = init_buffer(num_buf, warmup_pathname);
     init_lock_table();
     init_trx_manager();
     return status_code;
@@ -9,6 +9,7 @@ int init_db(int num_buf){
 
 int shutdown_db(){
     try{
+        stats_stop_dump();
         close_trx_manager();
         close_lock_table();
         buffer_close_table_file();
@@ -20,9 +21,41 @@ int shutdown_db(){
     }
 }
 
-int64_t open_table(char *pathname){
+int db_set_huge_page_mode(int mode){
+    if(mode < BUFFER_HUGE_PAGE_NONE || mode > BUFFER_HUGE_PAGE_EXPLICIT) return -1;
+    buffer_set_huge_page_mode(mode);
+    return 0;
+}
+
+int db_resize_buffer(int num_buf){
+    try{
+        return buffer_resize(num_buf);
+    }catch(const char *e){
+        perror(e);
+        return -1;
+    }
+}
+
+int db_set_compressed_cache_size(uint64_t max_bytes){
+    buffer_set_compressed_cache_size(max_bytes);
+    return 0;
+}
+
+int db_flush_all(){
+    try{
+        buffer_flush_all_frames();
+        file_sync_table_files();
+        return 0;
+    }catch(const char *e){
+        perror(e);
+        return -1;
+    }
+}
+
+int64_t open_table(char *pathname, int flag){
     try{
-        int64_t tid = file_open_table_file(pathname);
+        int64_t tid = file_open_table_file(pathname, flag);
+        buffer_warm_up_table(tid);
         return tid;
     }catch(const char *e){
         perror(e);
@@ -42,6 +75,69 @@ int db_delete(int64_t table_id, int64_t key){
     return idx_delete_by_key(table_id, key);
 }
 
+int db_scan(int64_t table_id, int64_t begin_key, int64_t end_key, scan_callback_t callback, void* arg){
+    return idx_scan_by_range(table_id, begin_key, end_key, callback, arg);
+}
+
+int64_t db_compact_table(int64_t table_id, int max_pages_per_sec){
+    //every page is moved once, so recycle ring frames
+    int ring_size = buffer_get_ring_size();
+    if(!ring_size) buffer_set_ring_size(DEFAULT_RING_FRAMES);
+    int64_t ret_val = cm_compact_table(table_id, max_pages_per_sec);
+    buffer_set_ring_size(ring_size);
+    return ret_val;
+}
+
+int db_begin_bulk(int ring_frames){
+    if(ring_frames < 1) return -1;
+    buffer_set_ring_size(ring_frames);
+    return 0;
+}
+
+int db_end_bulk(){
+    buffer_set_ring_size(0);
+    return 0;
+}
+
+int db_get_stats(db_stats_t* stats){
+    stats_get(stats);
+    return 0;
+}
+
+int db_get_table_stats(int64_t table_id, io_stats_t* stats){
+    return stats_get_table(file_get_space_id(table_id), stats);
+}
+
+int db_set_table_quota(int64_t table_id, int min_frames, int max_frames){
+    try{
+        return buffer_set_table_quota(table_id, min_frames, max_frames);
+    }catch(const char *e){
+        perror(e);
+        return -1;
+    }
+}
+
+int db_get_table_frames(int64_t table_id){
+    try{
+        return buffer_get_table_frames(table_id);
+    }catch(const char *e){
+        perror(e);
+        return -1;
+    }
+}
+
+int db_set_stats_dump(const char* pathname, int interval_ms){
+    return stats_set_dump(pathname, interval_ms);
+}
+
+int64_t db_create_table(int64_t space_id){
+    return idx_create_table(space_id);
+}
+
+int64_t db_get_table(int64_t space_id, uint32_t table_number){
+    return idx_get_table(space_id, table_number);
+}
+
 int db_find(int64_t table_id, int64_t key, char *ret_val, uint16_t *val_size, int trx_id){
     return idx_find_by_key_trx(table_id, key, ret_val, val_size, trx_id);
 }
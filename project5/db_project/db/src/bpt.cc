@@ -1,14 +1,83 @@
 #include "bpt.h"
 
 namespace FIM{
+    //tree structure latches striped by tablespace and by table (no registration on open)
+    //every operation takes space latch before table latch
+    tree_latch_t space_latches[TREE_LATCH_STRIPES];
+    tree_latch_t table_latches[TREE_LATCH_STRIPES];
+
+    pthread_rwlock_t* get_space_latch(int64_t table_id){
+        return &FIM::space_latches[file_get_space_id(table_id) % TREE_LATCH_STRIPES].latch;
+    }
+
+    pthread_rwlock_t* get_table_latch(int64_t table_id){
+        //mix table number in so that tables of one tablespace spread over stripes
+        uint64_t h = file_get_space_id(table_id) + (uint64_t)file_get_table_number(table_id) * 0x9e3779b9;
+        return &FIM::table_latches[h % TREE_LATCH_STRIPES].latch;
+    }
+
+    void lock_tree(int64_t table_id, bool is_structure_changed){
+        pthread_rwlock_rdlock(FIM::get_space_latch(table_id));
+        if(is_structure_changed) pthread_rwlock_wrlock(FIM::get_table_latch(table_id));
+        else pthread_rwlock_rdlock(FIM::get_table_latch(table_id));
+    }
+
+    void unlock_tree(int64_t table_id){
+        pthread_rwlock_unlock(FIM::get_table_latch(table_id));
+        pthread_rwlock_unlock(FIM::get_space_latch(table_id));
+    }
+
+    int acquire_record_lock(int64_t table_id, pagenum_t leaf_page_number, int64_t key, uint32_t slot_number, int trx_id, int lock_mode){
+        lock_set_wait_latches(FIM::get_space_latch(table_id), FIM::get_table_latch(table_id));
+        int ret = lock_acquire(table_id, leaf_page_number, key, slot_number, trx_id, lock_mode);
+        lock_set_wait_latches(nullptr, nullptr);
+        return ret;
+    }
+
+    int64_t find_slot_in_leaf_page(const _fim_page_t* leaf_page, uint32_t slot_number, int64_t key){
+        if(!leaf_page->_leaf_page.page_header.is_leaf) return -1;
+        uint32_t num_keys = leaf_page->_leaf_page.page_header.number_of_keys;
+        if(slot_number < num_keys && leaf_page->_leaf_page.slot[slot_number].key == key) return slot_number;
+        for(uint32_t i = 0; i < num_keys; i++){
+            if(leaf_page->_leaf_page.slot[i].key == key) return i;
+        }
+        return -1;
+    }
+
     pagenum_t make_page(int64_t table_id){
         //get new page from BM
         pagenum_t x = buffer_alloc_page(table_id);
         return x;
     }
 
+    pagenum_t find_catalog_entry(int64_t table_id, uint32_t* entry_index){
+        _fim_page_t header_buf;
+        const _fim_page_t* header_page = FIM::read_page_for_lookup(table_id, 0, &header_buf);
+
+        uint32_t table_number = file_get_table_number(table_id);
+        if(!table_number || table_number > header_page->_header_page.number_of_tables){
+            throw "unvalid table id";
+        }
+        *entry_index = (table_number - 1) % CATALOG_ENTRY_NUMBER;
+        return header_page->_header_page.catalog_page_number[(table_number - 1) / CATALOG_ENTRY_NUMBER];
+    }
+
+    pagenum_t get_root_page(int64_t table_id){
+        _fim_page_t buf;
+
+        //table rooted at header page
+        if(!file_get_table_number(table_id)){
+            return FIM::read_page_for_lookup(table_id, 0, &buf)->_header_page.root_page_number;
+        }
+
+        //table in catalog
+        uint32_t entry_index;
+        pagenum_t catalog_page_number = FIM::find_catalog_entry(table_id, &entry_index);
+        return FIM::read_page_for_lookup(table_id, catalog_page_number, &buf)->_catalog_page.root_page_number[entry_index];
+    }
+
     int change_root_page(int64_t table_id, pagenum_t root_page_number, bool del_tree_flag){
-        _fim_page_t header_page;
+        _fim_page_t page;
         
         if(!del_tree_flag && !root_page_number){
             //you can't set header page number unless indicate the tree is to vanish
@@ -17,10 +86,20 @@ namespace FIM{
         }
 
         try{
-            //set root page in header page
-            buffer_read_page(table_id, 0, &header_page._raw_page, BUFFER_WRITE_LOCK_MODE);
-            header_page._header_page.root_page_number = root_page_number;
-            buffer_write_page(table_id, 0, &header_page._raw_page);
+            if(!file_get_table_number(table_id)){
+                //set root page in header page
+                buffer_read_page(table_id, 0, &page._raw_page, BUFFER_WRITE_LOCK_MODE);
+                page._header_page.root_page_number = root_page_number;
+                buffer_write_page(table_id, 0, &page._raw_page);
+            }
+            else{
+                //set root page in catalog page
+                uint32_t entry_index;
+                pagenum_t catalog_page_number = FIM::find_catalog_entry(table_id, &entry_index);
+                buffer_read_page(table_id, catalog_page_number, &page._raw_page, BUFFER_WRITE_LOCK_MODE);
+                page._catalog_page.root_page_number[entry_index] = root_page_number;
+                buffer_write_page(table_id, catalog_page_number, &page._raw_page);
+            }
             return 0;
         }
         catch(const char* e){
@@ -29,40 +108,79 @@ namespace FIM{
         }
     }
 
+    uint32_t add_table_to_catalog(int64_t space_id){
+        _fim_page_t header_page, catalog_page;
+        buffer_read_page(space_id, 0, &header_page._raw_page, BUFFER_NO_LOCK_MODE);
+
+        uint64_t table_number = header_page._header_page.number_of_tables + 1;
+        if(table_number > MAX_TABLE_NUMBER) throw "catalog is full";
+
+        //every entry of catalog page is 0 (empty tree) when allocated
+        //so only the first table of catalog page needs page I/O
+        pagenum_t catalog_page_number = 0;
+        if((table_number - 1) % CATALOG_ENTRY_NUMBER == 0){
+            catalog_page_number = FIM::make_page(space_id);
+            memset(&catalog_page, 0, sizeof(catalog_page));
+            buffer_write_page(space_id, catalog_page_number, &catalog_page._raw_page);
+        }
+
+        //allocation changes header page, so read it again
+        buffer_read_page(space_id, 0, &header_page._raw_page, BUFFER_WRITE_LOCK_MODE);
+        if(catalog_page_number){
+            header_page._header_page.catalog_page_number[(table_number - 1) / CATALOG_ENTRY_NUMBER] = catalog_page_number;
+        }
+        header_page._header_page.number_of_tables = table_number;
+        buffer_write_page(space_id, 0, &header_page._raw_page);
+        return table_number;
+    }
+
+    bool is_read_only_table(int64_t table_id){
+        return file_get_mapped_page(table_id, 0) != nullptr;
+    }
+
+    const _fim_page_t* read_page_for_lookup(int64_t table_id, pagenum_t pagenum, _fim_page_t* buf){
+        //read-only table case
+        //walk page in memory mapping directly (no buffer latch, no copy)
+        if(const page_t* mapped_page = file_get_mapped_page(table_id, pagenum)){
+            return reinterpret_cast<const _fim_page_t*>(mapped_page);
+        }
+        buffer_read_page(table_id,pagenum,&buf->_raw_page, BUFFER_NO_LOCK_MODE);
+        return buf;
+    }
+
     pagenum_t find_leaf_page(int64_t table_id, int64_t key){
-        _fim_page_t header_page, cnt_page;
+        _fim_page_t cnt_buf;
 
-        //get header page to get root page number
-        buffer_read_page(table_id,0,&header_page._raw_page, BUFFER_NO_LOCK_MODE);
-        pagenum_t root = header_page._header_page.root_page_number; //root page number
+        //get root page number from header page or catalog page
+        pagenum_t root = FIM::get_root_page(table_id);
 
         if(!root) return 0; //no tree case
 
         //current page(return value)
         pagenum_t cnt_page_number = root;
-        buffer_read_page(table_id,root,&cnt_page._raw_page, BUFFER_NO_LOCK_MODE);
+        const _fim_page_t* cnt_page = FIM::read_page_for_lookup(table_id, root, &cnt_buf);
         
         //find while current page is leaf page
         //find child page x where x th page's key <= key < x+1 th page's key
-        while(!cnt_page._leaf_page.page_header.is_leaf){
+        while(!cnt_page->_leaf_page.page_header.is_leaf){
             pagenum_t pre_page_number = cnt_page_number;
 
-            uint32_t num_keys = cnt_page._internal_page.page_header.number_of_keys;
+            uint32_t num_keys = cnt_page->_internal_page.page_header.number_of_keys;
 
-            if(key < cnt_page._internal_page.key_and_page[0].key){
+            if(key < cnt_page->_internal_page.key_and_page[0].key){
                 //leftmost page case
-                cnt_page_number = cnt_page._internal_page.leftmost_page_number;
+                cnt_page_number = cnt_page->_internal_page.leftmost_page_number;
             }
             else{
                 for(uint32_t i = 0; i < num_keys; i++){
-                    if(key < cnt_page._internal_page.key_and_page[i].key){
+                    if(key < cnt_page->_internal_page.key_and_page[i].key){
                         //middle page case
-                        cnt_page_number = cnt_page._internal_page.key_and_page[i-1].page_number;
+                        cnt_page_number = cnt_page->_internal_page.key_and_page[i-1].page_number;
                         break;
                     }
                     else if(i+1 == num_keys){
                         //rightmost page case
-                        cnt_page_number = cnt_page._internal_page.key_and_page[i].page_number;
+                        cnt_page_number = cnt_page->_internal_page.key_and_page[i].page_number;
                     }
                 }
             }
@@ -71,7 +189,7 @@ namespace FIM{
                 throw "inf loop in find leaf page";
             }
             //get next page
-            buffer_read_page(table_id,cnt_page_number,&cnt_page._raw_page, BUFFER_NO_LOCK_MODE);
+            cnt_page = FIM::read_page_for_lookup(table_id, cnt_page_number, &cnt_buf);
         }
         return cnt_page_number;
     }
@@ -82,18 +200,18 @@ namespace FIM{
         pagenum_t leaf_page_number = FIM::find_leaf_page(table_id,key);
         if(!leaf_page_number) return -1; //can't find leaf page
 
-        _fim_page_t leaf_page;
-        buffer_read_page(table_id,leaf_page_number,&leaf_page._raw_page, BUFFER_NO_LOCK_MODE);
+        _fim_page_t leaf_buf;
+        const _fim_page_t* leaf_page = FIM::read_page_for_lookup(table_id, leaf_page_number, &leaf_buf);
 
-        uint32_t num_keys = leaf_page._leaf_page.page_header.number_of_keys;
+        uint32_t num_keys = leaf_page->_leaf_page.page_header.number_of_keys;
 
         for(uint32_t i = 0; i < num_keys; i++){
-            if(leaf_page._leaf_page.slot[i].key == key){
+            if(leaf_page->_leaf_page.slot[i].key == key){
                 //find record
                 if(ret_val){
                     //push record value when ret_val is not NULL
-                    *val_size = leaf_page._leaf_page.slot[i].size;
-                    memcpy(ret_val,leaf_page._raw_page.raw_data+(leaf_page._leaf_page.slot[i].offset),*val_size);
+                    *val_size = leaf_page->_leaf_page.slot[i].size;
+                    memcpy(ret_val,leaf_page->_raw_page.raw_data+(leaf_page->_leaf_page.slot[i].offset),*val_size);
                 }
                 return 0;
             }
@@ -101,43 +219,84 @@ namespace FIM{
         return -1; //can't find record
     }
 
-    int find_record_trx(int64_t table_id, int64_t key, char *ret_val, uint16_t* val_size, int trx_id){
-        
-        //find leaf page
-        pagenum_t leaf_page_number = FIM::find_leaf_page(table_id,key);
-        if(!leaf_page_number) return -1; //can't find leaf page
+    int scan_records(int64_t table_id, int64_t begin_key, int64_t end_key, scan_callback_t callback, void* arg){
+        if(begin_key > end_key) return 0; //empty range
 
-        _fim_page_t leaf_page;
-        buffer_read_page(table_id,leaf_page_number,&leaf_page._raw_page, BUFFER_NO_LOCK_MODE);
+        //find first leaf page
+        pagenum_t leaf_page_number = FIM::find_leaf_page(table_id,begin_key);
+        bool is_mapped = FIM::is_read_only_table(table_id);
+        int cnt = 0; //number of scanned records
+        int number_of_leaves = 0; //number of read leaf pages
 
-        uint32_t num_keys = leaf_page._leaf_page.page_header.number_of_keys;
+        _fim_page_t leaf_buf;
+        while(leaf_page_number){
+            //long scan reads the rest through ring frames (caller restores access strategy)
+            if(++number_of_leaves == SCAN_RING_THRESHOLD && !buffer_get_ring_size()) buffer_set_ring_size(DEFAULT_RING_FRAMES);
 
-        for(uint32_t i = 0; i < num_keys; i++){
-            if(leaf_page._leaf_page.slot[i].key == key){
-                //find record
-                if(ret_val){
-                    //try to acquire shared lock
-                    int shared_lock = lock_acquire(table_id, leaf_page_number, key, i, trx_id, SHARED_LOCK_MODE);
-                    if(shared_lock == -1){
-                        //acquire failed case
-                        trx_abort_txn(trx_id); //abort txn
-                        return -1;
-                    }
-                    //acquire page latch (shared lock)
-                    page_t* raw_page = buffer_direct_read_page(table_id,leaf_page_number);
-                    FIM::_fim_page_t *leaf_page_ptr = reinterpret_cast<FIM::_fim_page_t*>(raw_page);
+            const _fim_page_t* leaf_page = FIM::read_page_for_lookup(table_id, leaf_page_number, &leaf_buf);
+            pagenum_t right_page_number = leaf_page->_leaf_page.right_sibling_page_number;
 
-                    //push record value when ret_val is not NULL
-                    *val_size = leaf_page_ptr->_leaf_page.slot[i].size;
-                    memcpy(ret_val,leaf_page_ptr->_raw_page.raw_data+(leaf_page_ptr->_leaf_page.slot[i].offset),*val_size);
+            //leaf pages are not always contiguous in file so sequential readahead can miss them
+            //prefetch next leaf while scanning current one
+            if(right_page_number){
+                if(is_mapped) file_prefetch_mapped_pages(table_id, right_page_number, 1);
+                else buffer_prefetch_pages(table_id, right_page_number, 1);
+            }
 
-                    //release page latch
-                    buffer_direct_write_page(table_id,leaf_page_number,false);
-                }
-                return 0;
+            uint32_t num_keys = leaf_page->_leaf_page.page_header.number_of_keys;
+            for(uint32_t i = 0; i < num_keys; i++){
+                const page_slot_t& slot = leaf_page->_leaf_page.slot[i];
+                if(slot.key < begin_key) continue;
+                if(slot.key > end_key) return cnt; //end of range
+                callback(slot.key, reinterpret_cast<const char*>(leaf_page->_raw_page.raw_data + slot.offset), slot.size, arg);
+                cnt++;
             }
+            leaf_page_number = right_page_number;
+        }
+        return cnt;
+    }
+
+    int find_record_trx(int64_t table_id, int64_t key, char *ret_val, uint16_t* val_size, int trx_id){
+        //insert or delete may move record while tree latches are released for lock wait
+        //then look it up again and lock it at new place (lock of old place is kept until commit)
+        while(true){
+            //find leaf page
+            pagenum_t leaf_page_number = FIM::find_leaf_page(table_id,key);
+            if(!leaf_page_number) return -1; //can't find leaf page
+
+            _fim_page_t leaf_page;
+            buffer_read_page(table_id,leaf_page_number,&leaf_page._raw_page, BUFFER_NO_LOCK_MODE);
+
+            //find record
+            int64_t i = FIM::find_slot_in_leaf_page(&leaf_page, 0, key);
+            if(i < 0) return -1; //can't find record
+            if(!ret_val) return 0;
+
+            //try to acquire shared lock
+            int shared_lock = FIM::acquire_record_lock(table_id, leaf_page_number, key, i, trx_id, SHARED_LOCK_MODE);
+            if(shared_lock == -1){
+                //acquire failed case
+                trx_abort_txn(trx_id); //abort txn
+                return -1;
+            }
+            //acquire page latch (shared lock)
+            page_t* raw_page = buffer_direct_read_page(table_id,leaf_page_number);
+            FIM::_fim_page_t *leaf_page_ptr = reinterpret_cast<FIM::_fim_page_t*>(raw_page);
+
+            if(FIM::find_slot_in_leaf_page(leaf_page_ptr, i, key) != i){
+                //record moved while waiting, lock covers other slot
+                buffer_direct_write_page(table_id,leaf_page_number,false);
+                continue;
+            }
+
+            //push record value when ret_val is not NULL
+            *val_size = leaf_page_ptr->_leaf_page.slot[i].size;
+            memcpy(ret_val,leaf_page_ptr->_raw_page.raw_data+(leaf_page_ptr->_leaf_page.slot[i].offset),*val_size);
+
+            //release page latch
+            buffer_direct_write_page(table_id,leaf_page_number,false);
+            return 0;
         }
-        return -1; //can't find record
     }
 
     int update_record(int64_t table_id, int64_t key, char *values, uint16_t new_val_size, uint16_t *old_val_size){
@@ -176,61 +335,63 @@ namespace FIM{
     }
 
     int update_record_trx(int64_t table_id, int64_t key, char *values, uint16_t new_val_size, uint16_t *old_val_size, int trx_id){
-        
-        //find leaf page
-        pagenum_t leaf_page_number = FIM::find_leaf_page(table_id,key);
-        if(!leaf_page_number) return -1; //can't find leaf page
-
-        _fim_page_t leaf_page;
-        buffer_read_page(table_id,leaf_page_number,&leaf_page._raw_page, BUFFER_NO_LOCK_MODE);
-
-        uint32_t num_keys = leaf_page._leaf_page.page_header.number_of_keys;
+        //record moved while waiting for lock is looked up again (see find_record_trx)
+        while(true){
+            //find leaf page
+            pagenum_t leaf_page_number = FIM::find_leaf_page(table_id,key);
+            if(!leaf_page_number) return -1; //can't find leaf page
+
+            _fim_page_t leaf_page;
+            buffer_read_page(table_id,leaf_page_number,&leaf_page._raw_page, BUFFER_NO_LOCK_MODE);
+
+            //find record
+            int64_t i = FIM::find_slot_in_leaf_page(&leaf_page, 0, key);
+            if(i < 0) return -1; //can't find record
+            if(!values) return 0;
+
+            //try to acquire exclusive lock
+            int exclusive_lock = FIM::acquire_record_lock(table_id, leaf_page_number, key, i, trx_id, EXCLUSIVE_LOCK_MODE);
+            if(exclusive_lock == -1){
+                //acquire failed case
+                trx_abort_txn(trx_id); //abort txn
+                return -1;
+            }
+            //acquire page latch (exclusive lock)
+            page_t* raw_page = buffer_direct_read_page(table_id,leaf_page_number);
+            FIM::_fim_page_t *leaf_page_ptr = reinterpret_cast<FIM::_fim_page_t*>(raw_page);
+
+            if(FIM::find_slot_in_leaf_page(leaf_page_ptr, i, key) != i){
+                //record moved while waiting, lock covers other slot
+                buffer_direct_write_page(table_id,leaf_page_number,false);
+                continue;
+            }
 
-        for(uint32_t i = 0; i < num_keys; i++){
-            if(leaf_page._leaf_page.slot[i].key == key){
-                //find record
-                if(values){
-                    //try to acquire exclusive lock
-                    int exclusive_lock = lock_acquire(table_id, leaf_page_number, key, i, trx_id, EXCLUSIVE_LOCK_MODE);
-                    if(exclusive_lock == -1){
-                        //acquire failed case
-                        trx_abort_txn(trx_id); //abort txn
-                        return -1;
-                    }
-                    //acquire page latch (exclusive lock)
-                    page_t* raw_page = buffer_direct_read_page(table_id,leaf_page_number);
-                    FIM::_fim_page_t *leaf_page_ptr = reinterpret_cast<FIM::_fim_page_t*>(raw_page);
+            //store old_val_size & old_values and update record value when values is not NULL
+            *old_val_size = leaf_page_ptr->_leaf_page.slot[i].size;
+            char* old_values = new char[*old_val_size];
 
-                    //store old_val_size & old_values and update record value when values is not NULL
-                    *old_val_size = leaf_page_ptr->_leaf_page.slot[i].size;
-                    char* old_values = new char[*old_val_size];
+            memcpy(old_values,leaf_page_ptr->_raw_page.raw_data+(leaf_page_ptr->_leaf_page.slot[i].offset),*old_val_size);
+            memcpy(leaf_page_ptr->_raw_page.raw_data+(leaf_page_ptr->_leaf_page.slot[i].offset),values,new_val_size);
 
-                    memcpy(old_values,leaf_page_ptr->_raw_page.raw_data+(leaf_page_ptr->_leaf_page.slot[i].offset),*old_val_size);
-                    memcpy(leaf_page_ptr->_raw_page.raw_data+(leaf_page_ptr->_leaf_page.slot[i].offset),values,new_val_size);
+            //change slot size
+            leaf_page_ptr->_leaf_page.slot[i].size = new_val_size;
 
-                    //change slot size
-                    leaf_page_ptr->_leaf_page.slot[i].size = new_val_size;
+            //write changes to page and release page latch
+            buffer_direct_write_page(table_id,leaf_page_number,true);
 
-                    //write changes to page and release page latch
-                    buffer_direct_write_page(table_id,leaf_page_number,true);
-                   
-                    //add log and delete old_value
-                    trx_add_log(table_id,leaf_page_number,key,i,values,new_val_size,old_values,*old_val_size,trx_id);
-                    delete[] old_values;
-                }
-                return 0;
-            }
+            //add log and delete old_value
+            trx_add_log(table_id,leaf_page_number,key,i,values,new_val_size,old_values,*old_val_size,trx_id);
+            delete[] old_values;
+            return 0;
         }
-        return -1; //can't find record
     }
 
     int insert_record(int64_t table_id, int64_t key, char *value, uint16_t val_size){
         
         if(!FIM::find_record(table_id,key)) return -1; //there is key in tree already
 
-        _fim_page_t header_page, leaf_page;
-        buffer_read_page(table_id,0,&header_page._raw_page, BUFFER_NO_LOCK_MODE); //get header page to get root page
-        pagenum_t root = header_page._header_page.root_page_number;
+        _fim_page_t leaf_page;
+        pagenum_t root = FIM::get_root_page(table_id);
 
         if(!root){
             //no tree case
@@ -1171,65 +1332,164 @@ namespace FIM{
 }
 
 int idx_insert_by_key(int64_t table_id, int64_t key, char *value, uint16_t val_size){
+    int ret_val; //return value
+    FIM::lock_tree(table_id, true); //structure can be changed
     try{
-        return FIM::insert_record(table_id,key,value,val_size);
+        //no structure or record change on read-only table
+        if(FIM::is_read_only_table(table_id)) throw "table is read-only";
+        ret_val = FIM::insert_record(table_id,key,value,val_size);
     }
     catch(const char *e){
         perror(e);
-        return -1;
+        ret_val = -1;
     }
+    FIM::unlock_tree(table_id);
+    return ret_val;
 }
 
 int idx_find_by_key(int64_t table_id, int64_t key, char *ret_val, uint16_t *val_size){
+    int ret; //return value
+    FIM::lock_tree(table_id, false); //no structure change
     try{
-        return FIM::find_record(table_id,key,ret_val,val_size);
+        ret = FIM::find_record(table_id,key,ret_val,val_size);
     }
     catch(const char *e){
         perror(e);
-        return -1;
+        ret = -1;
     }
+    FIM::unlock_tree(table_id);
+    return ret;
 }
 
 int idx_delete_by_key(int64_t table_id, int64_t key){
+    int ret_val; //return value
+    FIM::lock_tree(table_id, true); //structure can be changed
     try{
-        return FIM::delete_record(table_id,key);
+        //no structure or record change on read-only table
+        if(FIM::is_read_only_table(table_id)) throw "table is read-only";
+        ret_val = FIM::delete_record(table_id,key);
     }
     catch(const char *e){
         perror(e);
-        return -1;
+        ret_val = -1;
     }
+    FIM::unlock_tree(table_id);
+    return ret_val;
 }
 
 int idx_find_by_key_trx(int64_t table_id, int64_t key, char *ret_val, uint16_t *val_size, int trx_id){
+    int ret; //return value
+    bool is_failed = false; //abort txn after releasing tree latch
+    FIM::lock_tree(table_id, false); //no structure change
     try{
-        return FIM::find_record_trx(table_id,key,ret_val,val_size,trx_id);
+        //read-only table has no writer, no need to lock
+        if(FIM::is_read_only_table(table_id)) ret = FIM::find_record(table_id,key,ret_val,val_size);
+        else ret = FIM::find_record_trx(table_id,key,ret_val,val_size,trx_id);
     }
     catch(const char *e){
         perror(e);
+        is_failed = true;
+    }
+    FIM::unlock_tree(table_id);
+    if(is_failed){
         trx_abort_txn(trx_id); //abort txn
         return -1;
     }
+    return ret;
 }
 
 int idx_update_by_key(int64_t table_id, int64_t key, char *values, uint16_t new_val_size, uint16_t *old_val_size){
+    int ret_val; //return value
+    FIM::lock_tree(table_id, false); //no structure change
     try{
-        return FIM::update_record(table_id,key,values,new_val_size,old_val_size);
+        //no structure or record change on read-only table
+        if(FIM::is_read_only_table(table_id)) throw "table is read-only";
+        ret_val = FIM::update_record(table_id,key,values,new_val_size,old_val_size);
     }
     catch(const char *e){
         perror(e);
-        return -1;
+        ret_val = -1;
     }
+    FIM::unlock_tree(table_id);
+    return ret_val;
 }
 
 int idx_update_by_key_trx(int64_t table_id, int64_t key, char *values, uint16_t new_val_size, uint16_t *old_val_size, int trx_id){
+    int ret_val; //return value
+    bool is_failed = false; //abort txn after releasing tree latch
+    FIM::lock_tree(table_id, false); //no structure change
     try{
-        return FIM::update_record_trx(table_id,key,values,new_val_size,old_val_size,trx_id);
+        //no structure or record change on read-only table
+        if(FIM::is_read_only_table(table_id)) throw "table is read-only";
+        ret_val = FIM::update_record_trx(table_id,key,values,new_val_size,old_val_size,trx_id);
     }
     catch(const char *e){
         perror(e);
+        is_failed = true;
+    }
+    FIM::unlock_tree(table_id);
+    if(is_failed){
         trx_abort_txn(trx_id); //abort txn
         return -1;
     }
+    return ret_val;
+}
+
+int idx_scan_by_range(int64_t table_id, int64_t begin_key, int64_t end_key, scan_callback_t callback, void* arg){
+    int ret_val; //return value
+    int ring_size = buffer_get_ring_size(); //scan may switch to ring
+    FIM::lock_tree(table_id, false); //no structure change
+    try{
+        ret_val = FIM::scan_records(table_id,begin_key,end_key,callback,arg);
+    }
+    catch(const char *e){
+        perror(e);
+        ret_val = -1;
+    }
+    FIM::unlock_tree(table_id);
+    buffer_set_ring_size(ring_size);
+    return ret_val;
+}
+
+int idx_try_lock_tree_structure(int64_t table_id){
+    return pthread_rwlock_trywrlock(FIM::get_space_latch(table_id));
+}
+
+void idx_unlock_tree_structure(int64_t table_id){
+    pthread_rwlock_unlock(FIM::get_space_latch(table_id));
+}
+
+int64_t idx_create_table(int64_t space_id){
+    int64_t ret_val; //return value
+    pthread_rwlock_t* space_latch = FIM::get_space_latch(space_id);
+    pthread_rwlock_wrlock(space_latch); //catalog can be changed
+    try{
+        space_id = file_get_space_id(space_id);
+        if(FIM::is_read_only_table(space_id)) throw "table is read-only";
+        uint32_t table_number = FIM::add_table_to_catalog(space_id);
+        ret_val = ((int64_t)table_number << TABLE_NUMBER_SHIFT) | space_id;
+    }
+    catch(const char *e){
+        perror(e);
+        ret_val = -1;
+    }
+    pthread_rwlock_unlock(space_latch);
+    return ret_val;
+}
+
+int64_t idx_get_table(int64_t space_id, uint32_t table_number){
+    int64_t ret_val; //return value
+    pthread_rwlock_rdlock(FIM::get_space_latch(space_id)); //no catalog change
+    try{
+        ret_val = ((int64_t)table_number << TABLE_NUMBER_SHIFT) | file_get_space_id(space_id);
+        FIM::get_root_page(ret_val); //throw if there is no such table
+    }
+    catch(const char *e){
+        perror(e);
+        ret_val = -1;
+    }
+    pthread_rwlock_unlock(FIM::get_space_latch(space_id));
+    return ret_val;
 }
 
 int idx_get_trx_id_in_slot(int64_t table_id, pagenum_t page_id, uint32_t slot_number){
@@ -1244,17 +1504,45 @@ int idx_get_trx_id_in_slot(int64_t table_id, pagenum_t page_id, uint32_t slot_nu
     return leaf_page_ptr->_leaf_page.slot[slot_number].trx_id;
 }
 
-void idx_set_trx_id_in_slot(int64_t table_id, pagenum_t page_id, uint32_t slot_number, int trx_id){
+void idx_set_trx_id_in_slot(int64_t table_id, pagenum_t page_id, uint32_t slot_number, int64_t key, int trx_id){
     //read target page
     page_t* raw_page = buffer_direct_read_page(table_id,page_id);
     FIM::_fim_page_t *leaf_page_ptr = reinterpret_cast<FIM::_fim_page_t*>(raw_page);
 
+    //find record (structure change may move it in page)
+    int64_t slot = FIM::find_slot_in_leaf_page(leaf_page_ptr, slot_number, key);
+    if(slot < 0){
+        buffer_direct_write_page(table_id,page_id,false);
+        return;
+    }
+
     //compare slot's trx id and new id
-    bool is_dirty = leaf_page_ptr->_leaf_page.slot[slot_number].trx_id != trx_id;
+    bool is_dirty = leaf_page_ptr->_leaf_page.slot[slot].trx_id != trx_id;
     
     //write trx id into target slot
-    leaf_page_ptr->_leaf_page.slot[slot_number].trx_id = trx_id;
+    leaf_page_ptr->_leaf_page.slot[slot].trx_id = trx_id;
     buffer_direct_write_page(table_id,page_id,is_dirty);
     
     return;
+}
+
+int idx_restore_record_in_slot(int64_t table_id, pagenum_t page_id, uint32_t slot_number, int64_t key, const char* values, uint16_t val_size){
+    //read target page
+    page_t* raw_page = buffer_direct_read_page(table_id,page_id);
+    FIM::_fim_page_t *leaf_page_ptr = reinterpret_cast<FIM::_fim_page_t*>(raw_page);
+
+    //find record (structure change may move it in page)
+    int64_t slot = FIM::find_slot_in_leaf_page(leaf_page_ptr, slot_number, key);
+    if(slot < 0){
+        buffer_direct_write_page(table_id,page_id,false);
+        return -1;
+    }
+
+    //write old value and size back like update_record
+    FIM::page_slot_t* record = &leaf_page_ptr->_leaf_page.slot[slot];
+    memcpy(leaf_page_ptr->_raw_page.raw_data + record->offset, values, val_size);
+    record->size = val_size;
+    buffer_direct_write_page(table_id,page_id,true);
+
+    return 0;
 }
\ No newline at end of file
@@ -1,23 +1,75 @@
 #include "buffer.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
 
 namespace BM{
+    //control block is kept in struct of arrays indexed by block number
+    //hot fields read on every access are packed in ctrl_blk (two blocks per cache line)
+    //LRU links touched by victim search and LRU update are in their own array
     frame_t *frame_list; //frame(page) array
-    BM::ctrl_blk *ctrl_blk_list; //ctrl block(frame_ptr + info) array
+    BM::ctrl_blk *ctrl_blk_list; //ctrl block(page id + latch + flags) array
+    BM::lru_node *lru_list; //LRU links array
+
+    //address space reserved for BUFFER_CAPACITY frames and ctrl blocks
+    //arrays never move, so frame and block pointers stay valid while pool is resized
+    void* frame_memory;
+    size_t frame_memory_length;
+    void* ctrl_blk_memory;
+    size_t ctrl_blk_memory_length;
+    void* lru_memory;
+    size_t lru_memory_length;
 
     //hash table that mapping ctrl block in the list
     //search key is page_id({table_id, pagenum})
     //value is block num
-    __gnu_pbds::gp_hash_table<page_id, blknum_t, BM::hash_pair> hash_table;
+    BM::hash_table_stripe hash_table[HASH_TABLE_STRIPES];
 
     size_t BUFFER_SIZE = 0;
+    size_t BUFFER_CAPACITY = 0; //number of frames in reserved address space
+    int HUGE_PAGE_MODE = BUFFER_HUGE_PAGE_NONE; //requested mode for next init
+    int huge_page_mode = BUFFER_HUGE_PAGE_NONE; //mode of current pool
 
-    //LRU list pointer
+    //LRU list pointer (evictable blocks only)
     //front point LRU block and back point MRU block
     blknum_t ctrl_blk_list_front;
     blknum_t ctrl_blk_list_back;
 
     //buffer manager latch
     pthread_mutex_t buffer_manager_latch = PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_t resize_latch = PTHREAD_MUTEX_INITIALIZER; //serializes resize
+
+    //readahead info
+    //queue is protected by readahead latch
+    //detector states are protected by buffer manager latch
+    std::deque<BM::readahead_req> readahead_queue;
+    std::unordered_map<int64_t, BM::readahead_state> readahead_states;
+    pthread_mutex_t readahead_latch = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t readahead_cond = PTHREAD_COND_INITIALIZER;
+    pthread_t readahead_thread;
+    bool is_readahead_thread_running = false;
+    bool is_readahead_thread_stopped = false; //stop flag
+    int READAHEAD_PAGES = DEFAULT_READAHEAD_PAGES;
+
+    //warm-up info
+    //requests run only when readahead queue is empty (protected by readahead latch)
+    //page lists are protected by buffer manager latch
+    std::string WARMUP_PATH;
+    std::deque<BM::readahead_req> warmup_queue;
+    std::unordered_map<std::string, std::vector<pagenum_t>> warmup_pages;
+
+    //access strategy of each thread (ring is only a hint, every slot is checked before reuse)
+    thread_local BM::access_strategy strategy;
+
+    //frame quota and usage per table file (protected by buffer manager latch)
+    std::unordered_map<int64_t, BM::table_quota> table_quotas;
+    size_t number_of_quotas = 0; //number of table files with min or max quota
+
+    //compressed cache (protected by buffer manager latch)
+    //front of LRU list is the least recently cached page
+    std::unordered_map<page_id, BM::compressed_page, BM::hash_pair> compressed_pages;
+    std::list<page_id> compressed_lru;
+    size_t COMPRESSED_CACHE_BYTES = 0; //max size, 0 disables cache
+    size_t compressed_bytes = 0; //current size (with overhead)
 
     //code by boost lib
     // https://www.boost.org/doc/libs/1_64_0/boost/functional/hash/hash.hpp
@@ -29,19 +81,363 @@ namespace BM{
         return hash1 ^ hash2 + 0x9e3779b9 + (hash2<<6) + (hash2>>2);
     }
 
+    void* reserve_memory(size_t length){
+        void* addr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        return addr == MAP_FAILED ? nullptr : addr;
+    }
+
+    void* map_huge_pages(size_t length){
+    #ifdef MAP_HUGETLB
+        void* addr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        return addr == MAP_FAILED ? nullptr : addr;
+    #else
+        return nullptr;
+    #endif
+    }
+
+    void* alloc_memory(size_t* length, int* mode){
+        if(*mode == BUFFER_HUGE_PAGE_EXPLICIT){
+            size_t huge_length = (*length + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+            void* addr = BM::map_huge_pages(huge_length);
+            if(addr){
+                *length = huge_length;
+                return addr;
+            }
+            *mode = BUFFER_HUGE_PAGE_TRANSPARENT; //no hugetlb page left
+        }
+
+        void* addr = BM::reserve_memory(*length);
+        if(!addr) return nullptr;
+    #ifdef MADV_HUGEPAGE
+        if(*mode == BUFFER_HUGE_PAGE_TRANSPARENT && madvise(addr, *length, MADV_HUGEPAGE)){
+            *mode = BUFFER_HUGE_PAGE_NONE; //kernel without transparent huge page
+        }
+    #else
+        *mode = BUFFER_HUGE_PAGE_NONE;
+    #endif
+        return addr;
+    }
+
+    void link_blk(blknum_t blknum, bool is_front){
+        lru_node* node = &BM::lru_list[blknum];
+        if(is_front){
+            node->prv = -1;
+            node->nxt = BM::ctrl_blk_list_front;
+            if(BM::ctrl_blk_list_front != -1) BM::lru_list[BM::ctrl_blk_list_front].prv = blknum;
+            else BM::ctrl_blk_list_back = blknum;
+            BM::ctrl_blk_list_front = blknum;
+        }
+        else{
+            node->prv = BM::ctrl_blk_list_back;
+            node->nxt = -1;
+            if(BM::ctrl_blk_list_back != -1) BM::lru_list[BM::ctrl_blk_list_back].nxt = blknum;
+            else BM::ctrl_blk_list_front = blknum;
+            BM::ctrl_blk_list_back = blknum;
+        }
+    }
+
+    void add_blk(blknum_t blknum){
+        new (&BM::ctrl_blk_list[blknum]) BM::ctrl_blk();
+
+        //unused frame is the first victim
+        BM::link_blk(blknum, true);
+    }
+
+    void unlink_blk(blknum_t blknum){
+        lru_node* node = &BM::lru_list[blknum];
+        if(node->prv != -1) BM::lru_list[node->prv].nxt = node->nxt;
+        else BM::ctrl_blk_list_front = node->nxt;
+        if(node->nxt != -1) BM::lru_list[node->nxt].prv = node->prv;
+        else BM::ctrl_blk_list_back = node->prv;
+        node->prv = node->nxt = -1;
+    }
+
+    void pin_blk(blknum_t blknum){
+        if(!BM::ctrl_blk_list[blknum].pin_count++) BM::unlink_blk(blknum);
+    }
+
+    void unpin_blk(blknum_t blknum){
+        if(!--BM::ctrl_blk_list[blknum].pin_count) BM::link_blk(blknum, false);
+    }
+
+    void unpin_blk_after(blknum_t blknum, blknum_t prv){
+        if(--BM::ctrl_blk_list[blknum].pin_count) return;
+        if(prv == -1) BM::link_blk(blknum, true);
+        else if(prv < -1 || (size_t)prv >= BM::BUFFER_SIZE || BM::ctrl_blk_list[prv].pin_count) BM::link_blk(blknum, false);
+        else{
+            //put back right after old neighbor
+            lru_node* node = &BM::lru_list[blknum];
+            node->prv = prv;
+            node->nxt = BM::lru_list[prv].nxt;
+            if(node->nxt != -1) BM::lru_list[node->nxt].prv = blknum;
+            else BM::ctrl_blk_list_back = blknum;
+            BM::lru_list[prv].nxt = blknum;
+        }
+    }
+
+    int latch_try_exclusive(std::atomic<uint32_t>* latch){
+        uint32_t v = latch->load(std::memory_order_relaxed);
+        //only waiters bit may be set
+        while(!(v & ~LATCH_WAITERS)){
+            if(latch->compare_exchange_weak(v, v | LATCH_EXCLUSIVE, std::memory_order_acquire)) return 0;
+        }
+        return EBUSY;
+    }
+
+    int latch_try_shared(std::atomic<uint32_t>* latch){
+        uint32_t v = latch->load(std::memory_order_relaxed);
+        while(!(v & LATCH_EXCLUSIVE)){
+            if(latch->compare_exchange_weak(v, v + 1, std::memory_order_acquire)) return 0;
+        }
+        return EBUSY;
+    }
+
+    void latch_unlock(std::atomic<uint32_t>* latch){
+        uint32_t v = latch->load(std::memory_order_relaxed);
+        uint32_t nv;
+        do{
+            //exclusive or last shared holder releases every sleeping thread
+            nv = (v & LATCH_EXCLUSIVE) ? 0 : v - 1;
+            if(!(nv & LATCH_SHARED_MASK)) nv = 0;
+        }while(!latch->compare_exchange_weak(v, nv, std::memory_order_release));
+
+        if((v & LATCH_WAITERS) && !nv){
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(latch), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+        }
+    }
+
+    void latch_wait(std::atomic<uint32_t>* latch){
+        uint32_t v = latch->load(std::memory_order_relaxed);
+        pthread_mutex_unlock(&BM::buffer_manager_latch);
+
+        //short hold (e.g. page copy) ends soon
+        bool is_changed = false;
+        for(int i = 0; i < LATCH_SPIN_COUNT && !is_changed; i++){
+        #if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+        #endif
+            is_changed = latch->load(std::memory_order_relaxed) != v;
+        }
+
+        //long hold (I/O or tree operation), sleep until holder releases it
+        while(!is_changed){
+            v = latch->load(std::memory_order_relaxed);
+            if(!v) break; //released
+            if(!(v & LATCH_WAITERS) && !latch->compare_exchange_weak(v, v | LATCH_WAITERS, std::memory_order_relaxed)) continue;
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(latch), FUTEX_WAIT_PRIVATE, v | LATCH_WAITERS, NULL, NULL, 0);
+            is_changed = true;
+        }
+
+        pthread_mutex_lock(&BM::buffer_manager_latch);
+    }
+
     void flush_frame_to_file(blknum_t blknum){
         //get given block in the list
         ctrl_blk* blk = &BM::ctrl_blk_list[blknum];
         //call write DSM api
-        file_write_page(blk->table_id,blk->pagenum,blk->frame_ptr);
+        file_write_page(blk->table_id,blk->pagenum,BM::get_frame(blk));
+        ST::add(blk->table_id, ST::DIRTY_FLUSHES);
+        //compressed copy is old content
+        BM::erase_from_compressed_cache(blk->table_id, blk->pagenum, blk->pagenum + 1);
+    }
+
+    blknum_t find_io_pinned_blk(){
+        for(size_t i = 0; i < BM::BUFFER_SIZE; i++){
+            if(BM::ctrl_blk_list[i].is_io_pinned) return i;
+        }
+        return -1;
+    }
+
+    void* flush_thread_func(void* arg){
+        BM::flush_job* job = reinterpret_cast<BM::flush_job*>(arg);
+        std::vector<const page_t*> srcs;
+        try{
+            for(size_t i = 0; i < job->blks.size(); ){
+                //contiguous run
+                size_t j = i;
+                srcs.clear();
+                while(j < job->blks.size() && BM::ctrl_blk_list[job->blks[j]].pagenum == BM::ctrl_blk_list[job->blks[i]].pagenum + (j - i)){
+                    srcs.push_back(&BM::frame_list[job->blks[j]]);
+                    j++;
+                }
+                file_write_pages(job->table_id, BM::ctrl_blk_list[job->blks[i]].pagenum, srcs.size(), srcs.data());
+                i = j;
+            }
+        }
+        catch(const char* e){
+            job->is_failed = true;
+        }
+        return nullptr;
+    }
+
+    void flush_blks(const std::pair<page_id, blknum_t>* dirty, size_t count){
+        std::vector<BM::flush_job> jobs;
+        std::vector<size_t> busy; //index of busy pages
+        std::vector<std::pair<blknum_t, blknum_t>> pinned; //(block, LRU neighbor before pin) in pin order
+
+        //start cirtical section
+        pthread_mutex_lock(&BM::buffer_manager_latch);
+        for(size_t i = 0; i < count; i++){
+            blknum_t blknum = dirty[i].second;
+            if((size_t)blknum >= BM::BUFFER_SIZE) continue; //removed by resize
+            ctrl_blk* blk = &BM::ctrl_blk_list[blknum];
+            if(!blk->is_dirty || blk->table_id != dirty[i].first.first || blk->pagenum != dirty[i].first.second) continue;
+            if(BM::latch_try_shared(&blk->latch)){
+                busy.push_back(i);
+                continue;
+            }
+
+            //pinned so victim search skips it during write (LRU position is restored afterwards)
+            //change after this sets dirty flag again
+            pinned.push_back({blknum, blk->pin_count ? -2 : BM::lru_list[blknum].prv});
+            BM::pin_blk(blknum);
+            blk->is_io_pinned = true;
+            blk->is_dirty = false;
+            BM::erase_from_compressed_cache(blk->table_id, blk->pagenum, blk->pagenum + 1);
+            if(jobs.empty() || jobs.back().table_id != blk->table_id) jobs.push_back({blk->table_id, {}, false});
+            jobs.back().blks.push_back(blknum);
+        }
+        //end cirtical section
+        pthread_mutex_unlock(&BM::buffer_manager_latch);
+
+        //one thread per table file (calling thread takes the first one)
+        std::vector<pthread_t> threads(jobs.size());
+        std::vector<bool> is_started(jobs.size(), false);
+        for(size_t i = 1; i < jobs.size(); i++){
+            is_started[i] = !pthread_create(&threads[i], NULL, BM::flush_thread_func, &jobs[i]);
+        }
+        for(size_t i = 0; i < jobs.size(); i++){
+            if(!is_started[i]) BM::flush_thread_func(&jobs[i]);
+        }
+        for(size_t i = 0; i < jobs.size(); i++){
+            if(is_started[i]) pthread_join(threads[i], NULL);
+        }
+
+        //release written pages and write busy ones
+        bool is_failed = false;
+        pthread_mutex_lock(&BM::buffer_manager_latch);
+        for(BM::flush_job& job : jobs){
+            for(blknum_t blknum : job.blks){
+                ctrl_blk* blk = &BM::ctrl_blk_list[blknum];
+                if(job.is_failed) blk->is_dirty = true;
+                else ST::add(blk->table_id, ST::DIRTY_FLUSHES);
+                BM::latch_unlock(&blk->latch);
+            }
+            is_failed |= job.is_failed;
+        }
+        //reverse order puts runs of neighbors back in their old order
+        for(size_t i = pinned.size(); i-- > 0; ){
+            BM::ctrl_blk_list[pinned[i].first].is_io_pinned = false;
+            BM::unpin_blk_after(pinned[i].first, pinned[i].second);
+        }
+        for(size_t i : busy){
+            blknum_t blknum = dirty[i].second;
+            if((size_t)blknum >= BM::BUFFER_SIZE) continue;
+            ctrl_blk* blk = &BM::ctrl_blk_list[blknum];
+
+            //wait until nobody modifies this frame
+            while(BM::latch_try_shared(&blk->latch)){
+                BM::latch_wait(&blk->latch);
+            }
+
+            //frame may be written back or reused while waiting
+            if(blk->is_dirty && blk->table_id == dirty[i].first.first && blk->pagenum == dirty[i].first.second){
+                try{
+                    BM::flush_frame_to_file(blknum);
+                    blk->is_dirty = false;
+                }
+                catch(const char* e){
+                    is_failed = true;
+                }
+            }
+            BM::latch_unlock(&blk->latch);
+        }
+        pthread_mutex_unlock(&BM::buffer_manager_latch);
+
+        if(is_failed) throw "write system call failed!";
+    }
+
+    void put_page_into_compressed_cache(blknum_t blknum){
+        if(!BM::COMPRESSED_CACHE_BYTES) return;
+
+        ctrl_blk* blk = &BM::ctrl_blk_list[blknum];
+        page_id pid = {blk->table_id, blk->pagenum};
+        auto it = BM::compressed_pages.find(pid);
+        if(it != BM::compressed_pages.end()){
+            //clean page read from cache is still there (changed page was dropped on write-back)
+            BM::compressed_lru.splice(BM::compressed_lru.end(), BM::compressed_lru, it->second.lru_it);
+            return;
+        }
+
+        uint8_t buf[COMPRESSED_PAGE_MAX_SIZE];
+        int size = lz_compress(reinterpret_cast<const uint8_t*>(BM::get_frame(blk)), PAGE_SIZE, buf, sizeof(buf));
+        if(!size) return; //doesn't save enough memory
+
+        BM::compressed_lru.push_back(pid);
+        BM::compressed_page& page = BM::compressed_pages[pid];
+        page.data.assign(buf, buf + size);
+        page.lru_it = std::prev(BM::compressed_lru.end());
+        BM::compressed_bytes += size + COMPRESSED_PAGE_OVERHEAD;
+
+        BM::shrink_compressed_cache(BM::COMPRESSED_CACHE_BYTES);
+    }
+
+    bool read_page_from_compressed_cache(const page_id& pid, page_t* dest){
+        auto it = BM::compressed_pages.find(pid);
+        if(it == BM::compressed_pages.end()) return false;
+
+        const std::vector<uint8_t>& data = it->second.data;
+        if(lz_decompress(data.data(), data.size(), reinterpret_cast<uint8_t*>(dest), PAGE_SIZE) != PAGE_SIZE){
+            //malformed, read file instead
+            BM::erase_from_compressed_cache(pid.first, pid.second, pid.second + 1);
+            return false;
+        }
+        return true;
+    }
+
+    void erase_from_compressed_cache(int64_t table_id, pagenum_t begin, pagenum_t end){
+        if(BM::compressed_pages.empty()) return;
+
+        auto erase = [](decltype(BM::compressed_pages)::iterator it){
+            BM::compressed_bytes -= it->second.data.size() + COMPRESSED_PAGE_OVERHEAD;
+            BM::compressed_lru.erase(it->second.lru_it);
+            return BM::compressed_pages.erase(it);
+        };
+
+        //look up each page of short range, or scan cache for long range
+        if(end - begin <= BM::compressed_pages.size()){
+            for(pagenum_t p = begin; p < end; p++){
+                auto it = BM::compressed_pages.find({table_id, p});
+                if(it != BM::compressed_pages.end()) erase(it);
+            }
+        }
+        else{
+            for(auto it = BM::compressed_pages.begin(); it != BM::compressed_pages.end(); ){
+                if(it->first.first == table_id && it->first.second >= begin && it->first.second < end) it = erase(it);
+                else it++;
+            }
+        }
+    }
+
+    void shrink_compressed_cache(size_t max_bytes){
+        while(BM::compressed_bytes > max_bytes && !BM::compressed_lru.empty()){
+            page_id pid = BM::compressed_lru.front();
+            BM::erase_from_compressed_cache(pid.first, pid.second, pid.second + 1);
+        }
+    }
+
+    hash_table_stripe* get_hash_table_stripe(const page_id& pid){
+        return &BM::hash_table[BM::hash_pair()(pid) % HASH_TABLE_STRIPES];
     }
 
     blknum_t find_ctrl_blk_in_hash_table(int64_t table_id, pagenum_t pagenum){
         page_id pid = {table_id, pagenum}; //make page_id to use as search key in hash table
-        if(BM::hash_table.find(pid)!=BM::hash_table.end()){
+        hash_table_stripe* stripe = BM::get_hash_table_stripe(pid);
+        auto it = stripe->table.find(pid);
+        if(it != stripe->table.end()){
             //found case
             //return corresponding block number
-            return BM::hash_table[pid];
+            return it->second;
         }
         else{
             //not found case
@@ -50,84 +446,484 @@ namespace BM{
         }
     }
 
-    blknum_t find_victim_blk_from_buffer(){
-        blknum_t cnt_blk = ctrl_blk_list_front; //get LRU block
-        bool is_acquired = false; //check whether find unlocked page
-        while(cnt_blk != -1){
-            //try to lock current page
-            int status_code = pthread_rwlock_trywrlock(&BM::ctrl_blk_list[cnt_blk].page_latch);
-            if(!status_code){
-                //acquired current blk's lock
-                is_acquired = true;
-                break;
+    void insert_into_hash_table(const page_id& pid, blknum_t blknum){
+        hash_table_stripe* stripe = BM::get_hash_table_stripe(pid);
+        pthread_rwlock_wrlock(&stripe->latch);
+        stripe->table[pid] = blknum;
+        pthread_rwlock_unlock(&stripe->latch);
+        BM::table_quotas[pid.first].frames++;
+    }
+
+    bool erase_from_hash_table(const page_id& pid){
+        hash_table_stripe* stripe = BM::get_hash_table_stripe(pid);
+        pthread_rwlock_wrlock(&stripe->latch);
+        bool ret = stripe->table.erase(pid);
+        pthread_rwlock_unlock(&stripe->latch);
+        if(ret) BM::table_quotas[pid.first].frames--;
+        return ret;
+    }
+
+    void clear_hash_table(){
+        for(hash_table_stripe& stripe : BM::hash_table){
+            pthread_rwlock_wrlock(&stripe.latch);
+            stripe.table.clear();
+            pthread_rwlock_unlock(&stripe.latch);
+        }
+        for(auto& quota : BM::table_quotas) quota.second.frames = 0;
+    }
+
+    bool read_cached_page(int64_t table_id, pagenum_t pagenum, page_t* dest){
+        //look up block in stripe
+        page_id pid = {table_id, pagenum};
+        hash_table_stripe* stripe = BM::get_hash_table_stripe(pid);
+        pthread_rwlock_rdlock(&stripe->latch);
+        auto it = stripe->table.find(pid);
+        blknum_t blknum = it != stripe->table.end() ? it->second : -1;
+        pthread_rwlock_unlock(&stripe->latch);
+        if(blknum == -1) return false;
+
+        //page id of block changes under exclusive page latch only,
+        //so check it again under shared page latch
+        ctrl_blk* blk = &BM::ctrl_blk_list[blknum];
+        if(BM::latch_try_shared(&blk->latch)) return false;
+        if(blk->table_id != table_id || blk->pagenum != pagenum || blk->is_prefetched){
+            BM::latch_unlock(&blk->latch);
+            return false;
+        }
+
+        memcpy(dest, BM::get_frame(blk), sizeof(page_t));
+        //write only on change (keep cache line shared among readers)
+        //hit of bulk operation doesn't count, so its ring can recycle the frame
+        if(!BM::strategy.ring_size && !blk->is_referenced.load(std::memory_order_relaxed)){
+            blk->is_referenced.store(true, std::memory_order_relaxed);
+        }
+        BM::latch_unlock(&blk->latch);
+
+        ST::add(table_id, ST::BUFFER_HITS);
+        return true;
+    }
+
+    bool is_protected_blk(blknum_t blknum){
+        auto it = BM::table_quotas.find(BM::ctrl_blk_list[blknum].table_id);
+        //unused or dropped frame has table id 0, which has no quota
+        if(it == BM::table_quotas.end() || !it->second.min_frames) return false;
+        return it->second.frames <= it->second.min_frames;
+    }
+
+    blknum_t find_victim_blk_in_quota(int64_t table_id){
+        if(!BM::number_of_quotas) return -1;
+
+        auto it = BM::table_quotas.find(table_id);
+        bool is_at_max = it != BM::table_quotas.end() && it->second.max_frames && it->second.frames >= it->second.max_frames;
+
+        //each block is visited at most once (skipped protected block comes again at the end)
+        size_t number_of_blks = 0;
+        for(blknum_t cnt_blk = BM::ctrl_blk_list_front, nxt_blk; cnt_blk != -1 && number_of_blks < BM::BUFFER_SIZE; cnt_blk = nxt_blk){
+            nxt_blk = BM::lru_list[cnt_blk].nxt;
+            number_of_blks++;
+            if(is_at_max){
+                //replace own page
+                if(BM::ctrl_blk_list[cnt_blk].table_id != table_id) continue;
+            }
+            else if(BM::is_protected_blk(cnt_blk)){
+                BM::move_blk_to_end(cnt_blk);
+                continue;
+            }
+            if(!BM::latch_try_exclusive(&BM::ctrl_blk_list[cnt_blk].latch)){
+                BM::pin_blk(cnt_blk);
+                BM::ctrl_blk_list[cnt_blk].is_referenced.store(false, std::memory_order_relaxed);
+                return cnt_blk;
             }
-            //get nxt LRU block
-            //since current block is pinned (can't evict)
-            cnt_blk = BM::ctrl_blk_list[cnt_blk].lru_nxt_blk_number;
         }
-        if(is_acquired){
-            //found case
-            //return corresponging block number
-            return cnt_blk;
+        return -1;
+    }
+
+    blknum_t find_victim_blk_from_buffer(int64_t table_id){
+        //give second chance to blocks hit without buffer manager latch
+        //(each block at most once, so this ends even if readers keep hitting)
+        for(size_t i = 0; i < BM::BUFFER_SIZE && BM::ctrl_blk_list_front != -1; i++){
+            blknum_t front = BM::ctrl_blk_list_front;
+            if(!BM::ctrl_blk_list[front].is_referenced.load(std::memory_order_relaxed)) break;
+            BM::ctrl_blk_list[front].is_referenced.store(false, std::memory_order_relaxed);
+            BM::move_blk_to_end(front);
         }
-        else{
+
+        if(BM::ctrl_blk_list_front == -1){
             //not found case
-            //return -1
+            //every block is pinned
             return -1;
         }
+
+        blknum_t quota_blk = BM::find_victim_blk_in_quota(table_id);
+        if(quota_blk != -1) return quota_blk;
+
+        //unpinned block is latched only by fast path reader copying page
+        //(other latch without pin is taken and released within one critical section),
+        //so take the first free one from LRU side
+        //one pass only, caller waits for busy block without buffer manager latch if all are busy
+        for(blknum_t cnt_blk = BM::ctrl_blk_list_front; cnt_blk != -1; cnt_blk = BM::lru_list[cnt_blk].nxt){
+            if(!BM::latch_try_exclusive(&BM::ctrl_blk_list[cnt_blk].latch)){
+                BM::pin_blk(cnt_blk);
+                BM::ctrl_blk_list[cnt_blk].is_referenced.store(false, std::memory_order_relaxed);
+                return cnt_blk;
+            }
+        }
+        return -1;
+    }
+
+    void release_victim_blk(blknum_t blknum){
+        BM::latch_unlock(&BM::ctrl_blk_list[blknum].latch);
+        BM::unpin_blk(blknum);
+        BM::move_blk_to_front(blknum);
+    }
+
+    blknum_t find_victim_blk_in_ring(){
+        BM::access_strategy& s = BM::strategy;
+        if(!s.ring_size || s.ring.size() < s.ring_size) return -1; //ring is not made yet
+
+        BM::ring_slot& slot = s.ring[s.cursor];
+        if((size_t)slot.blknum >= BM::BUFFER_SIZE) return -1; //removed by resize
+        ctrl_blk* blk = &BM::ctrl_blk_list[slot.blknum];
+        //page is evicted by others, used by others or pinned right now
+        if(blk->table_id != slot.pid.first || blk->pagenum != slot.pid.second) return -1;
+        if(blk->pin_count || blk->is_referenced.load(std::memory_order_relaxed)) return -1;
+        if(BM::latch_try_exclusive(&blk->latch)) return -1;
+
+        BM::pin_blk(slot.blknum);
+        return slot.blknum;
+    }
+
+    void put_blk_into_ring(blknum_t blknum, const page_id& pid){
+        BM::access_strategy& s = BM::strategy;
+        if(!s.ring_size) return;
+
+        if(s.ring.size() < s.ring_size){
+            s.ring.push_back({blknum, pid});
+            return;
+        }
+        //replace recycled (or given up) slot
+        s.ring[s.cursor] = {blknum, pid};
+        s.cursor = (s.cursor + 1) % s.ring_size;
     }
 
     void move_blk_to_end(blknum_t blknum){
-        //already back case
+        //already back or pinned case
+        //no operation needed
+        if(blknum == BM::ctrl_blk_list_back || BM::ctrl_blk_list[blknum].pin_count) return;
+
+        BM::unlink_blk(blknum);
+        BM::link_blk(blknum, false);
+    }
+
+    void move_blk_to_front(blknum_t blknum){
+        //already front or pinned case
         //no operation needed
-        if(blknum == BM::ctrl_blk_list_back) return;
+        if(blknum == BM::ctrl_blk_list_front || BM::ctrl_blk_list[blknum].pin_count) return;
+
+        BM::unlink_blk(blknum);
+        BM::link_blk(blknum, true);
+    }
+
+    void push_readahead_req(int64_t table_id, pagenum_t pagenum, uint64_t count){
+        pthread_mutex_lock(&BM::readahead_latch);
+        if(BM::readahead_queue.size() < MAX_READAHEAD_QUEUE_SIZE){
+            BM::readahead_queue.push_back({table_id, pagenum, count, false, BM::strategy.ring_size != 0});
+            pthread_cond_signal(&BM::readahead_cond);
+        }
+        pthread_mutex_unlock(&BM::readahead_latch);
+    }
+
+    void detect_sequential_miss(int64_t table_id, pagenum_t pagenum){
+        if(!BM::READAHEAD_PAGES) return; //disabled
+
+        BM::readahead_state& state = BM::readahead_states[table_id];
+        if(pagenum == state.last_miss_pagenum + 1) state.seq_count++;
+        else state.seq_count = 0;
+        state.last_miss_pagenum = pagenum;
+
+        //sequential access case
+        //read next window ahead
+        if(state.seq_count + 1 >= READAHEAD_TRIGGER_COUNT){
+            BM::push_readahead_req(table_id, pagenum + 1, BM::READAHEAD_PAGES);
+        }
+    }
+
+    void do_readahead(const readahead_req& req){
+        uint64_t number_of_pages;
+        try{
+            number_of_pages = file_get_number_of_pages(req.table_id);
+        }
+        catch(const char* e){
+            return; //table is closed, ignore request
+        }
+
+        //claimed blocks (sorted by pagenum)
+        std::vector<blknum_t> claimed;
+
+        //start cirtical section
+        pthread_mutex_lock(&BM::buffer_manager_latch);
+
+        //don't take more than quarter of buffer
+        //to leave frames for foreground miss
+        //(warm-up takes unused frames only, so it has no such limit)
+        uint64_t max_claim = req.is_warmup ? req.count : std::min<uint64_t>(req.count, BM::BUFFER_SIZE / 4);
+        bool is_buffer_full = false;
+        for(pagenum_t p = req.pagenum; p < req.pagenum + req.count && claimed.size() < max_claim; p++){
+            //never read header page ahead (it's written through file layer)
+            if(!p || p >= number_of_pages) break;
+            //already in buffer or in compressed cache (miss takes it from there without I/O)
+            if(BM::find_ctrl_blk_in_hash_table(req.table_id, p) != -1) continue;
+            if(BM::compressed_pages.count({req.table_id, p})) continue;
+
+            //get victim block (pinned and write locked)
+            blknum_t blknum = BM::find_victim_blk_from_buffer(req.table_id);
+            if(blknum == -1) break;
+            ctrl_blk* blk = &BM::ctrl_blk_list[blknum];
+            if(blk->is_dirty){
+                //use clean frame only
+                //readahead shouldn't make foreground wait for write-back
+                BM::release_victim_blk(blknum);
+                break;
+            }
+            if(req.is_warmup && BM::find_ctrl_blk_in_hash_table(blk->table_id, blk->pagenum) != -1){
+                //warm-up never evicts page
+                BM::release_victim_blk(blknum);
+                is_buffer_full = true;
+                break;
+            }
+
+            //update hash table and block info
+            if(BM::erase_from_hash_table({blk->table_id, blk->pagenum})){
+                ST::add(blk->table_id, ST::EVICTIONS);
+                BM::put_page_into_compressed_cache(blknum);
+            }
+            BM::insert_into_hash_table({req.table_id, p}, blknum);
+            blk->table_id = req.table_id;
+            blk->pagenum = p;
+            blk->is_dirty = false;
+            blk->is_prefetched = true;
+            blk->is_io_pinned = true;
+
+            claimed.push_back(blknum);
+        }
+
+        //end cirtical section
+        //readers of claimed pages find them in hash table and wait for page latch
+        pthread_mutex_unlock(&BM::buffer_manager_latch);
+
+        //no unused frame left, drop remaining warm-up
+        if(is_buffer_full){
+            pthread_mutex_lock(&BM::readahead_latch);
+            BM::warmup_queue.clear();
+            pthread_mutex_unlock(&BM::readahead_latch);
+        }
+
+        //read claimed pages
+        //contiguous pages are read with one vectored I/O
+        bool is_failed = false;
+        std::vector<page_t*> dests;
+        for(size_t i = 0; i < claimed.size() && !is_failed; ){
+            size_t j = i;
+            dests.clear();
+            while(j < claimed.size() && BM::ctrl_blk_list[claimed[j]].pagenum == BM::ctrl_blk_list[claimed[i]].pagenum + (j - i)){
+                dests.push_back(&BM::frame_list[claimed[j]]);
+                j++;
+            }
+            try{
+                file_read_pages(req.table_id, BM::ctrl_blk_list[claimed[i]].pagenum, dests.size(), dests.data());
+            }
+            catch(const char* e){
+                is_failed = true;
+            }
+            i = j;
+        }
 
-        ctrl_blk* cnt_blk = &BM::ctrl_blk_list[blknum]; //get block in list
+        //release claimed frames and wake up waiting readers
+        pthread_mutex_lock(&BM::buffer_manager_latch);
+        for(blknum_t blknum : claimed){
+            ctrl_blk* blk = &BM::ctrl_blk_list[blknum];
+            if(is_failed){
+                //drop all pages of failed request
+                BM::erase_from_hash_table({blk->table_id, blk->pagenum});
+                blk->table_id = 0;
+                blk->pagenum = 0;
+                blk->is_prefetched = false;
+            }
+            BM::latch_unlock(&blk->latch);
+            blk->is_io_pinned = false;
+            BM::unpin_blk(blknum);
+            //don't push working set out for bulk operation
+            if(req.is_bulk) BM::move_blk_to_front(blknum);
+        }
+        pthread_mutex_unlock(&BM::buffer_manager_latch);
+    }
+
+    void* readahead_thread_func(void* arg){
+        pthread_mutex_lock(&BM::readahead_latch);
+        while(true){
+            while(!BM::is_readahead_thread_stopped && BM::readahead_queue.empty() && BM::warmup_queue.empty()){
+                pthread_cond_wait(&BM::readahead_cond, &BM::readahead_latch);
+            }
+            if(BM::is_readahead_thread_stopped) break;
 
-        //if current block is at front of LRU list
-        //set front to next pointer
-        if(blknum == ctrl_blk_list_front){
-            ctrl_blk_list_front = cnt_blk->lru_nxt_blk_number;
+            //readahead of running scan goes before warm-up
+            std::deque<BM::readahead_req>& queue = BM::readahead_queue.empty() ? BM::warmup_queue : BM::readahead_queue;
+            BM::readahead_req req = queue.front();
+            queue.pop_front();
+
+            //do I/O without readahead latch
+            pthread_mutex_unlock(&BM::readahead_latch);
+            BM::do_readahead(req);
+            pthread_mutex_lock(&BM::readahead_latch);
+        }
+        pthread_mutex_unlock(&BM::readahead_latch);
+        return nullptr;
+    }
+
+    void start_readahead_thread(){
+        //already running case
+        if(BM::is_readahead_thread_running) return;
+
+        BM::is_readahead_thread_stopped = false;
+        if(pthread_create(&BM::readahead_thread, NULL, BM::readahead_thread_func, NULL)){
+            throw "can't create readahead thread";
         }
+        BM::is_readahead_thread_running = true;
+    }
 
-        //connect their neighbors
-        if(cnt_blk->lru_prv_blk_number >= 0) BM::ctrl_blk_list[cnt_blk->lru_prv_blk_number].lru_nxt_blk_number = cnt_blk->lru_nxt_blk_number;
-        if(cnt_blk->lru_nxt_blk_number >= 0) BM::ctrl_blk_list[cnt_blk->lru_nxt_blk_number].lru_prv_blk_number = cnt_blk->lru_prv_blk_number;
+    void stop_readahead_thread(){
+        //not running case
+        if(!BM::is_readahead_thread_running) return;
 
-        //append to end of list
-        cnt_blk->lru_prv_blk_number = ctrl_blk_list_back;
-        cnt_blk->lru_nxt_blk_number = BM::ctrl_blk_list[ctrl_blk_list_back].lru_nxt_blk_number;
-        BM::ctrl_blk_list[ctrl_blk_list_back].lru_nxt_blk_number = blknum;
+        //set stop flag and wake up thread
+        pthread_mutex_lock(&BM::readahead_latch);
+        BM::is_readahead_thread_stopped = true;
+        BM::readahead_queue.clear();
+        BM::warmup_queue.clear();
+        pthread_cond_signal(&BM::readahead_cond);
+        pthread_mutex_unlock(&BM::readahead_latch);
 
-        //set end to given number
-        BM::ctrl_blk_list_back = blknum;
+        pthread_join(BM::readahead_thread, NULL);
+        BM::is_readahead_thread_running = false;
     }
 
-    ctrl_blk* get_ctrl_blk_from_buffer(int64_t table_id, pagenum_t pagenum){
+    void load_warmup_file(){
+        BM::warmup_pages.clear();
+        FILE* fp = fopen(BM::WARMUP_PATH.c_str(), "r");
+        if(!fp) return; //first run
+
+        char line[PATH_MAX + 64];
+        if(!fgets(line, sizeof(line), fp) || strncmp(line, WARMUP_FILE_HEADER, strlen(WARMUP_FILE_HEADER))){
+            fclose(fp);
+            return; //not a warm-up file
+        }
+
+        std::unordered_map<int, std::string> paths; //table index -> path
+        size_t number_of_pages = 0;
+        while(number_of_pages < BM::BUFFER_SIZE && fgets(line, sizeof(line), fp)){
+            int idx, len;
+            unsigned long long pagenum;
+            if(sscanf(line, "table %d %n", &idx, &len) == 1){
+                std::string path(line + len);
+                if(!path.empty() && path.back() == '\n') path.pop_back();
+                paths[idx] = path;
+            }
+            else if(sscanf(line, "page %d %llu", &idx, &pagenum) == 2 && paths.count(idx) && pagenum){
+                BM::warmup_pages[paths[idx]].push_back(pagenum);
+                number_of_pages++;
+            }
+        }
+        fclose(fp);
+    }
+
+    void save_warmup_file(){
+        //write new list into temporary file and replace old one
+        std::string tmp_path = BM::WARMUP_PATH + ".tmp";
+        FILE* fp = fopen(tmp_path.c_str(), "w");
+        if(!fp) return; //warm-up is only a hint
+        fprintf(fp, "%s\n", WARMUP_FILE_HEADER);
+
+        //walk LRU list from most recently used block
+        std::unordered_map<int64_t, int> indexes; //table id -> table index
+        for(blknum_t i = BM::ctrl_blk_list_back; i != -1; i = BM::lru_list[i].prv){
+            BM::ctrl_blk* blk = &BM::ctrl_blk_list[i];
+            if(!blk->pagenum || BM::find_ctrl_blk_in_hash_table(blk->table_id, blk->pagenum) != i) continue;
+
+            auto it = indexes.find(blk->table_id);
+            if(it == indexes.end()){
+                const char* path;
+                try{
+                    path = file_get_table_path(blk->table_id);
+                }
+                catch(const char* e){
+                    continue; //table is already closed
+                }
+                it = indexes.emplace(blk->table_id, (int)indexes.size()).first;
+                fprintf(fp, "table %d %s\n", it->second, path);
+            }
+            fprintf(fp, "page %d %lu\n", it->second, blk->pagenum);
+        }
+
+        if(fclose(fp) || rename(tmp_path.c_str(), BM::WARMUP_PATH.c_str())) remove(tmp_path.c_str());
+    }
+
+    ctrl_blk* get_ctrl_blk_from_buffer(int64_t table_id, pagenum_t pagenum, bool* is_miss){
         //find ctrl block in the list by using hash table
         blknum_t cnt_blk = BM::find_ctrl_blk_in_hash_table(table_id, pagenum);
+        blknum_t victim_blk = -1;
+        while(cnt_blk == -1){
+            //not found case
+            //need eviction for space
+
+            //get victim block number (pinned and write locked)
+            //bulk operation recycles its own ring first
+            victim_blk = BM::find_victim_blk_in_ring();
+            if(victim_blk == -1) victim_blk = BM::find_victim_blk_from_buffer(table_id);
+            if(victim_blk != -1) break;
+
+            blknum_t busy_blk = BM::ctrl_blk_list_front;
+            if(busy_blk == -1){
+                //every block is pinned
+                //pins of readahead and checkpoint go away after their I/O, so wait for one of them
+                busy_blk = BM::find_io_pinned_blk();
+                if(busy_blk == -1){
+                    //can't get victim block
+                    //every block is pinned by callers, can't evict page so can't get such block
+                    pthread_mutex_unlock(&BM::buffer_manager_latch);
+                    throw "can't evict page from buffer";
+                }
+            }
+
+            //every unpinned block is latched for a moment by fast path reader
+            //wait for one without buffer manager latch, then page may be loaded by others
+            BM::latch_wait(&BM::ctrl_blk_list[busy_blk].latch);
+            cnt_blk = BM::find_ctrl_blk_in_hash_table(table_id, pagenum);
+        }
         ctrl_blk* ret_blk; //return value
         if(cnt_blk != -1){
             //found case
             //get block from list
             ret_blk = &BM::ctrl_blk_list[cnt_blk];
-        }
-        else{
-            //not found case
-            //need eviction for space
 
-            //get victim block number
-            cnt_blk = BM::find_victim_blk_from_buffer();
+            if(ret_blk->is_prefetched){
+                //first access to page read ahead
+                //sequential access goes on, so keep window ahead of it
+                ret_blk->is_prefetched = false;
+                if(BM::READAHEAD_PAGES) BM::push_readahead_req(table_id, pagenum + 1, BM::READAHEAD_PAGES);
 
-            if(cnt_blk == -1){
-                //can't get victim block
-                //can't evict page so can't get such block
-                pthread_mutex_unlock(&BM::buffer_manager_latch);
-                throw "can't evict page from buffer";
+                //page read ahead for bulk operation stays as the next victim
+                if(BM::strategy.ring_size) return ret_blk;
             }
 
-            //get block from list
+            //update LRU list
+            BM::move_blk_to_end(cnt_blk);
+        }
+        else{
+            //get victim block from list
+            cnt_blk = victim_blk;
             ret_blk = &BM::ctrl_blk_list[cnt_blk];
+            if(is_miss) *is_miss = true;
+            ST::io_timer_t timer(table_id, STATS_BUFFER_MISS, 0);
             
             if(ret_blk->is_dirty){
                 //flush changes to disk if needed
@@ -135,22 +931,36 @@ namespace BM{
             }
 
             //update hash table
-            BM::hash_table.erase({ret_blk->table_id, ret_blk->pagenum});
-            BM::hash_table[{table_id, pagenum}] = cnt_blk;
+            //(evicted page is clean now, keep it compressed in second tier)
+            if(BM::erase_from_hash_table({ret_blk->table_id, ret_blk->pagenum})){
+                ST::add(ret_blk->table_id, ST::EVICTIONS);
+                BM::put_page_into_compressed_cache(cnt_blk);
+            }
+            BM::insert_into_hash_table({table_id, pagenum}, cnt_blk);
             
             //init block info
             ret_blk->pagenum = pagenum;
             ret_blk->table_id = table_id;
             ret_blk->is_dirty = 0;
+            ret_blk->is_prefetched = false;
+            BM::put_blk_into_ring(cnt_blk, {table_id, pagenum});
+
+            //check sequential access for readahead
+            BM::detect_sequential_miss(table_id, pagenum);
             
-            //read page from disk by call DSM api
-            file_read_page(table_id, pagenum, ret_blk->frame_ptr);
+            //read page from compressed cache or from disk by call DSM api
+            if(BM::read_page_from_compressed_cache({table_id, pagenum}, BM::get_frame(ret_blk))){
+                ST::add(table_id, ST::COMPRESSED_HITS);
+            }
+            else{
+                file_read_page(table_id, pagenum, BM::get_frame(ret_blk));
+            }
 
             //unlock to be evicted page
-            pthread_rwlock_unlock(&ret_blk->page_latch);
+            //(unpin puts it at end of LRU list)
+            BM::latch_unlock(&ret_blk->latch);
+            BM::unpin_blk(cnt_blk);
         }
-        //update LRU list
-        BM::move_blk_to_end(cnt_blk);
 
         return ret_blk;
     }
@@ -158,58 +968,244 @@ namespace BM{
 }
 
 //allocate the buffer pool with the given number of entries
-int init_buffer(int num_buf){
+int init_buffer(int num_buf, const char* warmup_pathname){
+    if(num_buf < 1) return -1;
     BM::BUFFER_SIZE = num_buf; //set buffer size
 
     BM::buffer_manager_latch = PTHREAD_MUTEX_INITIALIZER;
 
     //init list
-    BM::frame_list = new frame_t[num_buf];
-    BM::ctrl_blk_list = new BM::ctrl_blk[num_buf];
+    //reserve address space for the largest pool so that resize never moves frames
+    //(explicit huge pages are taken for num_buf frames only)
+    //frames are aligned in PAGE_SIZE to be used as direct I/O buffer (one more frame for alignment)
+    BM::huge_page_mode = BM::HUGE_PAGE_MODE;
+    BM::frame_memory_length = (num_buf + 1) * sizeof(frame_t);
+    BM::frame_memory = nullptr;
+    if(BM::huge_page_mode == BUFFER_HUGE_PAGE_EXPLICIT){
+        BM::frame_memory = BM::alloc_memory(&BM::frame_memory_length, &BM::huge_page_mode);
+    }
+    bool is_explicit = BM::huge_page_mode == BUFFER_HUGE_PAGE_EXPLICIT;
+    int frame_mode = BM::huge_page_mode;
+    if(is_explicit){
+        //every frame in huge pages is usable
+        BM::BUFFER_CAPACITY = BM::frame_memory_length / sizeof(frame_t);
+    }
+    else BM::BUFFER_CAPACITY = std::max<size_t>(num_buf, MAX_BUFFER_BYTES / PAGE_SIZE);
+    while(true){
+        if(!is_explicit){
+            BM::huge_page_mode = frame_mode;
+            BM::frame_memory_length = (BM::BUFFER_CAPACITY + 1) * sizeof(frame_t);
+            BM::frame_memory = BM::alloc_memory(&BM::frame_memory_length, &BM::huge_page_mode);
+        }
+        //control blocks follow mode of frames
+        BM::ctrl_blk_memory_length = BM::BUFFER_CAPACITY * sizeof(BM::ctrl_blk);
+        int ctrl_blk_mode = BM::huge_page_mode;
+        BM::ctrl_blk_memory = BM::alloc_memory(&BM::ctrl_blk_memory_length, &ctrl_blk_mode);
+        BM::lru_memory_length = BM::BUFFER_CAPACITY * sizeof(BM::lru_node);
+        int lru_mode = BM::huge_page_mode;
+        BM::lru_memory = BM::alloc_memory(&BM::lru_memory_length, &lru_mode);
+        if(BM::frame_memory && BM::ctrl_blk_memory && BM::lru_memory) break;
+
+        if(BM::ctrl_blk_memory) munmap(BM::ctrl_blk_memory, BM::ctrl_blk_memory_length);
+        if(BM::lru_memory) munmap(BM::lru_memory, BM::lru_memory_length);
+        if(!is_explicit && BM::BUFFER_CAPACITY > (size_t)num_buf){
+            //address space is limited (no overcommit or RLIMIT_AS)
+            //reserve num_buf frames only, then pool can't grow beyond it
+            if(BM::frame_memory) munmap(BM::frame_memory, BM::frame_memory_length);
+            BM::BUFFER_CAPACITY = num_buf;
+            continue;
+        }
+        if(BM::frame_memory) munmap(BM::frame_memory, BM::frame_memory_length);
+        return -1; //allocation failed
+    }
+    uintptr_t frame_addr = (reinterpret_cast<uintptr_t>(BM::frame_memory) + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    BM::frame_list = reinterpret_cast<frame_t*>(frame_addr);
+    BM::ctrl_blk_list = reinterpret_cast<BM::ctrl_blk*>(BM::ctrl_blk_memory);
+    BM::lru_list = reinterpret_cast<BM::lru_node*>(BM::lru_memory);
 
     for(int i=0; i<num_buf; i++){
         //point corresponding frame and connect neighbor control block
         //with prev and next block number
         //set -1 if not existed
-        memset(BM::ctrl_blk_list + i,0,sizeof(BM::ctrl_blk));
-        BM::ctrl_blk_list[i].frame_ptr = &BM::frame_list[i];
-        BM::ctrl_blk_list[i].lru_nxt_blk_number = i+1 < num_buf ? i+1 : -1;
-        BM::ctrl_blk_list[i].lru_prv_blk_number = i-1;
-        BM::ctrl_blk_list[i].is_dirty = false;
-        BM::ctrl_blk_list[i].page_latch = PTHREAD_RWLOCK_INITIALIZER;
+        new (BM::ctrl_blk_list + i) BM::ctrl_blk();
+        BM::lru_list[i].nxt = i+1 < num_buf ? i+1 : -1;
+        BM::lru_list[i].prv = i-1;
     }
 
     //set front and back in the list
     BM::ctrl_blk_list_front = 0;
     BM::ctrl_blk_list_back = num_buf - 1;
 
+    //init compressed cache (disabled)
+    BM::COMPRESSED_CACHE_BYTES = 0;
+    BM::shrink_compressed_cache(0);
+
     //init hash table
-    BM::hash_table.clear();
+    BM::table_quotas.clear();
+    BM::number_of_quotas = 0;
+    BM::clear_hash_table();
+
+    //init warm-up
+    BM::WARMUP_PATH = warmup_pathname ? warmup_pathname : "";
+    if(!BM::WARMUP_PATH.empty()) BM::load_warmup_file();
+    else BM::warmup_pages.clear();
+
+    //init readahead
+    BM::readahead_states.clear();
+    try{
+        BM::start_readahead_thread();
+    }
+    catch(const char* e){
+        return -1;
+    }
 
     return 0;
 }
 
+// Set huge page mode used by the next init_buffer
+void buffer_set_huge_page_mode(int mode){
+    BM::HUGE_PAGE_MODE = mode;
+}
+
+// Get huge page mode actually used by current buffer pool
+int buffer_get_huge_page_mode(){
+    return BM::huge_page_mode;
+}
+
+// Change the number of frames in buffer pool
+int buffer_resize(int num_buf){
+    if(num_buf < 1 || (size_t)num_buf > BM::BUFFER_CAPACITY) return -1;
+
+    //one resize at a time (buffer manager latch is released during waits and write-back)
+    pthread_mutex_lock(&BM::resize_latch);
+
+    //start cirtical section
+    pthread_mutex_lock(&BM::buffer_manager_latch);
+
+    //grow case
+    //new frames are unused, so they are taken first on miss
+    for(size_t i = BM::BUFFER_SIZE; i < (size_t)num_buf; i++) BM::add_blk(i);
+
+    //shrink case
+    //evict removed frames one by one from the last
+    for(size_t i = BM::BUFFER_SIZE; i > (size_t)num_buf; i--){
+        blknum_t blknum = i - 1;
+        BM::ctrl_blk* blk = &BM::ctrl_blk_list[blknum];
+
+        //wait until nobody uses this frame
+        //(it can get other page while waiting, it is evicted anyway)
+        while(BM::latch_try_exclusive(&blk->latch)){
+            BM::latch_wait(&blk->latch);
+        }
+
+        //no victim search picks this block any more
+        //(exclusive latch is taken, so nobody else pins it)
+        BM::pin_blk(blknum);
+
+        if(blk->is_dirty){
+            //write back without buffer manager latch
+            //page stays in hash table, so readers wait for it instead of reading old content from disk
+            blk->is_io_pinned = true;
+            BM::erase_from_compressed_cache(blk->table_id, blk->pagenum, blk->pagenum + 1);
+            pthread_mutex_unlock(&BM::buffer_manager_latch);
+            bool is_failed = false;
+            try{
+                file_write_page(blk->table_id, blk->pagenum, BM::get_frame(blk));
+                ST::add(blk->table_id, ST::DIRTY_FLUSHES);
+            }
+            catch(const char* e){
+                is_failed = true;
+            }
+            pthread_mutex_lock(&BM::buffer_manager_latch);
+            blk->is_io_pinned = false;
+            if(is_failed){
+                //keep this frame and the rest
+                BM::unpin_blk(blknum);
+                BM::latch_unlock(&blk->latch);
+                pthread_mutex_unlock(&BM::buffer_manager_latch);
+                pthread_mutex_unlock(&BM::resize_latch);
+                return -1;
+            }
+        }
+
+        //retire this frame (unlinked by pin above, never linked again)
+        if(BM::erase_from_hash_table({blk->table_id, blk->pagenum})) ST::add(blk->table_id, ST::EVICTIONS);
+        blk->table_id = 0;
+        blk->pagenum = 0;
+        blk->is_dirty = false;
+        blk->is_prefetched = false;
+        blk->pin_count = 0;
+        BM::BUFFER_SIZE = blknum;
+        BM::latch_unlock(&blk->latch);
+
+        //return frame memory to system
+        madvise(BM::get_frame(blk), sizeof(frame_t), MADV_DONTNEED);
+    }
+    BM::BUFFER_SIZE = num_buf;
+
+    //end cirtical section
+    pthread_mutex_unlock(&BM::buffer_manager_latch);
+    pthread_mutex_unlock(&BM::resize_latch);
+    return 0;
+}
+
+// Get the number of frames in buffer pool
+int buffer_get_size(){
+    pthread_mutex_lock(&BM::buffer_manager_latch);
+    int ret = BM::BUFFER_SIZE;
+    pthread_mutex_unlock(&BM::buffer_manager_latch);
+    return ret;
+}
+
 // Allocate a page
 pagenum_t buffer_alloc_page(int64_t table_id){
+    table_id = file_get_space_id(table_id);
+
     //read new page
     pagenum_t nxt_page_number = file_alloc_page(table_id);
     
+    //start cirtical section
+    //(readahead thread changes buffer concurrently)
+    pthread_mutex_lock(&BM::buffer_manager_latch);
+
+    //file layer wiped the page, so old content in compressed cache is stale
+    BM::erase_from_compressed_cache(table_id, nxt_page_number, nxt_page_number + 1);
+
     //load new page
     BM::ctrl_blk* nxt_blk = BM::get_ctrl_blk_from_buffer(table_id, nxt_page_number);
-    pthread_rwlock_wrlock(&nxt_blk->page_latch);
+    while(BM::latch_try_exclusive(&nxt_blk->latch)){
+        BM::latch_wait(&nxt_blk->latch);
+        nxt_blk = BM::get_ctrl_blk_from_buffer(table_id, nxt_page_number);
+    }
+    BM::pin_blk(nxt_blk - BM::ctrl_blk_list); //hold until write
+
+    //end cirtical section
+    pthread_mutex_unlock(&BM::buffer_manager_latch);
 
     return nxt_page_number;
 }
 
 // Free a page
 void buffer_free_page(int64_t table_id, pagenum_t pagenum){
+    table_id = file_get_space_id(table_id);
+
+    //start cirtical section
+    pthread_mutex_lock(&BM::buffer_manager_latch);
+    BM::erase_from_compressed_cache(table_id, pagenum, pagenum + 1);
     BM::ctrl_blk* cnt_blk = BM::get_ctrl_blk_from_buffer(table_id, pagenum);
     cnt_blk->is_dirty = 0; //wipe block to be freed
+    //end cirtical section
+    pthread_mutex_unlock(&BM::buffer_manager_latch);
     return file_free_page(table_id, pagenum);
 }
 
 // read a page from buffer
 void buffer_read_page(int64_t table_id, pagenum_t pagenum, page_t* dest, int lock_policy){
+    table_id = file_get_space_id(table_id);
+
+    //cached page without lock is read without buffer manager latch
+    if(lock_policy == BUFFER_NO_LOCK_MODE && BM::read_cached_page(table_id, pagenum, dest)) return;
+
     int status_code; //check for pthread error
 
     //start cirtical section
@@ -217,29 +1213,37 @@ void buffer_read_page(int64_t table_id, pagenum_t pagenum, page_t* dest, int loc
     if(status_code) throw "pthread error occurred";
 
     //get block from buffer
-    BM::ctrl_blk* ret_blk = BM::get_ctrl_blk_from_buffer(table_id,pagenum);
+    //(a request is a miss if page is loaded by any lookup of it)
+    bool is_miss = false;
+    BM::ctrl_blk* ret_blk = BM::get_ctrl_blk_from_buffer(table_id,pagenum,&is_miss);
     
     if(lock_policy != BUFFER_WRITE_LOCK_MODE){
         //shared lock case
-        while(pthread_rwlock_tryrdlock(&ret_blk->page_latch)){
-            pthread_cond_wait(&ret_blk->cond,&BM::buffer_manager_latch);
-            ret_blk = BM::get_ctrl_blk_from_buffer(table_id,pagenum);
+        while(BM::latch_try_shared(&ret_blk->latch)){
+            BM::latch_wait(&ret_blk->latch);
+            ret_blk = BM::get_ctrl_blk_from_buffer(table_id,pagenum,&is_miss);
         }
     }
     else{
         //exclusive lock case
-        while(pthread_rwlock_trywrlock(&ret_blk->page_latch)){
-            pthread_cond_wait(&ret_blk->cond,&BM::buffer_manager_latch);
-            ret_blk = BM::get_ctrl_blk_from_buffer(table_id,pagenum);
+        while(BM::latch_try_exclusive(&ret_blk->latch)){
+            BM::latch_wait(&ret_blk->latch);
+            ret_blk = BM::get_ctrl_blk_from_buffer(table_id,pagenum,&is_miss);
         }
     }
+    ST::add(table_id, is_miss ? ST::BUFFER_MISSES : ST::BUFFER_HITS);
 
     //copy page content to dest
-    memcpy(dest,ret_blk->frame_ptr,sizeof(page_t));
+    memcpy(dest,BM::get_frame(ret_blk),sizeof(page_t));
 
     if(lock_policy == BUFFER_NO_LOCK_MODE){
         //don't lock anymore
-        pthread_rwlock_unlock(&ret_blk->page_latch);
+        //(released in this critical section, so no pin is needed)
+        BM::latch_unlock(&ret_blk->latch);
+    }
+    else{
+        //hold until write
+        BM::pin_blk(ret_blk - BM::ctrl_blk_list);
     }
 
     //end cirtical section
@@ -251,6 +1255,8 @@ void buffer_read_page(int64_t table_id, pagenum_t pagenum, page_t* dest, int loc
 // read a page from buffer directly
 // return frame pointer
 page_t* buffer_direct_read_page(int64_t table_id, pagenum_t pagenum){
+    table_id = file_get_space_id(table_id);
+
     int status_code; //check for pthread error
 
     //start cirtical section
@@ -258,22 +1264,27 @@ page_t* buffer_direct_read_page(int64_t table_id, pagenum_t pagenum){
     if(status_code) throw "pthread error occurred";
 
     //get block from buffer
-    BM::ctrl_blk* ret_blk = BM::get_ctrl_blk_from_buffer(table_id,pagenum);
+    bool is_miss = false;
+    BM::ctrl_blk* ret_blk = BM::get_ctrl_blk_from_buffer(table_id,pagenum,&is_miss);
     
     //shared lock case
-    while(pthread_rwlock_tryrdlock(&ret_blk->page_latch)){
-       pthread_cond_wait(&ret_blk->cond,&BM::buffer_manager_latch);
-       ret_blk = BM::get_ctrl_blk_from_buffer(table_id,pagenum);
+    while(BM::latch_try_shared(&ret_blk->latch)){
+       BM::latch_wait(&ret_blk->latch);
+       ret_blk = BM::get_ctrl_blk_from_buffer(table_id,pagenum,&is_miss);
     }
+    ST::add(table_id, is_miss ? ST::BUFFER_MISSES : ST::BUFFER_HITS);
+    BM::pin_blk(ret_blk - BM::ctrl_blk_list); //hold until direct write
 
     //end cirtical section
     status_code = pthread_mutex_unlock(&BM::buffer_manager_latch);
     if(status_code) throw "pthread error occurred";
-    return ret_blk->frame_ptr; //return page pointer directly
+    return BM::get_frame(ret_blk); //return page pointer directly
 }
 
 // Write a page to buffer and release page latch
 void buffer_write_page(int64_t table_id, pagenum_t pagenum, const page_t* src){
+    table_id = file_get_space_id(table_id);
+
     int status_code; //check for pthread error
 
     //start cirtical section
@@ -283,22 +1294,22 @@ void buffer_write_page(int64_t table_id, pagenum_t pagenum, const page_t* src){
     //get block from buffer
     BM::ctrl_blk* ret_blk = BM::get_ctrl_blk_from_buffer(table_id,pagenum);
     
-    if(!pthread_rwlock_trywrlock(&ret_blk->page_latch)){
+    if(!BM::latch_try_exclusive(&ret_blk->latch)){
         //not pinned case
         //there should be lock before write API
-        pthread_rwlock_unlock(&ret_blk->page_latch);
+        BM::latch_unlock(&ret_blk->latch);
         pthread_mutex_unlock(&BM::buffer_manager_latch);
         throw "invalid write api call";
     }
 
     if(src){
         //copy page content to dest only if there is changes
-        memcpy(ret_blk->frame_ptr,src,sizeof(page_t));
+        memcpy(BM::get_frame(ret_blk),src,sizeof(page_t));
         ret_blk->is_dirty = true; //set dirty bit on
     }
 
-    pthread_rwlock_unlock(&ret_blk->page_latch); //unlock current page
-    pthread_cond_broadcast(&ret_blk->cond); //broadcast to other thread
+    BM::latch_unlock(&ret_blk->latch); //unlock current page
+    BM::unpin_blk(ret_blk - BM::ctrl_blk_list);
 
     //end cirtical section
     status_code = pthread_mutex_unlock(&BM::buffer_manager_latch);
@@ -309,6 +1320,8 @@ void buffer_write_page(int64_t table_id, pagenum_t pagenum, const page_t* src){
 // write(unpin) a page directly
 // unlock latch and apply dirty flag
 void buffer_direct_write_page(int64_t table_id, pagenum_t pagenum, bool is_dirty){
+    table_id = file_get_space_id(table_id);
+
     int status_code; //check for pthread error
 
     //start cirtical section
@@ -318,18 +1331,18 @@ void buffer_direct_write_page(int64_t table_id, pagenum_t pagenum, bool is_dirty
     //get block from buffer
     BM::ctrl_blk* ret_blk = BM::get_ctrl_blk_from_buffer(table_id,pagenum);
     
-    if(!pthread_rwlock_trywrlock(&ret_blk->page_latch)){
+    if(!BM::latch_try_exclusive(&ret_blk->latch)){
         //not pinned case
         //there should be lock before write API
-        pthread_rwlock_unlock(&ret_blk->page_latch);
+        BM::latch_unlock(&ret_blk->latch);
         pthread_mutex_unlock(&BM::buffer_manager_latch);
         throw "invalid write api call";
     }
 
     ret_blk->is_dirty |= is_dirty; //set dirty pin
 
-    pthread_rwlock_unlock(&ret_blk->page_latch); //unlock current page
-    pthread_cond_broadcast(&ret_blk->cond); //broadcast to other thread
+    BM::latch_unlock(&ret_blk->latch); //unlock current page
+    BM::unpin_blk(ret_blk - BM::ctrl_blk_list);
 
     //end cirtical section
     status_code = pthread_mutex_unlock(&BM::buffer_manager_latch);
@@ -337,13 +1350,191 @@ void buffer_direct_write_page(int64_t table_id, pagenum_t pagenum, bool is_dirty
     return;
 }
 
+// Hint that given contiguous pages will be read soon
+void buffer_prefetch_pages(int64_t table_id, pagenum_t pagenum, uint64_t count){
+    table_id = file_get_space_id(table_id);
+
+    if(!count) return;
+    BM::push_readahead_req(table_id, pagenum, count);
+}
+
+// Prefetch pages of given table file listed in warm-up file
+void buffer_warm_up_table(int64_t table_id){
+    table_id = file_get_space_id(table_id);
+    const char* path = file_get_table_path(table_id);
+
+    //take page list of this table
+    pthread_mutex_lock(&BM::buffer_manager_latch);
+    auto it = BM::warmup_pages.find(path);
+    if(it == BM::warmup_pages.end()){
+        pthread_mutex_unlock(&BM::buffer_manager_latch);
+        return;
+    }
+    std::vector<pagenum_t> pages = std::move(it->second);
+    BM::warmup_pages.erase(it);
+    pthread_mutex_unlock(&BM::buffer_manager_latch);
+
+    //make requests of contiguous runs in page number order
+    std::sort(pages.begin(), pages.end());
+    pthread_mutex_lock(&BM::readahead_latch);
+    for(size_t i = 0; i < pages.size(); ){
+        size_t j = i + 1;
+        while(j < pages.size() && j - i < MAX_IOV_PAGES && pages[j] == pages[i] + (j - i)) j++;
+        BM::warmup_queue.push_back({table_id, pages[i], j - i, true, false});
+        i = j;
+    }
+    pthread_cond_signal(&BM::readahead_cond);
+    pthread_mutex_unlock(&BM::readahead_latch);
+}
+
+// Set access strategy of calling thread
+void buffer_set_ring_size(int num_frames){
+    BM::strategy.ring_size = num_frames > 0 ? num_frames : 0;
+    BM::strategy.ring.clear();
+    BM::strategy.cursor = 0;
+}
+
+// Get ring size of calling thread's access strategy
+int buffer_get_ring_size(){
+    return BM::strategy.ring_size;
+}
+
+// Set frame quota of table file holding given table
+int buffer_set_table_quota(int64_t table_id, int min_frames, int max_frames){
+    if(min_frames < 0 || max_frames < 0 || (max_frames && min_frames > max_frames)) return -1;
+    table_id = file_get_space_id(table_id);
+
+    pthread_mutex_lock(&BM::buffer_manager_latch);
+    BM::table_quota& quota = BM::table_quotas[table_id];
+    bool had_quota = quota.min_frames || quota.max_frames;
+    quota.min_frames = min_frames;
+    quota.max_frames = max_frames;
+    bool has_quota = quota.min_frames || quota.max_frames;
+    BM::number_of_quotas += (int)has_quota - (int)had_quota;
+
+    //least recently used pages above new max go to front of LRU list (evicted first)
+    if(quota.max_frames && quota.frames > quota.max_frames){
+        std::vector<blknum_t> excess;
+        for(blknum_t i = BM::ctrl_blk_list_front; i != -1 && excess.size() < quota.frames - quota.max_frames; i = BM::lru_list[i].nxt){
+            if(BM::ctrl_blk_list[i].table_id == table_id) excess.push_back(i);
+        }
+        for(auto it = excess.rbegin(); it != excess.rend(); it++) BM::move_blk_to_front(*it);
+    }
+    pthread_mutex_unlock(&BM::buffer_manager_latch);
+    return 0;
+}
+
+// Get the number of frames holding pages of table file holding given table
+int buffer_get_table_frames(int64_t table_id){
+    table_id = file_get_space_id(table_id);
+
+    pthread_mutex_lock(&BM::buffer_manager_latch);
+    auto it = BM::table_quotas.find(table_id);
+    int ret = it != BM::table_quotas.end() ? it->second.frames : 0;
+    pthread_mutex_unlock(&BM::buffer_manager_latch);
+    return ret;
+}
+
+// Set memory size of compressed cache of evicted pages
+void buffer_set_compressed_cache_size(size_t max_bytes){
+    pthread_mutex_lock(&BM::buffer_manager_latch);
+    BM::COMPRESSED_CACHE_BYTES = max_bytes;
+    BM::shrink_compressed_cache(max_bytes);
+    pthread_mutex_unlock(&BM::buffer_manager_latch);
+}
+
+// Get the number of pages and bytes in compressed cache
+void buffer_get_compressed_cache_usage(size_t* number_of_pages, size_t* bytes){
+    pthread_mutex_lock(&BM::buffer_manager_latch);
+    *number_of_pages = BM::compressed_pages.size();
+    *bytes = BM::compressed_bytes;
+    pthread_mutex_unlock(&BM::buffer_manager_latch);
+}
+
+// Set readahead window size
+void buffer_set_readahead_pages(int num_pages){
+    pthread_mutex_lock(&BM::buffer_manager_latch);
+    BM::READAHEAD_PAGES = num_pages > 0 ? num_pages : 0;
+    pthread_mutex_unlock(&BM::buffer_manager_latch);
+}
+
+// Drop frames of pages in [begin, end) without write-back
+void buffer_discard_pages(int64_t table_id, pagenum_t begin, pagenum_t end){
+    table_id = file_get_space_id(table_id);
+
+    //start cirtical section
+    pthread_mutex_lock(&BM::buffer_manager_latch);
+
+    BM::erase_from_compressed_cache(table_id, begin, end);
+
+    for(size_t i=0; i<BM::BUFFER_SIZE; i++){
+        //scan all block in buffer list
+        BM::ctrl_blk* blk = &BM::ctrl_blk_list[i];
+        if(blk->table_id != table_id || blk->pagenum < begin || blk->pagenum >= end) continue;
+
+        //wait until nobody uses this frame
+        while(BM::latch_try_exclusive(&blk->latch)){
+            BM::latch_wait(&blk->latch);
+        }
+
+        //frame may be reused while waiting
+        if(blk->table_id == table_id && blk->pagenum >= begin && blk->pagenum < end){
+            BM::erase_from_hash_table({blk->table_id, blk->pagenum});
+            blk->table_id = 0;
+            blk->pagenum = 0;
+            blk->is_dirty = false;
+            blk->is_prefetched = false;
+
+            //dropped frame is the next victim
+            BM::move_blk_to_front(i);
+        }
+
+        BM::latch_unlock(&blk->latch); //unlock current page
+    }
+
+    //end cirtical section
+    pthread_mutex_unlock(&BM::buffer_manager_latch);
+    return;
+}
+
+// Flush all dirty frames to disk without eviction (checkpoint)
+void buffer_flush_all_frames(){
+    //collect dirty pages
+    std::vector<std::pair<page_id, blknum_t>> dirty;
+    pthread_mutex_lock(&BM::buffer_manager_latch);
+    for(size_t i=0; i<BM::BUFFER_SIZE; i++){
+        //scan all block in buffer list
+        BM::ctrl_blk* blk = &BM::ctrl_blk_list[i];
+        if(blk->is_dirty) dirty.push_back({{blk->table_id, blk->pagenum}, (blknum_t)i});
+    }
+    //leave frames for misses of other threads meanwhile
+    size_t batch_size = std::min<size_t>(FLUSH_BATCH_FRAMES, BM::BUFFER_SIZE / 4 + 1);
+    pthread_mutex_unlock(&BM::buffer_manager_latch);
+
+    //write back in file order
+    std::sort(dirty.begin(), dirty.end());
+    for(size_t i = 0; i < dirty.size(); i += batch_size){
+        BM::flush_blks(dirty.data() + i, std::min(batch_size, dirty.size() - i));
+    }
+    return;
+}
+
 // Flush all and destroy
 void buffer_close_table_file(){
+    //stop readahead first (it may hold frames)
+    BM::stop_readahead_thread();
+
+    //write back dirty pages in file order
+    buffer_flush_all_frames();
+
     //start cirtical section
     pthread_mutex_lock(&BM::buffer_manager_latch);
 
+    //remember resident pages for next start
+    if(!BM::WARMUP_PATH.empty()) BM::save_warmup_file();
+
     for(size_t i=0; i<BM::BUFFER_SIZE; i++){
-        //scan all block in buffer list
+        //scan all block in buffer list (left dirty by failed write)
         if(BM::ctrl_blk_list[i].is_dirty){
             //flush dirty page only
             BM::flush_frame_to_file(i);
@@ -351,11 +1542,13 @@ void buffer_close_table_file(){
     }
 
     //free the list
-    delete[] BM::ctrl_blk_list;
-    delete[] BM::frame_list;
+    munmap(BM::ctrl_blk_memory, BM::ctrl_blk_memory_length);
+    munmap(BM::lru_memory, BM::lru_memory_length);
+    munmap(BM::frame_memory, BM::frame_memory_length);
 
-    //clear the hash table
-    BM::hash_table.clear();
+    //clear the hash table and compressed cache
+    BM::clear_hash_table();
+    BM::shrink_compressed_cache(0);
 
     //end cirtical section
     pthread_mutex_unlock(&BM::buffer_manager_latch);
@@ -0,0 +1,261 @@
+#include "compact.h"
+
+namespace CM{
+    void make_page_order(compaction_t* cm){
+        cm->order.clear();
+        cm->position.clear();
+        cm->number_of_internal_pages = 0;
+
+        //get root page number
+        FIM::_fim_page_t page;
+        buffer_read_page(cm->table_id, 0, &page._raw_page, BUFFER_NO_LOCK_MODE);
+        pagenum_t root = page._header_page.root_page_number;
+
+        //page order is made from one tree
+        //pages of other tables in tablespace would be taken as leaked pages
+        if(page._header_page.number_of_tables) throw "tablespace with many tables can't be compacted";
+        if(!root) return; //no tree case
+
+        //level order traversal
+        //every leaf is in the same level so leaves come last in key order
+        //no need to read leaf pages
+        cm->order.push_back(root);
+        for(size_t i = 0; i < cm->order.size(); i++){
+            buffer_read_page(cm->table_id, cm->order[i], &page._raw_page, BUFFER_NO_LOCK_MODE);
+            if(page._leaf_page.page_header.is_leaf) break; //leaf level
+
+            cm->number_of_internal_pages++;
+            cm->order.push_back(page._internal_page.leftmost_page_number);
+            for(uint32_t j = 0; j < page._internal_page.page_header.number_of_keys; j++){
+                cm->order.push_back(page._internal_page.key_and_page[j].page_number);
+            }
+        }
+
+        for(size_t i = 0; i < cm->order.size(); i++) cm->position[cm->order[i]] = i;
+    }
+
+    void refresh_free_pages(compaction_t* cm){
+        //free page set is still same with file
+        if(cm->free_list_epoch == file_get_free_list_epoch(cm->table_id)) return;
+
+        std::vector<pagenum_t> free_pages = file_sort_free_page_list(cm->table_id);
+        cm->free_pages = std::set<pagenum_t>(free_pages.begin(), free_pages.end());
+        cm->free_list_epoch = file_get_free_list_epoch(cm->table_id);
+    }
+
+    pagenum_t take_first_free_page(compaction_t* cm){
+        if(cm->free_pages.empty()) return 0;
+
+        //list is sorted so the smallest one is the head
+        pagenum_t pagenum = *cm->free_pages.begin();
+        file_unlink_free_page(cm->table_id, 0, pagenum);
+        cm->free_pages.erase(cm->free_pages.begin());
+        return pagenum;
+    }
+
+    void put_free_page(compaction_t* cm, pagenum_t pagenum){
+        //find predecessor to keep list sorted
+        auto it = cm->free_pages.lower_bound(pagenum);
+        pagenum_t prev_pagenum = it == cm->free_pages.begin() ? 0 : *std::prev(it);
+        file_link_free_page(cm->table_id, prev_pagenum, pagenum);
+        cm->free_pages.insert(pagenum);
+    }
+
+    bool is_page_movable(compaction_t* cm, pagenum_t pagenum){
+        //internal page is never locked
+        if(cm->position[pagenum] < cm->number_of_internal_pages) return true;
+
+        //hold lock manager latch so that no trx commits or aborts while checking
+        //(no trx acquires new lock since tree structure latch is held)
+        //don't wait for it under tree structure latch (latch order is tree latch first), back off instead
+        if(lock_try_acquire_lock_manager_latch()) return false;
+        bool is_movable = !lock_is_page_locked(cm->table_id, pagenum);
+        if(is_movable){
+            //check implicit lock of active trx
+            FIM::_fim_page_t page;
+            buffer_read_page(cm->table_id, pagenum, &page._raw_page, BUFFER_NO_LOCK_MODE);
+            for(uint32_t i = 0; i < page._leaf_page.page_header.number_of_keys && is_movable; i++){
+                int trx_id = page._leaf_page.slot[i].trx_id;
+                if(trx_id && trx_is_this_trx_valid(trx_id)) is_movable = false;
+            }
+        }
+        lock_release_lock_manager_latch();
+        return is_movable;
+    }
+
+    void move_page(compaction_t* cm, size_t idx, pagenum_t dst){
+        int64_t table_id = cm->table_id;
+        pagenum_t src = cm->order[idx];
+        FIM::_fim_page_t page, tmp_page;
+
+        //copy page content to dst
+        buffer_read_page(table_id, src, &page._raw_page, BUFFER_NO_LOCK_MODE);
+        buffer_read_page(table_id, dst, &tmp_page._raw_page, BUFFER_WRITE_LOCK_MODE);
+        buffer_write_page(table_id, dst, &page._raw_page);
+
+        //fix pointer to this page in parent (or header page if root)
+        pagenum_t parent_page_number = page._leaf_page.page_header.parent_page_number;
+        if(!parent_page_number){
+            if(FIM::change_root_page(table_id, dst)) throw "can't change root page";
+        }
+        else{
+            buffer_read_page(table_id, parent_page_number, &tmp_page._raw_page, BUFFER_WRITE_LOCK_MODE);
+            if(tmp_page._internal_page.leftmost_page_number == src){
+                tmp_page._internal_page.leftmost_page_number = dst;
+            }
+            for(uint32_t i = 0; i < tmp_page._internal_page.page_header.number_of_keys; i++){
+                if(tmp_page._internal_page.key_and_page[i].page_number == src){
+                    tmp_page._internal_page.key_and_page[i].page_number = dst;
+                }
+            }
+            buffer_write_page(table_id, parent_page_number, &tmp_page._raw_page);
+        }
+
+        if(!page._leaf_page.page_header.is_leaf){
+            //fix parent pointer in children
+            for(int32_t i = -1; i < (int32_t)page._internal_page.page_header.number_of_keys; i++){
+                pagenum_t child = i < 0 ? page._internal_page.leftmost_page_number : page._internal_page.key_and_page[i].page_number;
+                buffer_read_page(table_id, child, &tmp_page._raw_page, BUFFER_WRITE_LOCK_MODE);
+                tmp_page._leaf_page.page_header.parent_page_number = dst;
+                buffer_write_page(table_id, child, &tmp_page._raw_page);
+            }
+        }
+        else if(idx > cm->number_of_internal_pages){
+            //fix right sibling pointer in left sibling leaf
+            pagenum_t left_page_number = cm->order[idx - 1];
+            buffer_read_page(table_id, left_page_number, &tmp_page._raw_page, BUFFER_WRITE_LOCK_MODE);
+            tmp_page._leaf_page.right_sibling_page_number = dst;
+            buffer_write_page(table_id, left_page_number, &tmp_page._raw_page);
+        }
+
+        //old copy should never be written back
+        buffer_discard_pages(table_id, src, src + 1);
+
+        //update order
+        cm->order[idx] = dst;
+        cm->position.erase(src);
+        cm->position[dst] = idx;
+    }
+
+    int compact_batch(compaction_t* cm, int max_moves){
+        //foreground insert and delete may change tree between batches
+        CM::make_page_order(cm);
+        CM::refresh_free_pages(cm);
+
+        int moved = 0;
+        size_t cursor = 0;
+        while(moved < max_moves){
+            //skip pages already in place
+            while(cursor < cm->order.size() && cm->order[cursor] == cursor + 1) cursor++;
+            if(cursor == cm->order.size()) break; //done
+
+            pagenum_t target = cursor + 1; //target position
+            pagenum_t src = cm->order[cursor];
+            if(!CM::is_page_movable(cm, src)) return moved ? moved : -1;
+
+            auto it = cm->position.find(target);
+            if(it != cm->position.end()){
+                //target is used by other live page
+                //move it away to the smallest free page first
+                if(!CM::is_page_movable(cm, target)) return moved ? moved : -1;
+                pagenum_t free_page_number = CM::take_first_free_page(cm);
+                if(!free_page_number) break; //no room to move
+                CM::move_page(cm, it->second, free_page_number);
+                moved++;
+            }
+            else{
+                //target is free
+                //pages before target are all live so target is the smallest free page
+                //(if target is neither live nor free, it is leaked, so reclaim it)
+                if(cm->free_pages.empty() || *cm->free_pages.begin() != target){
+                    file_link_free_page(cm->table_id, 0, target);
+                    cm->free_pages.insert(target);
+                }
+                CM::take_first_free_page(cm);
+            }
+
+            CM::move_page(cm, cursor, target);
+            CM::put_free_page(cm, src);
+            moved++;
+            cursor++;
+        }
+        return moved;
+    }
+}
+
+int64_t cm_compact_table(int64_t table_id, int max_pages_per_sec){
+    CM::compaction_t cm;
+    cm.table_id = table_id;
+    cm.free_list_epoch = ~0ULL; //load free page list in first batch
+
+    timespec begin, cnt;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    uint64_t total_moved = 0;
+    int retry = 0;
+
+    //move pages in batches
+    while(retry < COMPACTION_MAX_RETRY){
+        if(idx_try_lock_tree_structure(table_id)){
+            //foreground operation is running
+            retry++;
+            usleep(COMPACTION_BACKOFF_US);
+            continue;
+        }
+
+        int moved;
+        try{
+            moved = CM::compact_batch(&cm, COMPACTION_BATCH_PAGES);
+        }
+        catch(const char* e){
+            idx_unlock_tree_structure(table_id);
+            perror(e);
+            return -1;
+        }
+        idx_unlock_tree_structure(table_id);
+
+        if(!moved) break; //every page is in place
+        if(moved < 0){
+            //page is locked by active trx
+            retry++;
+            usleep(COMPACTION_BACKOFF_US);
+            continue;
+        }
+        retry = 0;
+        total_moved += moved;
+
+        if(max_pages_per_sec > 0){
+            //sleep until the rate goes under limit
+            clock_gettime(CLOCK_MONOTONIC, &cnt);
+            double elapsed = (cnt.tv_sec - begin.tv_sec) + (cnt.tv_nsec - begin.tv_nsec) / 1e9;
+            double expected = (double)total_moved / max_pages_per_sec;
+            if(expected > elapsed) usleep((useconds_t)((expected - elapsed) * 1e6));
+        }
+    }
+
+    //truncate free pages at the tail
+    for(retry = 0; idx_try_lock_tree_structure(table_id); retry++){
+        if(retry >= COMPACTION_MAX_RETRY) return 0;
+        usleep(COMPACTION_BACKOFF_US);
+    }
+    int64_t ret_val;
+    try{
+        CM::make_page_order(&cm);
+        //keep at least one page after header page so that file can grow again
+        uint64_t new_number_of_pages = 2;
+        for(pagenum_t pagenum : cm.order) new_number_of_pages = std::max<uint64_t>(new_number_of_pages, pagenum + 1);
+        uint64_t number_of_pages = file_get_number_of_pages(table_id);
+
+        ret_val = 0;
+        if(new_number_of_pages < number_of_pages){
+            buffer_discard_pages(table_id, new_number_of_pages, number_of_pages);
+            file_truncate_table_file(table_id, new_number_of_pages);
+            ret_val = number_of_pages - new_number_of_pages;
+        }
+    }
+    catch(const char* e){
+        perror(e);
+        ret_val = -1;
+    }
+    idx_unlock_tree_structure(table_id);
+    return ret_val;
+}
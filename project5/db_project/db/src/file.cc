@@ -1,4 +1,6 @@
 #include "file.h"
+#include <array>
+#include <map>
 
 namespace DSM{
     
@@ -6,6 +8,20 @@ namespace DSM{
     //(table_id, fd, realpath)
     table_info DB_FILE_LIST[MAX_DB_FILE_NUMBER];
     size_t DB_FILE_LIST_SIZE = 0;
+
+    //file list latch
+    //protect DB_FILE_LIST changes from background sync thread
+    pthread_mutex_t file_list_latch = PTHREAD_MUTEX_INITIALIZER;
+
+    //background sync thread info
+    pthread_t sync_thread;
+    pthread_cond_t sync_thread_cond = PTHREAD_COND_INITIALIZER; //cond var for sleeping until next period
+    bool is_sync_thread_running = false;
+    bool is_sync_thread_stopped = false; //stop flag
+    int SYNC_INTERVAL_MS = DEFAULT_SYNC_INTERVAL_MS;
+
+    //storage backend for files opened from now on (null means posix backend)
+    const storage_backend_t* STORAGE_BACKEND = nullptr;
     
     bool is_file_opened(int fd){
         //check fd in the DB_FILE_LIST
@@ -31,12 +47,12 @@ namespace DSM{
         if(!is_file_opened(fd)) return false;
         if(!pagenum) return true; //header page case
 
-        //load header page data to get number of page attrib
-        _dsm_page_t header_page;
-        load_page_from_file(fd,0,&header_page._raw_page);
+        //use cached number of page attrib in header page
+        //instead of reading header page from disk on every I/O
+        table_info* info = find_table_info(fd);
 
         //check boundary
-        return pagenum < header_page._header_page.number_of_pages;
+        return pagenum < info->number_of_pages;
     }
 
     
@@ -47,6 +63,7 @@ namespace DSM{
         //init header page with arg
         dsm_pg->_header_page.free_page_number = nxt_page_number;
         dsm_pg->_header_page.number_of_pages = number_of_pages;
+        dsm_pg->_header_page.page_size = PAGE_SIZE;
     }
 
     void init_free_page(page_t* pg, pagenum_t nxt_page_number){
@@ -57,24 +74,579 @@ namespace DSM{
         dsm_pg->_free_page.nxt_free_page_number = nxt_page_number;
     }
 
+    table_info* find_table_info(int fd){
+        //scan in the DB_FILE_LIST
+        for(int i=0;i<DB_FILE_LIST_SIZE;i++){
+            if(DSM::DB_FILE_LIST[i].fd == fd) return &DSM::DB_FILE_LIST[i];
+        }
+        return nullptr;
+    }
+
+    const storage_backend_t* get_backend(int fd){
+        table_info* info = find_table_info(fd);
+        if(info) return info->backend;
+        return DSM::STORAGE_BACKEND ? DSM::STORAGE_BACKEND : storage_get_posix_backend();
+    }
+
+    page_t* get_aligned_bounce_page(){
+        //one page per thread, aligned for O_DIRECT transfer
+        alignas(PAGE_SIZE) static thread_local page_t bounce_page;
+        return &bounce_page;
+    }
+
+    uint16_t get_slot_sectors(uint16_t length){
+        return (sizeof(slot_header_t) + length + COMPRESSION_SECTOR_SIZE - 1) / COMPRESSION_SECTOR_SIZE;
+    }
+
+    uint64_t get_thread_cpu_ns(){
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    uint32_t crc32c(uint32_t crc, const void* data, size_t length){
+        //byte table of reflected polynomial, made on first call
+        static const std::array<uint32_t, 256> table = []{
+            std::array<uint32_t, 256> t;
+            for(uint32_t i = 0; i < 256; i++){
+                uint32_t c = i;
+                for(int k = 0; k < 8; k++) c = (c >> 1) ^ (c & 1 ? 0x82f63b78 : 0);
+                t[i] = c;
+            }
+            return t;
+        }();
+
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+        crc = ~crc;
+        for(size_t i = 0; i < length; i++) crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    uint32_t get_slot_checksum(const uint8_t* slot){
+        slot_header_t header;
+        memcpy(&header, slot, sizeof(header));
+        header.checksum = 0;
+        uint32_t crc = DSM::crc32c(0, &header, sizeof(header));
+        return DSM::crc32c(crc, slot + sizeof(header), header.length);
+    }
+
+    void load_compressed_slots(table_info* info){
+        compression_t* cm = info->compression;
+        cm->free_slots.assign(get_slot_sectors(PAGE_SIZE) + 1, std::vector<uint64_t>());
+        cm->next_sequence = 1;
+
+        int64_t file_size = info->backend->get_size(info->fd);
+        if(file_size == -1) throw "stat system call failed!";
+
+        //read slots sequentially after header page
+        std::vector<uint8_t> chunk(COMPRESSION_SCAN_CHUNK_SIZE);
+        uint64_t chunk_offset = 0, chunk_size = 0; //file range in chunk
+        uint64_t offset = PAGE_SIZE;
+        uint64_t end_offset = PAGE_SIZE; //end of last valid slot
+        std::vector<slot_location_t> bad_slots; //skipped after last valid slot
+        while(offset + sizeof(slot_header_t) <= (uint64_t)file_size){
+            if(offset + sizeof(slot_header_t) > chunk_offset + chunk_size){
+                //refill chunk from current slot
+                ssize_t ret = info->backend->read(info->fd, chunk.data(), chunk.size(), offset);
+                if(ret < (ssize_t)sizeof(slot_header_t)) break;
+                chunk_offset = offset;
+                chunk_size = ret;
+            }
+            slot_header_t header;
+            memcpy(&header, chunk.data() + (offset - chunk_offset), sizeof(header));
+            bool is_header_sane = header.magic == COMPRESSED_SLOT_MAGIC && header.length <= PAGE_SIZE &&
+                header.sectors == get_slot_sectors(header.length);
+            uint64_t slot_size = (uint64_t)header.sectors * COMPRESSION_SECTOR_SIZE;
+            if(is_header_sane && offset + slot_size > (uint64_t)file_size) break; //torn write at the tail
+
+            if(is_header_sane && offset + slot_size > chunk_offset + chunk_size){
+                //whole slot is needed for checksum
+                ssize_t ret = info->backend->read(info->fd, chunk.data(), chunk.size(), offset);
+                if(ret < (ssize_t)slot_size) break;
+                chunk_offset = offset;
+                chunk_size = ret;
+            }
+            if(!is_header_sane || DSM::get_slot_checksum(chunk.data() + (offset - chunk_offset)) != header.checksum){
+                //torn or corrupted slot, later slots are still valid
+                //header with sane size is trusted for its size, otherwise next slot may start at next sector
+                slot_location_t loc = {offset, (uint16_t)(is_header_sane ? header.sectors : 1), 0};
+                bad_slots.push_back(loc);
+                cm->stats.number_of_bad_slots++;
+                offset += (uint64_t)loc.sectors * COMPRESSION_SECTOR_SIZE;
+                continue;
+            }
+
+            cm->next_sequence = std::max(cm->next_sequence, header.sequence + 1);
+            slot_location_t loc = {offset, header.sectors, header.sequence};
+            auto it = cm->page_map.find(header.pagenum);
+            if(header.pagenum >= info->number_of_pages){
+                //page cut off from file
+                cm->free_slots[loc.sectors].push_back(loc.offset);
+            }
+            else if(it == cm->page_map.end()){
+                cm->page_map[header.pagenum] = loc;
+            }
+            else if(it->second.sequence < loc.sequence){
+                //newer image of same page
+                cm->free_slots[it->second.sectors].push_back(it->second.offset);
+                it->second = loc;
+            }
+            else{
+                //older image of same page
+                cm->free_slots[loc.sectors].push_back(loc.offset);
+            }
+            offset += slot_size;
+            end_offset = offset;
+
+            //bad slots before valid one are reused (ones at the tail are overwritten by append)
+            for(const slot_location_t& bad : bad_slots) cm->free_slots[bad.sectors].push_back(bad.offset);
+            bad_slots.clear();
+        }
+        //tail bad slots don't count as they are dropped
+        cm->stats.number_of_bad_slots -= bad_slots.size();
+        cm->end_offset = end_offset;
+    }
+
+    void free_superseded_slot(table_info* info, const slot_location_t& loc){
+        if(DSM::is_lazy_sync_table(info)) info->compression->superseded_slots.push_back(loc);
+        else info->compression->free_slots[loc.sectors].push_back(loc.offset);
+    }
+
+    int sync_table_file(table_info* info){
+        //slots superseded before sync are free after it
+        //(ones superseded during sync wait for next sync)
+        compression_t* cm = info->compression;
+        std::vector<slot_location_t> superseded;
+        if(cm){
+            pthread_mutex_lock(&cm->latch);
+            superseded.swap(cm->superseded_slots);
+            pthread_mutex_unlock(&cm->latch);
+        }
+
+        int ret = info->backend->sync(info->fd);
+
+        if(cm){
+            pthread_mutex_lock(&cm->latch);
+            for(const slot_location_t& loc : superseded){
+                if(ret == -1) cm->superseded_slots.push_back(loc);
+                else cm->free_slots[loc.sectors].push_back(loc.offset);
+            }
+            pthread_mutex_unlock(&cm->latch);
+        }
+        return ret;
+    }
+
+    void store_compressed_page(table_info* info, pagenum_t pagenum, const page_t* src){
+        compression_t* cm = info->compression;
+
+        //compress page image behind slot header
+        static thread_local uint8_t slot[(PAGE_SIZE / COMPRESSION_SECTOR_SIZE + 1) * COMPRESSION_SECTOR_SIZE];
+        uint64_t begin_ns = get_thread_cpu_ns();
+        int length = lz_compress(src->raw_data, PAGE_SIZE, slot + sizeof(slot_header_t), PAGE_SIZE);
+        uint64_t compress_ns = get_thread_cpu_ns() - begin_ns;
+        if(!length || get_slot_sectors(length) >= get_slot_sectors(PAGE_SIZE)){
+            //incompressible page (no sector saved) is stored raw
+            length = PAGE_SIZE;
+            memcpy(slot + sizeof(slot_header_t), src, PAGE_SIZE);
+        }
+        uint16_t sectors = get_slot_sectors(length);
+
+        //allocate slot (reuse same size slot first)
+        pthread_mutex_lock(&cm->latch);
+        slot_location_t loc;
+        loc.sectors = sectors;
+        loc.sequence = cm->next_sequence++;
+        if(!cm->free_slots[sectors].empty()){
+            loc.offset = cm->free_slots[sectors].back();
+            cm->free_slots[sectors].pop_back();
+        }
+        else{
+            loc.offset = cm->end_offset;
+            cm->end_offset += (uint64_t)sectors * COMPRESSION_SECTOR_SIZE;
+        }
+        pthread_mutex_unlock(&cm->latch);
+
+        slot_header_t header = {COMPRESSED_SLOT_MAGIC, (uint16_t)length, sectors, pagenum, loc.sequence, 0, 0};
+        memcpy(slot, &header, sizeof(header));
+        header.checksum = DSM::get_slot_checksum(slot);
+        memcpy(slot, &header, sizeof(header));
+        size_t slot_size = (size_t)sectors * COMPRESSION_SECTOR_SIZE;
+        memset(slot + sizeof(header) + length, 0, slot_size - sizeof(header) - length);
+
+        //write new slot first, old slot is still valid until it is written
+        if(info->backend->write(info->fd, slot, slot_size, loc.offset) != (ssize_t)slot_size){
+            pthread_mutex_lock(&cm->latch);
+            cm->free_slots[sectors].push_back(loc.offset);
+            pthread_mutex_unlock(&cm->latch);
+            throw "write system call failed!";
+        }
+
+        //switch page map to new slot
+        pthread_mutex_lock(&cm->latch);
+        auto it = cm->page_map.find(pagenum);
+        if(it == cm->page_map.end()) cm->page_map[pagenum] = loc;
+        else if(it->second.sequence < loc.sequence){
+            DSM::free_superseded_slot(info, it->second);
+            it->second = loc;
+        }
+        else cm->free_slots[sectors].push_back(loc.offset); //newer write already done
+        cm->stats.logical_write_bytes += PAGE_SIZE;
+        cm->stats.physical_write_bytes += slot_size;
+        cm->stats.compress_ns += compress_ns;
+        cm->stats.number_of_raw_pages += length == PAGE_SIZE;
+        pthread_mutex_unlock(&cm->latch);
+    }
+
+    void load_compressed_page(table_info* info, pagenum_t pagenum, page_t* dest){
+        compression_t* cm = info->compression;
+        static thread_local uint8_t slot[(PAGE_SIZE / COMPRESSION_SECTOR_SIZE + 1) * COMPRESSION_SECTOR_SIZE];
+
+        while(true){
+            //find slot of page
+            pthread_mutex_lock(&cm->latch);
+            auto it = cm->page_map.find(pagenum);
+            if(it == cm->page_map.end()){
+                //never written page
+                pthread_mutex_unlock(&cm->latch);
+                memset(dest, 0, sizeof(page_t));
+                return;
+            }
+            slot_location_t loc = it->second;
+            pthread_mutex_unlock(&cm->latch);
+
+            size_t slot_size = (size_t)loc.sectors * COMPRESSION_SECTOR_SIZE;
+            if(info->backend->read(info->fd, slot, slot_size, loc.offset) != (ssize_t)slot_size){
+                throw "read system call failed!";
+            }
+
+            //slot can be rewritten by other page after newer write of this page
+            //read again in that case
+            slot_header_t header;
+            memcpy(&header, slot, sizeof(header));
+            if(header.magic != COMPRESSED_SLOT_MAGIC || header.pagenum != pagenum || header.sequence != loc.sequence) continue;
+            if(header.length > PAGE_SIZE || DSM::get_slot_checksum(slot) != header.checksum){
+                //torn read of slot being rewritten, or corruption on device if page still maps here
+                pthread_mutex_lock(&cm->latch);
+                auto cnt = cm->page_map.find(pagenum);
+                bool is_moved = cnt == cm->page_map.end() || cnt->second.sequence != loc.sequence;
+                pthread_mutex_unlock(&cm->latch);
+                if(is_moved) continue;
+                throw "compressed page is corrupted";
+            }
+
+            uint64_t begin_ns = get_thread_cpu_ns();
+            if(header.length == PAGE_SIZE) memcpy(dest, slot + sizeof(header), PAGE_SIZE);
+            else if(lz_decompress(slot + sizeof(header), header.length, dest->raw_data, PAGE_SIZE) != PAGE_SIZE){
+                throw "compressed page is corrupted";
+            }
+            uint64_t decompress_ns = get_thread_cpu_ns() - begin_ns;
+
+            pthread_mutex_lock(&cm->latch);
+            cm->stats.logical_read_bytes += PAGE_SIZE;
+            cm->stats.physical_read_bytes += slot_size;
+            cm->stats.decompress_ns += decompress_ns;
+            pthread_mutex_unlock(&cm->latch);
+            return;
+        }
+    }
+
+    void drop_compressed_pages(table_info* info, pagenum_t begin){
+        compression_t* cm = info->compression;
+        pthread_mutex_lock(&cm->latch);
+        for(auto it = cm->page_map.begin(); it != cm->page_map.end(); ){
+            if(it->first >= begin){
+                DSM::free_superseded_slot(info, it->second);
+                it = cm->page_map.erase(it);
+            }
+            else ++it;
+        }
+        pthread_mutex_unlock(&cm->latch);
+    }
+
+    void trim_compressed_slots(table_info* info){
+        compression_t* cm = info->compression;
+        pthread_mutex_lock(&cm->latch);
+
+        //free slots in offset order
+        std::map<uint64_t, uint16_t> free_slots;
+        for(size_t sectors = 0; sectors < cm->free_slots.size(); sectors++){
+            for(uint64_t offset : cm->free_slots[sectors]) free_slots[offset] = sectors;
+        }
+
+        //cut free slots ending at the end of slot area
+        uint64_t end_offset = cm->end_offset;
+        while(!free_slots.empty()){
+            auto it = std::prev(free_slots.end());
+            if(it->first + (uint64_t)it->second * COMPRESSION_SECTOR_SIZE != end_offset) break;
+            end_offset = it->first;
+            free_slots.erase(it);
+        }
+        if(end_offset == cm->end_offset){
+            pthread_mutex_unlock(&cm->latch);
+            return;
+        }
+
+        //file is cut under compression latch, so no slot is appended meanwhile
+        if(info->backend->truncate(info->fd, end_offset) == -1){
+            pthread_mutex_unlock(&cm->latch);
+            throw "truncate system call failed!";
+        }
+        cm->end_offset = end_offset;
+
+        //keep rest in descending offset order, so slots near the front are reused first
+        for(std::vector<uint64_t>& slots : cm->free_slots) slots.clear();
+        for(auto it = free_slots.rbegin(); it != free_slots.rend(); ++it) cm->free_slots[it->second].push_back(it->first);
+        pthread_mutex_unlock(&cm->latch);
+    }
+
     void store_page_to_file(int fd, pagenum_t pagenum, const page_t* src){
+        ST::io_timer_t timer(fd, STATS_FILE_WRITE, sizeof(page_t));
+        if(pagenum){
+            //compressed table case
+            table_info* info = find_table_info(fd);
+            if(info && info->compression) return store_compressed_page(info, pagenum, src);
+        }
+
+        //direct I/O needs page aligned memory
+        //copy to aligned bounce page if given page is not aligned
+        //(buffer frames are aligned so only file layer's own pages take this path)
+        if(reinterpret_cast<uintptr_t>(src) % PAGE_SIZE){
+            page_t* bounce_page = get_aligned_bounce_page();
+            memcpy(bounce_page,src,sizeof(page_t));
+            src = bounce_page;
+        }
+
         //write page and sync
         //offset is pagenum * PAGE_SIZE
-        if(pwrite64(fd,src,sizeof(page_t),pagenum*PAGE_SIZE)!=sizeof(page_t)){
+        if(DSM::get_backend(fd)->write(fd,src,sizeof(page_t),pagenum*PAGE_SIZE)!=sizeof(page_t)){
             throw "write system call failed!";
         }
         //if(fsync(fd)==-1) throw "sync system call failed!";
+
+        if(!pagenum){
+            //header page case
+            //keep cached number of pages up to date
+            table_info* info = find_table_info(fd);
+            if(info) info->number_of_pages = reinterpret_cast<const _dsm_page_t*>(src)->_header_page.number_of_pages;
+        }
     }
 
     void load_page_from_file(int fd, pagenum_t pagenum, page_t* dest){
+        ST::io_timer_t timer(fd, STATS_FILE_READ, sizeof(page_t));
+        if(pagenum){
+            //compressed table case
+            table_info* info = find_table_info(fd);
+            if(info && info->compression) return load_compressed_page(info, pagenum, dest);
+        }
+
+        //direct I/O needs page aligned memory
+        //read into aligned bounce page if given page is not aligned
+        page_t* target = dest;
+        if(reinterpret_cast<uintptr_t>(dest) % PAGE_SIZE){
+            target = get_aligned_bounce_page();
+        }
+
         //read page
         //offset is pagenum * PAGE_SIZE
-        if(pread64(fd,dest,sizeof(page_t),pagenum*PAGE_SIZE)!=sizeof(page_t)){
+        if(DSM::get_backend(fd)->read(fd,target,sizeof(page_t),pagenum*PAGE_SIZE)!=sizeof(page_t)){
             throw "read system call failed!";
         }
+
+        if(target != dest) memcpy(dest,target,sizeof(page_t));
+    }
+
+    void load_pages_from_file(int fd, pagenum_t pagenum, uint64_t count, page_t* const* dests){
+        //compressed table case
+        //pages are not contiguous in file
+        table_info* info = find_table_info(fd);
+        if(info && info->compression){
+            for(uint64_t i=0;i<count;i++){
+                ST::io_timer_t timer(fd, STATS_FILE_READ, sizeof(page_t));
+                load_compressed_page(info, pagenum + i, dests[i]);
+            }
+            return;
+        }
+
+        while(count){
+            //build iovec for one vectored read
+            struct iovec iov[MAX_IOV_PAGES];
+            int iovcnt = std::min<uint64_t>(count, MAX_IOV_PAGES);
+            for(int i=0;i<iovcnt;i++){
+                //direct I/O needs page aligned memory
+                //use single page read for unaligned page
+                if(reinterpret_cast<uintptr_t>(dests[i]) % PAGE_SIZE){
+                    iovcnt = i;
+                    break;
+                }
+                iov[i] = {dests[i], sizeof(page_t)};
+            }
+            if(!iovcnt){
+                load_page_from_file(fd,pagenum,dests[0]);
+                iovcnt = 1;
+            }
+            else{
+                ST::io_timer_t timer(fd, STATS_FILE_READ, iovcnt * sizeof(page_t));
+                if(DSM::get_backend(fd)->readv(fd,iov,iovcnt,pagenum*PAGE_SIZE)!=(ssize_t)(iovcnt*sizeof(page_t))){
+                    throw "read system call failed!";
+                }
+            }
+            pagenum += iovcnt;
+            dests += iovcnt;
+            count -= iovcnt;
+        }
+    }
+
+    void store_pages_to_file(int fd, pagenum_t pagenum, uint64_t count, const page_t* const* srcs){
+        //compressed table case
+        //pages are not contiguous in file
+        table_info* info = find_table_info(fd);
+        if(info && info->compression){
+            for(uint64_t i=0;i<count;i++) store_page_to_file(fd, pagenum + i, srcs[i]);
+            return;
+        }
+
+        while(count){
+            //build iovec for one vectored write
+            struct iovec iov[MAX_IOV_PAGES];
+            int iovcnt = std::min<uint64_t>(count, MAX_IOV_PAGES);
+            for(int i=0;i<iovcnt;i++){
+                //direct I/O needs page aligned memory
+                //use single page write for unaligned page
+                //(header page also updates cached number of pages)
+                if(reinterpret_cast<uintptr_t>(srcs[i]) % PAGE_SIZE || !(pagenum + i)){
+                    iovcnt = i;
+                    break;
+                }
+                iov[i] = {const_cast<page_t*>(srcs[i]), sizeof(page_t)};
+            }
+            if(!iovcnt){
+                store_page_to_file(fd,pagenum,srcs[0]);
+                iovcnt = 1;
+            }
+            else{
+                ST::io_timer_t timer(fd, STATS_FILE_WRITE, iovcnt * sizeof(page_t));
+                if(DSM::get_backend(fd)->writev(fd,iov,iovcnt,pagenum*PAGE_SIZE)!=(ssize_t)(iovcnt*sizeof(page_t))){
+                    throw "write system call failed!";
+                }
+            }
+            pagenum += iovcnt;
+            srcs += iovcnt;
+            count -= iovcnt;
+        }
+    }
+
+    bool is_lazy_sync_table(const table_info* info){
+        return info->flag & (FILE_PERIODIC_SYNC_FLAG | FILE_CHECKPOINT_SYNC_FLAG);
+    }
+
+    std::vector<table_info*> get_tables_to_sync(int flag){
+        std::vector<table_info*> tables;
+        for(int i=0;i<DB_FILE_LIST_SIZE;i++){
+            if(DSM::DB_FILE_LIST[i].flag & flag) tables.push_back(&DSM::DB_FILE_LIST[i]);
+        }
+        return tables;
+    }
+
+    void* sync_thread_func(void* arg){
+        pthread_mutex_lock(&DSM::file_list_latch);
+        while(!DSM::is_sync_thread_stopped){
+            //sleep for one interval (or until stop)
+            timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += DSM::SYNC_INTERVAL_MS / 1000;
+            deadline.tv_nsec += (DSM::SYNC_INTERVAL_MS % 1000) * 1000000L;
+            if(deadline.tv_nsec >= 1000000000L){
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&DSM::sync_thread_cond, &DSM::file_list_latch, &deadline);
+            if(DSM::is_sync_thread_stopped) break;
+
+            //make writes in last interval durable
+            //sync without list latch so that slow device doesn't block open, checkpoint and settings
+            std::vector<table_info*> tables = DSM::get_tables_to_sync(FILE_PERIODIC_SYNC_FLAG);
+            pthread_mutex_unlock(&DSM::file_list_latch);
+            for(table_info* info : tables) DSM::sync_table_file(info);
+            pthread_mutex_lock(&DSM::file_list_latch);
+        }
+        pthread_mutex_unlock(&DSM::file_list_latch);
+        return nullptr;
+    }
+
+    void start_sync_thread(){
+        //already running case
+        if(DSM::is_sync_thread_running) return;
+
+        DSM::is_sync_thread_stopped = false;
+        if(pthread_create(&DSM::sync_thread, NULL, DSM::sync_thread_func, NULL)){
+            throw "can't create sync thread";
+        }
+        DSM::is_sync_thread_running = true;
+    }
+
+    void stop_sync_thread(){
+        //not running case
+        if(!DSM::is_sync_thread_running) return;
+
+        //set stop flag and wake up thread
+        pthread_mutex_lock(&DSM::file_list_latch);
+        DSM::is_sync_thread_stopped = true;
+        pthread_cond_signal(&DSM::sync_thread_cond);
+        pthread_mutex_unlock(&DSM::file_list_latch);
+
+        pthread_join(DSM::sync_thread, NULL);
+        DSM::is_sync_thread_running = false;
+    }
+
+    bool is_read_only_table(int fd){
+        table_info* info = find_table_info(fd);
+        return info && info->mapped_pages;
+    }
+
+    void map_table_file(table_info* info){
+        //map whole file (file size is always multiple of PAGE_SIZE)
+        int64_t file_size = info->backend->get_size(info->fd);
+        if(file_size == -1) throw "stat system call failed!";
+        void* addr = info->backend->map(info->fd, file_size);
+        if(!addr) throw "mmap system call failed!";
+
+        info->mapped_pages = reinterpret_cast<page_t*>(addr);
+        info->mapped_size = file_size;
+        //only pages inside mapping are valid
+        info->number_of_pages = std::min<uint64_t>(info->number_of_pages, file_size / PAGE_SIZE);
+    }
+
+    int get_writable_file_descriptor(int64_t table_id){
+        int fd; //file descriptor
+        if((fd = DSM::get_file_descriptor(table_id)) == -1){
+            throw "unvalid table id";
+        }
+        //no write on read-only table
+        if(DSM::is_read_only_table(fd)){
+            throw "table is read-only";
+        }
+        return fd;
+    }
+
+    void set_nxt_free_page_number(int64_t table_id, int fd, pagenum_t pagenum, pagenum_t nxt_page_number){
+        DSM::_dsm_page_t page;
+        if(!pagenum){
+            //header page case
+            //header page is held by buffer too
+            get_header_page_from_multiple_layer(table_id, &page._raw_page);
+            page._header_page.free_page_number = nxt_page_number;
+            set_header_page_from_multiple_layer(table_id, &page._raw_page);
+        }
+        else{
+            DSM::init_free_page(&page._raw_page, nxt_page_number);
+            DSM::store_page_to_file(fd, pagenum, &page._raw_page);
+        }
     }
 
     int get_file_descriptor(int64_t table_id){
+        //every table in tablespace uses file of tablespace
+        table_id = file_get_space_id(table_id);
+
         //scan in the DB_FILE_LIST
         for(int i=0;i<DB_FILE_LIST_SIZE;i++){
             if(DSM::DB_FILE_LIST[i].table_id == table_id) return DSM::DB_FILE_LIST[i].fd;
@@ -84,11 +656,12 @@ namespace DSM{
 }
 
 
-int64_t file_open_table_file(const char* pathname){
+int64_t file_open_table_file(const char* pathname, int flag){
     //get realpath from given path
     //need memory-free before dump it
     //NULL return value means no existed file
-    char* rpath = realpath(pathname, NULL);
+    const storage_backend_t* backend = DSM::get_backend(-1);
+    char* rpath = backend->get_path(pathname);
 
     //check this path is already opened by this function
     if(DSM::is_path_opened(rpath)){
@@ -96,22 +669,40 @@ int64_t file_open_table_file(const char* pathname){
         throw "this file has been already opened";
     }
 
+    //read-only table should exist
+    if(!rpath && (flag & FILE_READ_ONLY_MMAP_FLAG)){
+        throw "read-only table file doesn't exist";
+    }
+
     //file descriptor
     int fd;
 
-    //open file with RW mode
-    if((fd=open64(pathname, O_RDWR | O_SYNC)) == -1){
+    //additional open flag for direct I/O and durability mode
+    int direct_flag = (flag & FILE_DIRECT_IO_FLAG) ? O_DIRECT : 0;
+    int sync_flag = (flag & (FILE_PERIODIC_SYNC_FLAG | FILE_CHECKPOINT_SYNC_FLAG)) ? 0 : O_SYNC;
+
+    if(!rpath){
         //case when there is no such file
         //need to create and init db file
 
         //create file and open file with RW mode and check it's worked properly
         //permission is 644
-        if((fd=open64(pathname, O_RDWR | O_CREAT, 0644)) == -1){
+        if((fd=backend->open_file(pathname, O_RDWR | O_CREAT, 0644)) == -1){
             throw "file_open_database_file failed";
         }
 
         page_t header_page, free_page;
 
+        //compressed table file case
+        //free pages are written into slots after header page
+        DSM::table_info new_info = {0, nullptr, fd, flag, DEFAULT_PAGE_NUMBER, nullptr, 0, 0, nullptr, backend};
+        if(flag & FILE_COMPRESSION_FLAG){
+            new_info.compression = new DSM::compression_t();
+            new_info.compression->free_slots.assign(DSM::get_slot_sectors(PAGE_SIZE) + 1, std::vector<uint64_t>());
+            new_info.compression->end_offset = PAGE_SIZE;
+            new_info.compression->next_sequence = 1;
+        }
+
         //init free page lists
         //init second page to last page to point next free page
         for(int i=1;i<DEFAULT_PAGE_NUMBER;i++){
@@ -120,35 +711,138 @@ int64_t file_open_table_file(const char* pathname){
             //use i + 1 to point next free page
             //this make linked free page list sequentially
             DSM::init_free_page(&free_page, i+1>=DEFAULT_PAGE_NUMBER?0:i+1);
-            DSM::store_page_to_file(fd, i, &free_page);
+            if(new_info.compression) DSM::store_compressed_page(&new_info, i, &free_page);
+            else DSM::store_page_to_file(fd, i, &free_page);
         }
+        delete new_info.compression;
 
         //init new db file's header page to point second page(first free page)
         DSM::init_header_page(&header_page, 1, DEFAULT_PAGE_NUMBER);
+        if(flag & FILE_COMPRESSION_FLAG){
+            reinterpret_cast<DSM::_dsm_page_t*>(&header_page)->_header_page.format_magic = COMPRESSED_FILE_MAGIC;
+        }
         //save changes in file
         DSM::store_page_to_file(fd, 0, &header_page);
+
+        //make initialized file durable at once
+        //and reopen it below with the requested mode
+        if(backend->sync(fd)==-1) throw "sync system call failed!";
+        backend->close_file(fd);
+    }
+
+    if(flag & FILE_READ_ONLY_MMAP_FLAG){
+        //read only through memory mapping
+        //so no direct I/O and durability mode
+        flag = FILE_READ_ONLY_MMAP_FLAG;
+        fd = backend->open_file(pathname, O_RDONLY, 0);
+    }
+    else{
+        //open file with RW mode
+        fd = backend->open_file(pathname, O_RDWR | sync_flag | direct_flag, 0);
+    }
+    if(fd == -1 && errno == EINVAL && direct_flag){
+        //file system doesn't support direct I/O
+        //fall back to buffered I/O
+        direct_flag = 0;
+        flag &= ~FILE_DIRECT_IO_FLAG;
+        fd = backend->open_file(pathname, O_RDWR | sync_flag, 0);
+    }
+    if(fd == -1){
+        free(rpath);
+        throw "file_open_database_file failed";
     }
 
     //if create new db file now, make realpath again
     //it should change NULL to realpath string
-    if(!rpath) rpath = realpath(pathname, NULL);
+    if(!rpath) rpath = backend->get_path(pathname);
     
     //check list overflow
     if(DSM::DB_FILE_LIST_SIZE >= MAX_DB_FILE_NUMBER)
         throw "DB FILE LIST IS FULL";
     
+    //read header page to cache the number of pages
+    DSM::_dsm_page_t header_page;
+    DSM::load_page_from_file(fd, 0, &header_page._raw_page);
+
+    //file made with other page size has different layout
+    if(header_page._header_page.page_size && header_page._header_page.page_size != PAGE_SIZE){
+        free(rpath);
+        backend->close_file(fd);
+        throw "table file page size mismatch";
+    }
+
+    //file format decides compression (not open flag)
+    flag &= ~FILE_COMPRESSION_FLAG;
+    if(header_page._header_page.format_magic == COMPRESSED_FILE_MAGIC_V1){
+        free(rpath);
+        backend->close_file(fd);
+        throw "compressed table file format is not supported";
+    }
+    if(header_page._header_page.format_magic == COMPRESSED_FILE_MAGIC){
+        if(flag & FILE_READ_ONLY_MMAP_FLAG){
+            free(rpath);
+            backend->close_file(fd);
+            throw "compressed table can't be mapped";
+        }
+        flag |= FILE_COMPRESSION_FLAG;
+        if(direct_flag){
+            //slot is not page aligned
+            //use buffered I/O
+            backend->close_file(fd);
+            flag &= ~FILE_DIRECT_IO_FLAG;
+            if((fd = backend->open_file(pathname, O_RDWR | sync_flag, 0)) == -1){
+                free(rpath);
+                throw "file_open_database_file failed";
+            }
+        }
+    }
+
     //insert file descriptor and realpath into list
     //to use for check duplicated open and close
-    DSM::DB_FILE_LIST[DSM::DB_FILE_LIST_SIZE++] = {(int64_t)fd, rpath, fd};
+    DSM::table_info info = {(int64_t)fd, rpath, fd, flag, header_page._header_page.number_of_pages, nullptr, 0, 0, nullptr, backend};
+    try{
+        if(flag & FILE_READ_ONLY_MMAP_FLAG) DSM::map_table_file(&info);
+        if(flag & FILE_COMPRESSION_FLAG){
+            info.compression = new DSM::compression_t();
+            DSM::load_compressed_slots(&info);
+        }
+    }
+    catch(const char* e){
+        delete info.compression;
+        free(rpath);
+        backend->close_file(fd);
+        throw e;
+    }
+    //counters of previous table with same id are cleared
+    stats_reset_table(fd);
+    pthread_mutex_lock(&DSM::file_list_latch);
+    DSM::DB_FILE_LIST[DSM::DB_FILE_LIST_SIZE++] = info;
+    pthread_mutex_unlock(&DSM::file_list_latch);
+
+
+    //periodic sync table needs background sync thread
+    if(flag & FILE_PERIODIC_SYNC_FLAG) DSM::start_sync_thread();
     
     return (int64_t)fd; //set table_id as fd just for now
 }
 
+int64_t file_get_space_id(int64_t table_id){
+    return table_id & ((1LL << TABLE_NUMBER_SHIFT) - 1);
+}
+
+uint32_t file_get_table_number(int64_t table_id){
+    return table_id >> TABLE_NUMBER_SHIFT;
+}
+
 pagenum_t file_alloc_page(int64_t table_id){
     int fd; //file descriptor
     if((fd = DSM::get_file_descriptor(table_id)) == -1){
         throw "unvalid table id";
     }
+    //no write on read-only table
+    if(DSM::is_read_only_table(fd)){
+        throw "table is read-only";
+    }
 
     DSM::_dsm_page_t header_page;
 
@@ -176,6 +870,7 @@ pagenum_t file_alloc_page(int64_t table_id){
     }
     else{
         //no free page in list (db file grow occur)
+        ST::add(fd, ST::GROWS);
 
         //get current number of page
         uint64_t current_number_of_pages = header_page._header_page.number_of_pages;
@@ -207,6 +902,10 @@ pagenum_t file_alloc_page(int64_t table_id){
         set_header_page_from_multiple_layer(table_id, &header_page._raw_page);
     }
 
+    //free page list changed
+    DSM::find_table_info(fd)->free_list_epoch++;
+    ST::add(fd, ST::ALLOCS);
+
     return nxt_page_number;
 }
 
@@ -215,6 +914,10 @@ void file_free_page(int64_t table_id, pagenum_t pagenum){
     if((fd = DSM::get_file_descriptor(table_id)) == -1){
         throw "unvalid table id";
     }
+    //no write on read-only table
+    if(DSM::is_read_only_table(fd)){
+        throw "table is read-only";
+    }
     //check pagenum is valid
     if(!DSM::is_pagenum_valid(fd,pagenum)){
         throw "pagenum is out of bound in file_free_page";
@@ -239,6 +942,10 @@ void file_free_page(int64_t table_id, pagenum_t pagenum){
     //write changes in header page and freed page
     DSM::store_page_to_file(fd,pagenum,&new_page._raw_page);
     set_header_page_from_multiple_layer(table_id, &header_page._raw_page);
+
+    //free page list changed
+    DSM::find_table_info(fd)->free_list_epoch++;
+    ST::add(fd, ST::FREES);
 }
 
 void file_read_page(int64_t table_id, pagenum_t pagenum, page_t* dest){
@@ -251,15 +958,56 @@ void file_read_page(int64_t table_id, pagenum_t pagenum, page_t* dest){
         throw "pagenum is out of bound in file_read_page";
     }
 
+    //read-only table case
+    //copy from memory mapping
+    if(const page_t* mapped_page = file_get_mapped_page(table_id,pagenum)){
+        memcpy(dest,mapped_page,sizeof(page_t));
+        return;
+    }
+
     //call inner function
     DSM::load_page_from_file(fd,pagenum,dest);
 }
 
+void file_read_pages(int64_t table_id, pagenum_t pagenum, uint64_t count, page_t* const* dests){
+    int fd; //file descriptor
+    if((fd = DSM::get_file_descriptor(table_id)) == -1){
+        throw "unvalid table id";
+    }
+    if(!count) return;
+    //check all pagenum in range are valid
+    if(!DSM::is_pagenum_valid(fd,pagenum) || !DSM::is_pagenum_valid(fd,pagenum+count-1)){
+        throw "pagenum is out of bound in file_read_pages";
+    }
+
+    //read-only table case
+    //copy from memory mapping
+    if(const page_t* mapped_page = file_get_mapped_page(table_id,pagenum)){
+        for(uint64_t i=0;i<count;i++) memcpy(dests[i],mapped_page+i,sizeof(page_t));
+        return;
+    }
+
+    //call inner function
+    DSM::load_pages_from_file(fd,pagenum,count,dests);
+}
+
+uint64_t file_get_number_of_pages(int64_t table_id){
+    int fd; //file descriptor
+    if((fd = DSM::get_file_descriptor(table_id)) == -1){
+        throw "unvalid table id";
+    }
+    return DSM::find_table_info(fd)->number_of_pages;
+}
+
 void file_write_page(int64_t table_id, pagenum_t pagenum, const page_t* src){
     int fd; //file descriptor
     if((fd = DSM::get_file_descriptor(table_id)) == -1){
         throw "unvalid table id";
     }
+    //no write on read-only table
+    if(DSM::is_read_only_table(fd)){
+        throw "table is read-only";
+    }
     //check pagenum is valid
     if(!DSM::is_pagenum_valid(fd,pagenum)){
         throw "pagenum is out of bound in file_write_page";
@@ -269,15 +1017,260 @@ void file_write_page(int64_t table_id, pagenum_t pagenum, const page_t* src){
     DSM::store_page_to_file(fd,pagenum,src);
 }
 
+void file_write_pages(int64_t table_id, pagenum_t pagenum, uint64_t count, const page_t* const* srcs){
+    int fd; //file descriptor
+    if((fd = DSM::get_file_descriptor(table_id)) == -1){
+        throw "unvalid table id";
+    }
+    //no write on read-only table
+    if(DSM::is_read_only_table(fd)){
+        throw "table is read-only";
+    }
+    if(!count) return;
+    //check all pagenum in range are valid
+    if(!DSM::is_pagenum_valid(fd,pagenum) || !DSM::is_pagenum_valid(fd,pagenum+count-1)){
+        throw "pagenum is out of bound in file_write_pages";
+    }
+
+    //call inner function
+    DSM::store_pages_to_file(fd,pagenum,count,srcs);
+}
+
+const char* file_get_table_path(int64_t table_id){
+    int fd; //file descriptor
+    if((fd = DSM::get_file_descriptor(table_id)) == -1){
+        throw "unvalid table id";
+    }
+    return DSM::find_table_info(fd)->path;
+}
+
+uint64_t file_get_free_list_epoch(int64_t table_id){
+    int fd; //file descriptor
+    if((fd = DSM::get_file_descriptor(table_id)) == -1){
+        throw "unvalid table id";
+    }
+    return DSM::find_table_info(fd)->free_list_epoch;
+}
+
+std::vector<pagenum_t> file_sort_free_page_list(int64_t table_id){
+    int fd = DSM::get_writable_file_descriptor(table_id);
+
+    DSM::_dsm_page_t header_page, page;
+
+    //read header page (hold header page latch until end)
+    get_header_page_from_multiple_layer(table_id, &header_page._raw_page);
+
+    //collect free pages by following the list
+    std::vector<pagenum_t> free_pages;
+    bool is_sorted = true;
+    pagenum_t cnt_page_number = header_page._header_page.free_page_number;
+    while(cnt_page_number){
+        if(!free_pages.empty() && free_pages.back() > cnt_page_number) is_sorted = false;
+        free_pages.push_back(cnt_page_number);
+        DSM::load_page_from_file(fd, cnt_page_number, &page._raw_page);
+        cnt_page_number = page._free_page.nxt_free_page_number;
+    }
+
+    if(!is_sorted){
+        //relink all free pages in ascending order
+        std::sort(free_pages.begin(), free_pages.end());
+        for(size_t i=0;i<free_pages.size();i++){
+            DSM::init_free_page(&page._raw_page, i+1<free_pages.size()?free_pages[i+1]:0);
+            DSM::store_page_to_file(fd, free_pages[i], &page._raw_page);
+        }
+        header_page._header_page.free_page_number = free_pages.empty() ? 0 : free_pages[0];
+    }
+
+    //release header page
+    set_header_page_from_multiple_layer(table_id, &header_page._raw_page);
+    return free_pages;
+}
+
+void file_link_free_page(int64_t table_id, pagenum_t prev_pagenum, pagenum_t pagenum){
+    int fd = DSM::get_writable_file_descriptor(table_id);
+    //check pagenum is valid
+    if(!pagenum || !DSM::is_pagenum_valid(fd,pagenum) || !DSM::is_pagenum_valid(fd,prev_pagenum)){
+        throw "pagenum is out of bound in file_link_free_page";
+    }
+
+    //get next page of prev page
+    DSM::_dsm_page_t prev_page;
+    if(!prev_pagenum){
+        get_header_page_from_multiple_layer(table_id, &prev_page._raw_page);
+        buffer_write_page(table_id, 0, nullptr); //release header page
+    }
+    else DSM::load_page_from_file(fd, prev_pagenum, &prev_page._raw_page);
+    pagenum_t nxt_page_number = prev_pagenum ? prev_page._free_page.nxt_free_page_number : prev_page._header_page.free_page_number;
+
+    //prev -> pagenum -> next
+    DSM::set_nxt_free_page_number(table_id, fd, pagenum, nxt_page_number);
+    DSM::set_nxt_free_page_number(table_id, fd, prev_pagenum, pagenum);
+}
+
+void file_unlink_free_page(int64_t table_id, pagenum_t prev_pagenum, pagenum_t pagenum){
+    int fd = DSM::get_writable_file_descriptor(table_id);
+    //check pagenum is valid
+    if(!pagenum || !DSM::is_pagenum_valid(fd,pagenum) || !DSM::is_pagenum_valid(fd,prev_pagenum)){
+        throw "pagenum is out of bound in file_unlink_free_page";
+    }
+
+    //prev -> next
+    DSM::_dsm_page_t page;
+    DSM::load_page_from_file(fd, pagenum, &page._raw_page);
+    DSM::set_nxt_free_page_number(table_id, fd, prev_pagenum, page._free_page.nxt_free_page_number);
+}
+
+void file_truncate_table_file(int64_t table_id, uint64_t number_of_pages){
+    int fd = DSM::get_writable_file_descriptor(table_id);
+
+    DSM::_dsm_page_t header_page, page;
+
+    //read header page (hold header page latch until end)
+    get_header_page_from_multiple_layer(table_id, &header_page._raw_page);
+    if(!number_of_pages || number_of_pages >= header_page._header_page.number_of_pages){
+        //nothing to truncate
+        buffer_write_page(table_id, 0, nullptr);
+        return;
+    }
+
+    //remove pages beyond new end from free page list
+    //(find new links first, slots of cut pages are dropped before links are written)
+    std::vector<std::pair<pagenum_t, pagenum_t>> links; //kept page (0 for header) -> its new next page
+    pagenum_t prev_page_number = 0;
+    pagenum_t prev_nxt_page_number = header_page._header_page.free_page_number; //link of prev page in file
+    pagenum_t cnt_page_number = header_page._header_page.free_page_number;
+    while(cnt_page_number){
+        DSM::load_page_from_file(fd, cnt_page_number, &page._raw_page);
+        pagenum_t nxt_page_number = page._free_page.nxt_free_page_number;
+        if(cnt_page_number < number_of_pages){
+            //keep this page (link of prev page changes only if pages were skipped)
+            if(prev_nxt_page_number != cnt_page_number) links.push_back({prev_page_number, cnt_page_number});
+            prev_page_number = cnt_page_number;
+            prev_nxt_page_number = nxt_page_number;
+        }
+        cnt_page_number = nxt_page_number;
+    }
+    if(prev_nxt_page_number) links.push_back({prev_page_number, 0});
+
+    DSM::table_info* info = DSM::find_table_info(fd);
+    if(info->compression){
+        //compressed table case
+        //slots are not in page order, so only free slots at the end of file are cut
+        //and other slots of cut pages are reused
+        DSM::drop_compressed_pages(info, number_of_pages);
+        //dropped slots of lazy sync table are free after sync
+        if(DSM::is_lazy_sync_table(info) && DSM::sync_table_file(info) == -1){
+            throw "sync system call failed!";
+        }
+        DSM::trim_compressed_slots(info);
+    }
+
+    for(auto& link : links){
+        if(!link.first) header_page._header_page.free_page_number = link.second;
+        else DSM::set_nxt_free_page_number(table_id, fd, link.first, link.second);
+    }
+
+    //shrink header first, then file
+    header_page._header_page.number_of_pages = number_of_pages;
+    set_header_page_from_multiple_layer(table_id, &header_page._raw_page);
+
+    if(info->compression) return; //already cut
+    if(info->backend->truncate(fd, number_of_pages * PAGE_SIZE) == -1){
+        throw "truncate system call failed!";
+    }
+}
+
+int file_get_compression_stats(int64_t table_id, file_compression_stats_t* stats){
+    int fd; //file descriptor
+    if((fd = DSM::get_file_descriptor(table_id)) == -1){
+        throw "unvalid table id";
+    }
+    DSM::compression_t* cm = DSM::find_table_info(fd)->compression;
+    if(!cm) return -1; //not compressed table
+
+    pthread_mutex_lock(&cm->latch);
+    *stats = cm->stats;
+    stats->file_bytes = cm->end_offset;
+    pthread_mutex_unlock(&cm->latch);
+    return 0;
+}
+
+const page_t* file_get_mapped_page(int64_t table_id, pagenum_t pagenum){
+    int fd; //file descriptor
+    if((fd = DSM::get_file_descriptor(table_id)) == -1){
+        throw "unvalid table id";
+    }
+    DSM::table_info* info = DSM::find_table_info(fd);
+    //not mapped case
+    if(!info->mapped_pages) return nullptr;
+
+    //check pagenum is valid
+    if(pagenum >= info->number_of_pages){
+        throw "pagenum is out of bound in file_get_mapped_page";
+    }
+    return info->mapped_pages + pagenum;
+}
+
+void file_prefetch_mapped_pages(int64_t table_id, pagenum_t pagenum, uint64_t count){
+    int fd; //file descriptor
+    if((fd = DSM::get_file_descriptor(table_id)) == -1){
+        throw "unvalid table id";
+    }
+    DSM::table_info* info = DSM::find_table_info(fd);
+    //not mapped or out of bound case, just ignore hint
+    if(!info->mapped_pages || pagenum >= info->number_of_pages) return;
+
+    count = std::min<uint64_t>(count, info->number_of_pages - pagenum);
+    madvise(info->mapped_pages + pagenum, count * PAGE_SIZE, MADV_WILLNEED);
+}
+
+void file_sync_table_files(){
+    //O_SYNC table is always durable
+    //sync lazy sync table only (outside list latch like sync thread)
+    pthread_mutex_lock(&DSM::file_list_latch);
+    std::vector<DSM::table_info*> tables = DSM::get_tables_to_sync(FILE_PERIODIC_SYNC_FLAG | FILE_CHECKPOINT_SYNC_FLAG);
+    pthread_mutex_unlock(&DSM::file_list_latch);
+    for(DSM::table_info* info : tables){
+        if(DSM::sync_table_file(info)==-1) throw "sync system call failed!";
+    }
+}
+
+void file_set_sync_interval(int interval_ms){
+    pthread_mutex_lock(&DSM::file_list_latch);
+    DSM::SYNC_INTERVAL_MS = interval_ms > 0 ? interval_ms : DEFAULT_SYNC_INTERVAL_MS;
+    pthread_mutex_unlock(&DSM::file_list_latch);
+}
+
+void file_set_storage_backend(const storage_backend_t* backend){
+    pthread_mutex_lock(&DSM::file_list_latch);
+    DSM::STORAGE_BACKEND = backend;
+    pthread_mutex_unlock(&DSM::file_list_latch);
+}
+
+int file_remove_table_file(const char* pathname){
+    return DSM::get_backend(-1)->remove_file(pathname);
+}
+
 void file_close_table_file(){
+    //stop background sync first
+    DSM::stop_sync_thread();
+
+    //make all writes durable before close
+    file_sync_table_files();
+
     //close all opened file descriptor
     for(int i=0;i<DSM::DB_FILE_LIST_SIZE;i++){
         DSM::table_info &it = DSM::DB_FILE_LIST[i];
-        if(close(it.fd)==-1){
+        //unmap read-only table
+        if(it.mapped_pages && it.backend->unmap(it.mapped_pages, it.mapped_size)==-1){
+            throw "munmap system call failed!";
+        }
+        if(it.backend->close_file(it.fd)==-1){
             throw "close db file failed";
         }
         free((void*)it.path); //free all path string
-        it = {0,0,0}; //clear element
+        delete it.compression;
+        it = {0,0,0,0,0,0,0,0,0,0}; //clear element
 
     }
     //clear list
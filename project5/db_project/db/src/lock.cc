@@ -1,13 +1,22 @@
 #include "lock.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 namespace LM{
     //lock manager latch
-    pthread_mutex_t lock_manager_latch = PTHREAD_MUTEX_INITIALIZER;
+    //shared mode for work inside one partition, exclusive mode for work across partitions
+    pthread_rwlock_t lock_manager_latch = PTHREAD_RWLOCK_INITIALIZER;
 
-    //hash table that mapping page lock list in the table
-    //search key is page_id({table_id, pagenum})
-    //value is lock header's pointer
-    std::unordered_map<page_id, lock_head_t*, LM::hash_pair> lock_table;
+    //lock table split into partitions by page_id({table_id, pagenum})
+    //each partition maps page to lock header's pointer
+    lock_table_partition_t partitions[LOCK_TABLE_PARTITIONS];
+
+    //parking slot of each thread
+    thread_local lock_wait_slot_t wait_slot;
+
+    //shared latches of caller released while this thread sleeps (see lock_set_wait_latches)
+    thread_local pthread_rwlock_t* wait_latches[2];
 
     //code by boost lib
     // https://www.boost.org/doc/libs/1_64_0/boost/functional/hash/hash.hpp
@@ -19,18 +28,71 @@ namespace LM{
         return hash1 ^ hash2 + 0x9e3779b9 + (hash2<<6) + (hash2>>2);
     }
 
+    lock_table_partition_t* get_partition(int64_t table_id, pagenum_t pagenum){
+        return &LM::partitions[LM::hash_pair{}(page_id{table_id, pagenum}) % LOCK_TABLE_PARTITIONS];
+    }
+
+    lock_t* alloc_lock_object(lock_table_partition_t* partition){
+        if(!partition->free_locks){
+            //pool is empty, make new slab
+            lock_slab_t* slab = new lock_slab_t;
+            partition->slabs.push_back(slab);
+            for(lock_t& lock_obj : slab->locks){
+                lock_obj.nxt_lock = partition->free_locks;
+                partition->free_locks = &lock_obj;
+            }
+        }
+
+        lock_t* ret = partition->free_locks;
+        partition->free_locks = ret->nxt_lock;
+        partition->lock_objects++;
+
+        //reset recycled object
+        return new(ret) lock_t;
+    }
+
+    void free_lock_object(lock_table_partition_t* partition, lock_t* lock_obj){
+        lock_obj->nxt_lock = partition->free_locks;
+        partition->free_locks = lock_obj;
+    }
+
+    lock_queue_node_t* alloc_queue_node(lock_table_partition_t* partition){
+        if(!partition->free_nodes){
+            //pool is empty, make new slab
+            lock_queue_node_slab_t* slab = new lock_queue_node_slab_t;
+            partition->node_slabs.push_back(slab);
+            for(lock_queue_node_t& node : slab->nodes){
+                node.nxt_node = partition->free_nodes;
+                partition->free_nodes = &node;
+            }
+        }
+
+        lock_queue_node_t* ret = partition->free_nodes;
+        partition->free_nodes = ret->nxt_node;
+
+        //reset recycled node
+        return new(ret) lock_queue_node_t;
+    }
+
+    void free_queue_node(lock_table_partition_t* partition, lock_queue_node_t* node){
+        node->nxt_node = partition->free_nodes;
+        partition->free_nodes = node;
+    }
+
     lock_t* make_and_init_new_lock_object(int64_t table_id, pagenum_t page_id, int64_t key, uint32_t slot_number, int trx_id, int lock_mode){
         //make new lock
-        lock_t* ret = new lock_t;
+        lock_t* ret = LM::alloc_lock_object(LM::get_partition(table_id, page_id));
 
         //slot number bitmap for lock compression
-        uint64_t slot_number_bitmask = (1LL<<slot_number);
+        slot_bitmap_t slot_number_bitmask;
+        slot_number_bitmask.set(slot_number);
 
         //initialize lock object
         ret->lock_mode = lock_mode;
         ret->owner_trx_id = trx_id;
         ret->record_id = key;
         ret->bitmap = slot_number_bitmask;
+        ret->slot_number = slot_number;
         return ret;
     }
 
@@ -57,10 +119,12 @@ namespace LM{
 
     lock_head_t* find_lock_head_in_table(int64_t table_id, pagenum_t pagenum){
         page_id pid = {table_id, pagenum}; //make page_id to use as search key in hash table
-        if(LM::lock_table.find(pid)!=LM::lock_table.end()){
+        auto& lock_table = LM::get_partition(table_id, pagenum)->lock_table;
+        auto it = lock_table.find(pid);
+        if(it!=lock_table.end()){
             //found case
             //return corresponding object pointer
-            return LM::lock_table[pid];
+            return it->second;
         }
         else{
             //not found case
@@ -71,10 +135,12 @@ namespace LM{
 
     lock_head_t* insert_new_lock_head_in_table(int64_t table_id, pagenum_t pagenum){
         //make and initialize new lock head
-        lock_head_t* lock_head = new lock_head_t{table_id,pagenum,nullptr,nullptr};
+        lock_head_t* lock_head = new lock_head_t;
+        lock_head->table_id = table_id;
+        lock_head->page_id = pagenum;
         page_id pid = {table_id, pagenum}; //make page_id to use as search key in hash table
         //insert lock head at pid
-        LM::lock_table.insert(std::make_pair(pid,lock_head));
+        LM::get_partition(table_id, pagenum)->lock_table.insert(std::make_pair(pid,lock_head));
         return lock_head;
     }
 
@@ -95,16 +161,65 @@ namespace LM{
         //set tail lock
         lock_head->tail = lock_obj;
 
+        //append in record queue of its slot
+        lock_queue_t& queue = LM::get_slot_queue(lock_head, lock_obj->slot_number);
+        lock_obj->slot_node.lock = lock_obj;
+        lock_obj->slot_node.slot_number = lock_obj->slot_number;
+        LM::insert_node_in_slot_queue(queue, queue.tail, &lock_obj->slot_node);
+
+        //first S lock of trx becomes lock compression target
+        if(lock_obj->lock_mode == SHARED_LOCK_MODE) lock_head->shared_locks.emplace(lock_obj->owner_trx_id, lock_obj);
+
         //make connection in respect to transaction table lock list
         trx_append_lock_in_trx_list(lock_obj->owner_trx_id, lock_obj);
 
         return;
     }
 
+    lock_queue_t& get_slot_queue(lock_head_t* lock_head, uint32_t slot_number){
+        if(lock_head->slot_queues.size() <= slot_number) lock_head->slot_queues.resize(slot_number + 1);
+        return lock_head->slot_queues[slot_number];
+    }
+
+    void insert_node_in_slot_queue(lock_queue_t& queue, lock_queue_node_t* prev_node, lock_queue_node_t* node){
+        node->prev_node = prev_node;
+        node->nxt_node = prev_node ? prev_node->nxt_node : queue.head;
+
+        if(prev_node) prev_node->nxt_node = node;
+        else queue.head = node;
+
+        if(node->nxt_node) node->nxt_node->prev_node = node;
+        else queue.tail = node;
+    }
+
+    void remove_node_from_slot_queue(lock_queue_t& queue, lock_queue_node_t* node){
+        if(node->prev_node) node->prev_node->nxt_node = node->nxt_node;
+        else queue.head = node->nxt_node;
+
+        if(node->nxt_node) node->nxt_node->prev_node = node->prev_node;
+        else queue.tail = node->prev_node;
+    }
+
     void remove_lock_from_lock_list(lock_t* lock_obj){
         //get lock header
         lock_head_t *lock_head = lock_obj->sentinel;
 
+        //remove from record queue of every slot in bitmap (one node for each slot)
+        LM::remove_node_from_slot_queue(LM::get_slot_queue(lock_head, lock_obj->slot_number), &lock_obj->slot_node);
+        lock_table_partition_t* partition = LM::get_partition(lock_head->table_id, lock_head->page_id);
+        lock_queue_node_t* node = lock_obj->slot_node.nxt_merged_node;
+        while(node){
+            lock_queue_node_t* nxt_merged_node = node->nxt_merged_node;
+            LM::remove_node_from_slot_queue(LM::get_slot_queue(lock_head, node->slot_number), node);
+            LM::free_queue_node(partition, node);
+            node = nxt_merged_node;
+        }
+        lock_obj->slot_node.nxt_merged_node = nullptr;
+
+        //drop from lock compression index
+        auto it = lock_head->shared_locks.find(lock_obj->owner_trx_id);
+        if(it != lock_head->shared_locks.end() && it->second == lock_obj) lock_head->shared_locks.erase(it);
+
         if(lock_obj->prev_lock){
             //predecessor lock existed
             //connect it with nxt lock
@@ -133,53 +248,44 @@ namespace LM{
     lock_t* find_compatible_lock_in_lock_list(lock_head_t* lock_head, lock_t* lock_obj){
         //find lock already acquired by given txn
         //found lock should be X lock or given lock should be S lock
-
-        //start at head lock
-        lock_t *cnt_lock = lock_head->head;
+        //only locks of the same record (slot) are looked at
 
         //current lock object's info
-        //use as distinguish compatible lock in page lock list
-        int64_t key = lock_obj->record_id;
+        //use as distinguish compatible lock in record queue
         int trx_id = lock_obj->owner_trx_id;
         int lock_mode = lock_obj->lock_mode;
-        uint64_t bitmap = lock_obj->bitmap;
 
         //searching phase
-        while(cnt_lock){
-            //find same record lock
-            //which trx id same and can share with this lock
-            if((cnt_lock->record_id == key || (cnt_lock->bitmap & bitmap) != 0 )
-            && cnt_lock->owner_trx_id == trx_id
+        for(lock_queue_node_t* node = LM::get_slot_queue(lock_head, lock_obj->slot_number).head; node; node = node->nxt_node){
+            lock_t* cnt_lock = node->lock;
+            //find lock which trx id same and can share with this lock
+            if(cnt_lock->owner_trx_id == trx_id
             && ((cnt_lock->lock_mode == EXCLUSIVE_LOCK_MODE) || (lock_mode == SHARED_LOCK_MODE))){
                 //can share with this lock
                 return cnt_lock;
             }
-            //get next lock
-            cnt_lock = cnt_lock->nxt_lock;
         }
         return nullptr; //not found
     }
 
+    bool has_conflicting_lock_in_lock_list(lock_head_t* lock_head, lock_t* lock_obj){
+        //same condition as conflicting lock in deadlock detection
+        for(lock_queue_node_t* node = LM::get_slot_queue(lock_head, lock_obj->slot_number).head; node; node = node->nxt_node){
+            lock_t* cnt_lock = node->lock;
+            if(cnt_lock->owner_trx_id != lock_obj->owner_trx_id
+            && (cnt_lock->lock_mode | lock_obj->lock_mode) == EXCLUSIVE_LOCK_MODE){
+                return true;
+            }
+        }
+        return false;
+    }
+
     lock_t* find_same_trx_lock_in_lock_list(lock_head_t* lock_head, int trx_id){
         //find shared lock already acquired by given txn
         //for lock compression (share lock object)
-
-        //start at head lock
-        lock_t *cnt_lock = lock_head->head;
-
-        //searching phase
-        while(cnt_lock){
-            //find same trx lock
-            //which trx id same
-            if(cnt_lock->owner_trx_id == trx_id
-            && cnt_lock->lock_mode == SHARED_LOCK_MODE){
-                //can share with this lock
-                return cnt_lock;
-            }
-            //get next lock
-            cnt_lock = cnt_lock->nxt_lock;
-        }
-        return nullptr; //not found
+        //first S lock of each trx is kept in lock head
+        auto it = lock_head->shared_locks.find(trx_id);
+        return it != lock_head->shared_locks.end() ? it->second : nullptr;
     }
 
     int detect_deadlock(lock_t* lock_obj, int source_trx_id, bool is_first){
@@ -210,88 +316,51 @@ namespace LM{
         //find out-degree edge from current lock object in wait-for graph
         //current trx may be conflicted with one X lock or several S locks
         //find first conflicting X lock or a series of S locks
+        //waiting (or new) lock covers only its own slot (lock compression merges granted locks)
+        //so only record queue of the slot is looked at
 
         //current lock object's info
-        //use as distinguish conflicting lock in page lock list
-        int64_t key = lock_obj->record_id;
+        //use as distinguish conflicting lock in record queue
         int trx_id = lock_obj->owner_trx_id;
         int lock_mode = lock_obj->lock_mode;
-        uint64_t bitmap = lock_obj->bitmap;
+        //start at right before current lock (new lock is not in the queue yet, so start at tail)
+        lock_queue_node_t* node = lock_obj->slot_node.lock ? lock_obj->slot_node.prev_node
+            : LM::get_slot_queue(lock_obj->sentinel, lock_obj->slot_number).tail;
 
-        //start at right before current lock
-        lock_t* cnt_lock = lock_obj->prev_lock;
-
-        //flags for filter first conflicting lock
-        //use bitmap checking record-wise for lock compression
         int waiting_num = 0;
-        uint64_t has_prev_shared_lock = 0;
-        uint64_t has_prev_exclusive_lock = 0;
 
         //searching phase
-        while(cnt_lock){
-            //find same record lock
-            //which trx id is not same (same trx lock is not conflicted)
+        for(; node; node = node->prev_node){
+            lock_t* cnt_lock = node->lock;
+
+            //find lock which trx id is not same (same trx lock is not conflicted)
             //and at least one is X lock (only S lock doesn't make conflict)
+            if(cnt_lock->owner_trx_id == trx_id || (cnt_lock->lock_mode | lock_mode) != EXCLUSIVE_LOCK_MODE) continue;
 
-            if((has_prev_exclusive_lock & bitmap) == bitmap){
-                //checked all record-wise lock already
-                //no need to check further
-                //end searching phase
+            if(cnt_lock->lock_mode == EXCLUSIVE_LOCK_MODE && waiting_num){
+                //X lock before conflicting S locks
+                //current trx waits for it through those S locks
                 break;
             }
 
-            if((cnt_lock->record_id == key || (cnt_lock->bitmap & bitmap) != 0 )
-            && cnt_lock->owner_trx_id != trx_id
-            && (cnt_lock->lock_mode | lock_mode) == EXCLUSIVE_LOCK_MODE){
-                if(cnt_lock->lock_mode == EXCLUSIVE_LOCK_MODE){
-                    //current lock is X lock
-                    if(((has_prev_shared_lock|has_prev_exclusive_lock) & (cnt_lock->bitmap)) != 0){
-                        //there is conflicting lock after this lock
-                        //no need to check this lock (we already checked all lock)
-                        //set visit flag
-                        has_prev_exclusive_lock |= (cnt_lock->bitmap & bitmap);
-                        //get next step
-                        cnt_lock = cnt_lock->prev_lock;
-                        continue;
-                    }
-                    //set visit flag
-                    has_prev_exclusive_lock |= (cnt_lock->bitmap & bitmap);
-                    
-                }
-                else{
-                    //current lock is S lock
-                    if(((has_prev_exclusive_lock) & (cnt_lock->bitmap)) != 0){
-                        //there is conflicting lock after this lock
-                        //no need to check this lock (we already checked all lock)
-                        //set visit flag
-                        has_prev_shared_lock |= (cnt_lock->bitmap & bitmap);
-                        //get next step
-                        cnt_lock = cnt_lock->prev_lock;
-                        continue;
-                    }
-                    //set visit flag
-                    has_prev_shared_lock |= (cnt_lock->bitmap & bitmap);
-                }
-
-                //current trx waits for cnt_lock's trx(cnt_lock->owner_trx_id)
+            //current trx waits for cnt_lock's trx(cnt_lock->owner_trx_id)
                 
-                //count conflicting trx
-                waiting_num ++;
+            //count conflicting trx
+            waiting_num ++;
 
-                //get last lock in next step trx
-                lock_t* nxt_lock_obj = trx_get_last_lock_in_trx_list(cnt_lock->owner_trx_id);
+            //get last lock in next step trx
+            lock_t* nxt_lock_obj = trx_get_last_lock_in_trx_list(cnt_lock->owner_trx_id);
                 
-                //check deadlock in next step trx
-                int ret = LM::detect_deadlock(nxt_lock_obj, source_trx_id, false);
-                if(ret == -1){
-                    //deadlock occured
-                    //return -1
-                    return ret;
-                }
+            //check deadlock in next step trx
+            int ret = LM::detect_deadlock(nxt_lock_obj, source_trx_id, false);
+            if(ret == -1){
+                //deadlock occured
+                //return -1
+                return ret;
             }
 
-            //get previous lock
-            cnt_lock = cnt_lock->prev_lock;
+            //no need to check before first conflicting X lock
+            if(cnt_lock->lock_mode == EXCLUSIVE_LOCK_MODE) break;
         }
 
         //return the number of conflicting operation
@@ -300,80 +369,46 @@ namespace LM{
 
     void wake_conflicting_lock_in_lock_list(lock_t* lock_obj){
         //find in-degree edge from current lock object in wait-for graph
-        //current trx may be conflicted with one X lock or several S locks
-        //find first conflicting X lock or a series of S locks
+        //successor may be conflicted with one X lock or several S locks
+        //so wake successors up to first conflicting X lock in record queue of every slot in bitmap
+        //(waiting lock covers only its own slot, so it is found in one queue only)
 
         //current lock object's info
-        //use as distinguish conflicting lock in page lock list
-        int64_t key = lock_obj->record_id;
+        //use as distinguish conflicting lock in record queue
         int trx_id = lock_obj->owner_trx_id;
         int lock_mode = lock_obj->lock_mode;
-        uint64_t bitmap = lock_obj->bitmap;
 
-        //start at right next to current lock
-        lock_t *cnt_lock = lock_obj->nxt_lock;
+        //lock has one node in record queue of each slot in bitmap
+        for(lock_queue_node_t* slot_node = &lock_obj->slot_node; slot_node; slot_node = slot_node->nxt_merged_node){
+            //flag for filter first conflicting lock
+            bool has_prev_shared_lock = false;
 
-        //flags for filter first conflicting lock
-        //use bitmap checking record-wise for lock compression
-        uint64_t has_prev_shared_lock = 0;
-        uint64_t has_prev_exclusive_lock = 0;
-
-        //searching phase
-        while(cnt_lock){
-            //find same record lock
-            //which trx id is not same (same trx lock is not conflicted)
-            //and at least one is X lock (only S lock doesn't make conflict)
+            //searching phase (start at right next to current lock)
+            for(lock_queue_node_t* node = slot_node->nxt_node; node; node = node->nxt_node){
+                lock_t* cnt_lock = node->lock;
 
-            if((has_prev_exclusive_lock & bitmap) == bitmap){
-                //checked all record-wise lock already
-                //no need to check further
-                //end searching phase
-                break;
-            }
+                //find lock which trx id is not same (same trx lock is not conflicted)
+                //and at least one is X lock (only S lock doesn't make conflict)
+                if(cnt_lock->owner_trx_id == trx_id || (cnt_lock->lock_mode | lock_mode) != EXCLUSIVE_LOCK_MODE) continue;
 
-            if((cnt_lock->record_id == key || (cnt_lock->bitmap & bitmap) != 0 )
-            && cnt_lock->owner_trx_id != trx_id
-            && (cnt_lock->lock_mode | lock_mode) == EXCLUSIVE_LOCK_MODE){
-                if(cnt_lock->lock_mode == EXCLUSIVE_LOCK_MODE){
-                    //current lock is X lock
-                    if(((has_prev_shared_lock|has_prev_exclusive_lock) & (cnt_lock->bitmap)) != 0){
-                        //there is conflicting lock after this lock
-                        //no need to check this lock (we already checked all lock)
-                        //set visit flag
-                        has_prev_exclusive_lock |= (cnt_lock->bitmap & bitmap);
-                        //get next step
-                        cnt_lock = cnt_lock->nxt_lock;
-                        continue;
-                    }
-                    //set visit flag
-                    has_prev_exclusive_lock |= (cnt_lock->bitmap & bitmap);
-                    
-                }
-                else{
-                    //current lock is S lock
-                    if(((has_prev_exclusive_lock) & (cnt_lock->bitmap)) != 0){
-                        //there is conflicting lock after this lock
-                        //no need to check this lock (we already checked all lock)
-                        //set visit flag
-                        has_prev_shared_lock |= (cnt_lock->bitmap & bitmap);
-                        //get next step
-                        cnt_lock = cnt_lock->nxt_lock;
-                        continue;
-                    }
-                    //set visit flag
-                    has_prev_shared_lock |= (cnt_lock->bitmap & bitmap);
-                }
+                //X lock after conflicting S lock still waits for it
+                if(cnt_lock->lock_mode == EXCLUSIVE_LOCK_MODE && has_prev_shared_lock) break;
 
                 if(cnt_lock->waiting_num > 0){
                     //current lock is waiting for this lock's release
                     cnt_lock->waiting_num--;
                     //wake up the successor if there is no longer conflicting trx
-                    if(cnt_lock->waiting_num == 0) pthread_cond_signal(&cnt_lock->cond);
+                    //(partition latch is held, so slot owner can't leave before the wake call)
+                    if(cnt_lock->waiting_num == 0 && cnt_lock->wait_slot){
+                        cnt_lock->wait_slot->state.store(0, std::memory_order_release);
+                        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&cnt_lock->wait_slot->state), FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+                    }
                 }
-            }
 
-            //get next lock
-            cnt_lock = cnt_lock->nxt_lock;
+                //locks after first conflicting X lock wait for it
+                if(cnt_lock->lock_mode == EXCLUSIVE_LOCK_MODE) break;
+                has_prev_shared_lock = true;
+            }
         }
 
         return;
@@ -402,8 +437,21 @@ namespace LM{
         if(same_trx_lock && same_trx_lock != lock_obj){
            //find same trx lock
 
-            //set bit flag on
-            same_trx_lock->bitmap |= lock_obj->bitmap;
+            lock_table_partition_t* partition = LM::get_partition(lock_obj->sentinel->table_id, lock_obj->sentinel->page_id);
+
+            if(!same_trx_lock->bitmap.test(lock_obj->slot_number)){
+                //set bit flag on
+                same_trx_lock->bitmap.set(lock_obj->slot_number);
+
+                //same trx lock takes place of current lock in record queue
+                //(no conflicting lock can be between them since current lock is acquired)
+                lock_queue_node_t* node = LM::alloc_queue_node(partition);
+                node->lock = same_trx_lock;
+                node->slot_number = lock_obj->slot_number;
+                LM::insert_node_in_slot_queue(LM::get_slot_queue(lock_obj->sentinel, lock_obj->slot_number), &lock_obj->slot_node, node);
+                node->nxt_merged_node = same_trx_lock->slot_node.nxt_merged_node;
+                same_trx_lock->slot_node.nxt_merged_node = node;
+            }
 
             //remove current lock object
             LM::remove_lock_from_lock_list(lock_obj);
@@ -411,19 +459,54 @@ namespace LM{
             //disconnect in respect to transaction table lock list
             trx_remove_lock_in_trx_list(lock_obj->owner_trx_id, lock_obj);
 
-            delete lock_obj;
+            LM::free_lock_object(partition, lock_obj);
         }
     }
 
-    int try_to_acquire_lock_object(int64_t table_id, pagenum_t page_id, int64_t key, uint32_t slot_number, int trx_id, int lock_mode){
+    void wait_for_conflicting_locks(lock_t* lock_obj){
+        lock_table_partition_t* partition = LM::get_partition(lock_obj->sentinel->table_id, lock_obj->sentinel->page_id);
+
+        //let other partitions and structure changes of caller's tree go while sleeping
+        pthread_rwlock_unlock(&LM::lock_manager_latch);
+        for(int i = 1; i >= 0; i--){
+            if(LM::wait_latches[i]) pthread_rwlock_unlock(LM::wait_latches[i]);
+        }
+
+        //point lock to slot of this thread while it waits
+        lock_wait_slot_t* slot = &LM::wait_slot;
+        slot->state.store(1, std::memory_order_relaxed);
+        lock_obj->wait_slot = slot;
+
+        //wait for all conflicting locks released
+        //waker clears slot state when waiting num reaches 0, wake up without it is spurious
+        while(lock_obj->waiting_num > 0){
+            pthread_mutex_unlock(&partition->latch);
+            while(slot->state.load(std::memory_order_acquire)){
+                syscall(SYS_futex, reinterpret_cast<uint32_t*>(&slot->state), FUTEX_WAIT_PRIVATE, 1, NULL, NULL, 0);
+            }
+            pthread_mutex_lock(&partition->latch);
+        }
+        lock_obj->wait_slot = nullptr;
+
+        //take caller's latches and lock manager latch again (before partition latch to keep latch order)
+        pthread_mutex_unlock(&partition->latch);
+        for(pthread_rwlock_t* latch : LM::wait_latches){
+            if(latch) pthread_rwlock_rdlock(latch);
+        }
+        pthread_rwlock_rdlock(&LM::lock_manager_latch);
+        pthread_mutex_lock(&partition->latch);
+    }
+
+    int try_to_acquire_lock_object(int64_t table_id, pagenum_t page_id, int64_t key, uint32_t slot_number, int trx_id, int lock_mode, bool is_exclusive){
         
         //make new lock
+        lock_table_partition_t* partition = LM::get_partition(table_id, page_id);
         lock_t* ret = LM::make_and_init_new_lock_object(table_id, page_id, key, slot_number, trx_id, lock_mode);
 
         //connect with lock header
         if(LM::connect_with_lock_head(table_id,page_id,ret) != 0){
             //error with lock header
-            delete ret;
+            LM::free_lock_object(partition, ret);
             return -1;
         }
 
@@ -435,19 +518,30 @@ namespace LM{
         if(compatible_lock){
             //found compatible lock
             //just return this lock
-            delete ret;
+            LM::free_lock_object(partition, ret);
             return 0;
         }
 
         //connect to lock tail
         ret->prev_lock = lock_head->tail;
 
-        //check deadlock
-        int conflicting_flag = LM::detect_deadlock(ret, trx_id);
+        int conflicting_flag = 0;
+        if(!is_exclusive){
+            //deadlock detection walks lock lists of other partitions
+            //so conflicting request retries in exclusive mode
+            if(LM::has_conflicting_lock_in_lock_list(lock_head, ret)){
+                LM::free_lock_object(partition, ret);
+                return LOCK_RETRY_EXCLUSIVE;
+            }
+        }
+        else{
+            //check deadlock
+            conflicting_flag = LM::detect_deadlock(ret, trx_id);
+        }
 
         if(conflicting_flag == -1){
             //deadlock occurred
-            delete ret;
+            LM::free_lock_object(partition, ret);
             return -1; //error
         }
 
@@ -461,7 +555,7 @@ namespace LM{
             if(acquired_trx_id == trx_id){
                 //found compatible implicit lock
                 //just return this lock
-                delete ret;
+                LM::free_lock_object(partition, ret);
                 return 0;
             }
 
@@ -470,7 +564,7 @@ namespace LM{
 
             if(is_valid < 0){
                 //error in trx manager
-                delete ret;
+                LM::free_lock_object(partition, ret);
                 return -1;
             }
 
@@ -478,14 +572,20 @@ namespace LM{
                 //there is implicit lock in slot
                 //need explicit lock for both txn
 
+                if(!is_exclusive){
+                    //conversion changes lock list of other trx
+                    LM::free_lock_object(partition, ret);
+                    return LOCK_RETRY_EXCLUSIVE;
+                }
+
                 //convert implicit lock to explicit lock
                 convert_implicit_lock_to_explicit_lock(table_id,page_id,key,slot_number,acquired_trx_id);
 
                 //delete lock
-                delete ret;
+                LM::free_lock_object(partition, ret);
 
                 //try lock again
-                return LM::try_to_acquire_lock_object(table_id, page_id, key, slot_number, trx_id, lock_mode);
+                return LM::try_to_acquire_lock_object(table_id, page_id, key, slot_number, trx_id, lock_mode, is_exclusive);
             }
         }
 
@@ -499,9 +599,7 @@ namespace LM{
             ret->waiting_num = conflicting_flag;
 
             //wait for all conflicting locks released
-            while(ret->waiting_num > 0){
-                pthread_cond_wait(&ret->cond, &LM::lock_manager_latch);
-            }
+            LM::wait_for_conflicting_locks(ret);
         }
 
         if(lock_mode == SHARED_LOCK_MODE){
@@ -513,7 +611,7 @@ namespace LM{
             //do implicit lock
 
             //write slot for implicit locking
-            idx_set_trx_id_in_slot(table_id, page_id, slot_number, trx_id);
+            idx_set_trx_id_in_slot(table_id, page_id, slot_number, key, trx_id);
         }
 
         return 0; //success
@@ -521,14 +619,15 @@ namespace LM{
 
     int release_acquired_lock(lock_t* lock_obj){
         
-        //remove lock from lock list
-        LM::remove_lock_from_lock_list(lock_obj);
-        
         //find conflicting lock and wake it up when there is no longer conflicting trx
+        //(before removal, position in record queue is needed)
         LM::wake_conflicting_lock_in_lock_list(lock_obj);
 
-        //delete lock object
-        delete lock_obj;
+        //remove lock from lock list
+        LM::remove_lock_from_lock_list(lock_obj);
+
+        //give lock object back to pool
+        LM::free_lock_object(LM::get_partition(lock_obj->sentinel->table_id, lock_obj->sentinel->page_id), lock_obj);
 
         return 0; //success
     }
@@ -536,49 +635,78 @@ namespace LM{
 }
 
 int init_lock_table(void){
-
-    LM::lock_manager_latch = PTHREAD_MUTEX_INITIALIZER;
+    //writer preferred so that whole table operations are not starved by partition work
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&LM::lock_manager_latch, &attr);
+    pthread_rwlockattr_destroy(&attr);
 
     //initailize lock table
-    LM::lock_table.clear();
+    for(auto& partition : LM::partitions){
+        partition.latch = PTHREAD_MUTEX_INITIALIZER;
+        partition.lock_table.clear();
+    }
 
     return 0;
 }
 
 int lock_acquire(int64_t table_id, pagenum_t page_id, int64_t key, uint32_t slot_number, int trx_id, int lock_mode){
     int status_code; //check pthread error
+    LM::lock_table_partition_t* partition = LM::get_partition(table_id, page_id);
+
+    //try in shared mode first, and in exclusive mode when request needs it
+    int acquired_lock = LOCK_RETRY_EXCLUSIVE;
+    for(bool is_exclusive : {false, true}){
+        //start critical section
+        if(is_exclusive) status_code = pthread_rwlock_wrlock(&LM::lock_manager_latch);
+        else status_code = pthread_rwlock_rdlock(&LM::lock_manager_latch);
+        if(status_code) return -1; //error
+        status_code = pthread_mutex_lock(&partition->latch);
+        if(status_code){
+            pthread_rwlock_unlock(&LM::lock_manager_latch);
+            return -1; //error
+        }
 
-    //start critical section
-    status_code = pthread_mutex_lock(&LM::lock_manager_latch);
-    if(status_code) return -1; //error
+        //acquire lock
+        acquired_lock = LM::try_to_acquire_lock_object(table_id, page_id, key, slot_number, trx_id, lock_mode, is_exclusive);
 
-    //acquire lock
-    int acquired_lock = LM::try_to_acquire_lock_object(table_id, page_id, key, slot_number, trx_id, lock_mode);
-    
-    //end critical section
-    status_code = pthread_mutex_unlock(&LM::lock_manager_latch);
-    if(status_code){
-        return -1; //error
+        //end critical section
+        status_code = pthread_mutex_unlock(&partition->latch);
+        status_code |= pthread_rwlock_unlock(&LM::lock_manager_latch);
+        if(status_code){
+            return -1; //error
+        }
+
+        if(acquired_lock != LOCK_RETRY_EXCLUSIVE) break;
     }
 
     //return lock object
     return acquired_lock;
 }
 
+void lock_set_wait_latches(pthread_rwlock_t* outer_latch, pthread_rwlock_t* inner_latch){
+    LM::wait_latches[0] = outer_latch;
+    LM::wait_latches[1] = inner_latch;
+}
+
 int lock_release(lock_t* lock_obj){
     int status_code; //check pthread error
+    LM::lock_table_partition_t* partition = LM::get_partition(lock_obj->sentinel->table_id, lock_obj->sentinel->page_id);
 
     //start critical section
-    status_code = pthread_mutex_lock(&LM::lock_manager_latch);
+    status_code = pthread_rwlock_rdlock(&LM::lock_manager_latch);
     if(status_code){
         return status_code; //error
     }
+    pthread_mutex_lock(&partition->latch);
 
     //release lock
     LM::release_acquired_lock(lock_obj);
 
     //end critical section
-    status_code = pthread_mutex_unlock(&LM::lock_manager_latch);
+    pthread_mutex_unlock(&partition->latch);
+    status_code = pthread_rwlock_unlock(&LM::lock_manager_latch);
     if(status_code){
         return status_code; //error
     }
@@ -592,8 +720,11 @@ int lock_release_all(lock_t* lock_obj){
         //get next lock in trx list
         lock_t* nxt_lock_obj = lock_obj->nxt_lock_in_trx;
         
-        //release current lock
+        //release current lock in its partition
+        LM::lock_table_partition_t* partition = LM::get_partition(lock_obj->sentinel->table_id, lock_obj->sentinel->page_id);
+        pthread_mutex_lock(&partition->latch);
         LM::release_acquired_lock(lock_obj);
+        pthread_mutex_unlock(&partition->latch);
         
         lock_obj = nxt_lock_obj; //next step lock
     }
@@ -602,26 +733,59 @@ int lock_release_all(lock_t* lock_obj){
 }
 
 int lock_acquire_lock_manager_latch(){
-    return pthread_mutex_lock(&LM::lock_manager_latch);
+    return pthread_rwlock_wrlock(&LM::lock_manager_latch);
+}
+
+int lock_try_acquire_lock_manager_latch(){
+    return pthread_rwlock_trywrlock(&LM::lock_manager_latch);
+}
+
+int lock_acquire_shared_lock_manager_latch(){
+    return pthread_rwlock_rdlock(&LM::lock_manager_latch);
+}
+
+bool lock_is_page_locked(int64_t table_id, pagenum_t page_id){
+    lock_head_t *lock_head = LM::find_lock_head_in_table(table_id,page_id);
+    return lock_head && lock_head->head;
 }
 
 int lock_release_lock_manager_latch(){
-    return pthread_mutex_unlock(&LM::lock_manager_latch);
+    return pthread_rwlock_unlock(&LM::lock_manager_latch);
+}
+
+void lock_get_pool_stats(uint64_t* lock_objects, uint64_t* slabs){
+    *lock_objects = *slabs = 0;
+    for(auto& partition : LM::partitions){
+        pthread_mutex_lock(&partition.latch);
+        *lock_objects += partition.lock_objects;
+        *slabs += partition.slabs.size();
+        pthread_mutex_unlock(&partition.latch);
+    }
 }
 
 void close_lock_table(){
     //start critical section
-    pthread_mutex_lock(&LM::lock_manager_latch);
+    pthread_rwlock_wrlock(&LM::lock_manager_latch);
 
-    for(auto& it : LM::lock_table){
-        delete it.second; //delete lock head
-    }
+    for(auto& partition : LM::partitions){
+        for(auto& it : partition.lock_table){
+            delete it.second; //delete lock head
+        }
+
+        partition.lock_table.clear(); //clear lock table
 
-    LM::lock_table.clear(); //clear lock table
+        //free lock object pool (every lock is released by trx manager already)
+        for(LM::lock_slab_t* slab : partition.slabs) delete slab;
+        partition.slabs.clear();
+        partition.free_locks = nullptr;
+        partition.lock_objects = 0;
+        for(LM::lock_queue_node_slab_t* slab : partition.node_slabs) delete slab;
+        partition.node_slabs.clear();
+        partition.free_nodes = nullptr;
+    }
     
     //end critical section
-    pthread_mutex_unlock(&LM::lock_manager_latch);
+    pthread_rwlock_unlock(&LM::lock_manager_latch);
 
     return;
-}
-
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "lz.h"
+
+namespace LZ{
+    uint32_t read32(const uint8_t* p){
+        uint32_t ret;
+        memcpy(&ret, p, sizeof(ret));
+        return ret;
+    }
+
+    uint32_t hash(uint32_t seq){
+        //multiplicative hash (Knuth)
+        return (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+    }
+
+    uint8_t* write_length(uint8_t* op, const uint8_t* op_end, int len){
+        while(len >= 255){
+            if(op >= op_end) return nullptr;
+            *op++ = 255;
+            len -= 255;
+        }
+        if(op >= op_end) return nullptr;
+        *op++ = len;
+        return op;
+    }
+
+    uint8_t* write_sequence(uint8_t* op, const uint8_t* op_end, const uint8_t* literals, int literal_len, int offset, int match_len){
+        if(op >= op_end) return nullptr;
+
+        //token
+        uint8_t* token = op++;
+        int match_code = match_len ? match_len - LZ_MIN_MATCH : 0;
+        *token = (std::min(literal_len, 15) << 4) | std::min(match_code, 15);
+
+        //literals
+        if(literal_len >= 15 && !(op = LZ::write_length(op, op_end, literal_len - 15))) return nullptr;
+        if(op + literal_len > op_end) return nullptr;
+        memcpy(op, literals, literal_len);
+        op += literal_len;
+
+        if(!match_len) return op; //last sequence
+
+        //match
+        if(op + 2 > op_end) return nullptr;
+        *op++ = offset & 0xff;
+        *op++ = offset >> 8;
+        if(match_code >= 15 && !(op = LZ::write_length(op, op_end, match_code - 15))) return nullptr;
+        return op;
+    }
+}
+
+int lz_compress(const uint8_t* src, int src_size, uint8_t* dst, int dst_capacity){
+    const uint8_t* ip = src; //current input position
+    const uint8_t* anchor = src; //start of pending literals
+    const uint8_t* end = src + src_size;
+    const uint8_t* match_limit = end - LZ_LAST_LITERALS; //match should end before last literals
+    uint8_t* op = dst;
+    const uint8_t* op_end = dst + dst_capacity;
+
+    //last position of each hashed 4 bytes sequence (-1 if none)
+    int32_t table[1 << LZ_HASH_BITS];
+    memset(table, -1, sizeof(table));
+
+    while(src_size >= LZ_MIN_MATCH + LZ_LAST_LITERALS && ip + LZ_MIN_MATCH <= match_limit){
+        uint32_t seq = LZ::read32(ip);
+        uint32_t h = LZ::hash(seq);
+        int32_t ref = table[h];
+        table[h] = ip - src;
+
+        if(ref < 0 || (ip - src) - ref > LZ_MAX_OFFSET || LZ::read32(src + ref) != seq){
+            //no match
+            ip++;
+            continue;
+        }
+
+        //extend match
+        const uint8_t* match = src + ref;
+        const uint8_t* p = ip + LZ_MIN_MATCH;
+        const uint8_t* q = match + LZ_MIN_MATCH;
+        while(p < match_limit && *p == *q){
+            p++;
+            q++;
+        }
+
+        op = LZ::write_sequence(op, op_end, anchor, ip - anchor, ip - match, p - ip);
+        if(!op) return 0; //doesn't fit
+
+        ip = p;
+        anchor = ip;
+    }
+
+    //last literals
+    op = LZ::write_sequence(op, op_end, anchor, end - anchor, 0, 0);
+    if(!op) return 0; //doesn't fit
+    return op - dst;
+}
+
+int lz_decompress(const uint8_t* src, int src_size, uint8_t* dst, int dst_size){
+    const uint8_t* ip = src;
+    const uint8_t* ip_end = src + src_size;
+    uint8_t* op = dst;
+    uint8_t* op_end = dst + dst_size;
+
+    while(ip < ip_end){
+        uint8_t token = *ip++;
+
+        //literals
+        int literal_len = token >> 4;
+        if(literal_len == 15){
+            uint8_t b;
+            do{
+                if(ip >= ip_end) return -1;
+                b = *ip++;
+                literal_len += b;
+            }while(b == 255);
+        }
+        if(ip + literal_len > ip_end || op + literal_len > op_end) return -1;
+        memcpy(op, ip, literal_len);
+        ip += literal_len;
+        op += literal_len;
+
+        if(ip == ip_end) break; //last sequence
+
+        //match
+        if(ip + 2 > ip_end) return -1;
+        int offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if(!offset || offset > op - dst) return -1;
+
+        int match_len = token & 15;
+        if(match_len == 15){
+            uint8_t b;
+            do{
+                if(ip >= ip_end) return -1;
+                b = *ip++;
+                match_len += b;
+            }while(b == 255);
+        }
+        match_len += LZ_MIN_MATCH;
+        if(op + match_len > op_end) return -1;
+
+        //copy byte by byte (match can overlap output)
+        const uint8_t* match = op - offset;
+        for(int i = 0; i < match_len; i++) op[i] = match[i];
+        op += match_len;
+    }
+    return op - dst;
+}
@@ -0,0 +1,279 @@
+#include "stats.h"
+#include <errno.h>
+#include <string.h>
+
+namespace ST{
+    //every shard ever made and shards of exited threads
+    std::vector<ST::shard_t*> shards;
+    std::vector<ST::shard_t*> free_shards;
+    pthread_mutex_t shard_latch = PTHREAD_MUTEX_INITIALIZER;
+
+    //periodic dump info
+    FILE* dump_file = nullptr;
+    int DUMP_INTERVAL_MS = 0;
+    pthread_t dump_thread;
+    bool is_dump_thread_running = false;
+    bool is_dump_thread_stopped = false; //stop flag
+    pthread_mutex_t dump_latch = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t dump_cond = PTHREAD_COND_INITIALIZER;
+
+    //give shard back when thread exits
+    struct shard_holder_t{
+        ST::shard_t* shard = nullptr;
+        ~shard_holder_t(){
+            if(!shard) return;
+            pthread_mutex_lock(&ST::shard_latch);
+            ST::free_shards.push_back(shard);
+            pthread_mutex_unlock(&ST::shard_latch);
+        }
+    };
+    thread_local ST::shard_holder_t shard_holder;
+
+    //set when table file without own counters is counted first
+    std::atomic<bool> is_overflow_warned{false};
+
+    io_timer_t::io_timer_t(int64_t table_id, int kind, uint64_t bytes)
+        : table_id(table_id), kind(kind), bytes(bytes), begin_ns(ST::now_ns()){}
+
+    io_timer_t::~io_timer_t(){
+        ST::record_latency(kind, ST::now_ns() - begin_ns);
+        if(kind == STATS_FILE_READ){
+            ST::add(table_id, ST::READS);
+            ST::add(table_id, ST::READ_BYTES, bytes);
+        }
+        else if(kind == STATS_FILE_WRITE){
+            ST::add(table_id, ST::WRITES);
+            ST::add(table_id, ST::WRITE_BYTES, bytes);
+        }
+    }
+
+    uint64_t now_ns(){
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    shard_t* get_shard(){
+        if(ST::shard_holder.shard) return ST::shard_holder.shard;
+
+        pthread_mutex_lock(&ST::shard_latch);
+        if(!ST::free_shards.empty()){
+            ST::shard_holder.shard = ST::free_shards.back();
+            ST::free_shards.pop_back();
+        }
+        else{
+            //value-initialized (all counters zero)
+            ST::shard_holder.shard = new ST::shard_t();
+            ST::shards.push_back(ST::shard_holder.shard);
+        }
+        pthread_mutex_unlock(&ST::shard_latch);
+        return ST::shard_holder.shard;
+    }
+
+    void add(int64_t table_id, counter_t counter, uint64_t n){
+        if(table_id < 0 || table_id >= STATS_MAX_TABLE_FILE){
+            if(!ST::is_overflow_warned.exchange(true, std::memory_order_relaxed)){
+                fprintf(stderr, "table file id is out of statistics range, counted in total only\n");
+            }
+            table_id = STATS_OVERFLOW_TABLE_FILE;
+        }
+        std::atomic<uint64_t>& c = ST::get_shard()->counters[table_id][counter];
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void sum_counters(int64_t index, io_stats_t* stats){
+        uint64_t sum[ST::COUNTER_NUMBER] = {0};
+        pthread_mutex_lock(&ST::shard_latch);
+        for(ST::shard_t* shard : ST::shards){
+            for(int i = 0; i < ST::COUNTER_NUMBER; i++){
+                sum[i] += shard->counters[index][i].load(std::memory_order_relaxed);
+            }
+        }
+        pthread_mutex_unlock(&ST::shard_latch);
+
+        stats->reads = sum[ST::READS];
+        stats->writes = sum[ST::WRITES];
+        stats->read_bytes = sum[ST::READ_BYTES];
+        stats->write_bytes = sum[ST::WRITE_BYTES];
+        stats->allocs = sum[ST::ALLOCS];
+        stats->frees = sum[ST::FREES];
+        stats->grows = sum[ST::GROWS];
+        stats->buffer_hits = sum[ST::BUFFER_HITS];
+        stats->buffer_misses = sum[ST::BUFFER_MISSES];
+        stats->evictions = sum[ST::EVICTIONS];
+        stats->dirty_flushes = sum[ST::DIRTY_FLUSHES];
+        stats->compressed_hits = sum[ST::COMPRESSED_HITS];
+    }
+
+    void record_latency(int kind, uint64_t ns){
+        ST::shard_t* shard = ST::get_shard();
+        int bucket = ns ? std::min(63 - __builtin_clzll(ns), STATS_HISTOGRAM_BUCKETS - 1) : 0;
+        std::atomic<uint64_t>& b = shard->histograms[kind][bucket];
+        b.store(b.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic<uint64_t>& t = shard->latency_ns[kind];
+        t.store(t.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    }
+
+    void* dump_thread_func(void* arg){
+        pthread_mutex_lock(&ST::dump_latch);
+        while(!ST::is_dump_thread_stopped){
+            //wait for interval or stop signal
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += ST::DUMP_INTERVAL_MS / 1000;
+            deadline.tv_nsec += (long)(ST::DUMP_INTERVAL_MS % 1000) * 1000000;
+            if(deadline.tv_nsec >= 1000000000){
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000;
+            }
+            while(!ST::is_dump_thread_stopped){
+                if(pthread_cond_timedwait(&ST::dump_cond, &ST::dump_latch, &deadline) == ETIMEDOUT) break;
+            }
+            ST::write_snapshot(ST::dump_file);
+        }
+        pthread_mutex_unlock(&ST::dump_latch);
+        return nullptr;
+    }
+
+    void write_snapshot(FILE* fp){
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        fprintf(fp, "# stats %ld.%03ld\n", (long)ts.tv_sec, ts.tv_nsec / 1000000);
+
+        auto print_io = [fp](const char* name, const io_stats_t& s){
+            fprintf(fp, "%s reads=%lu writes=%lu read_bytes=%lu write_bytes=%lu allocs=%lu frees=%lu grows=%lu"
+                " buffer_hits=%lu buffer_misses=%lu hit_ratio=%.4f evictions=%lu dirty_flushes=%lu compressed_hits=%lu\n",
+                name, s.reads, s.writes, s.read_bytes, s.write_bytes, s.allocs, s.frees, s.grows,
+                s.buffer_hits, s.buffer_misses, stats_get_hit_ratio(&s), s.evictions, s.dirty_flushes, s.compressed_hits);
+        };
+
+        db_stats_t stats;
+        stats_get(&stats);
+        print_io("total", stats.total);
+
+        //table files with any activity
+        for(int64_t tid = 0; tid < STATS_MAX_TABLE_FILE; tid++){
+            io_stats_t table_stats;
+            stats_get_table(tid, &table_stats);
+            if(!table_stats.reads && !table_stats.writes && !table_stats.buffer_hits && !table_stats.buffer_misses) continue;
+            char name[32];
+            snprintf(name, sizeof(name), "table %ld", tid);
+            print_io(name, table_stats);
+        }
+
+        const char* names[STATS_HISTOGRAM_NUMBER] = {"file_read", "file_write", "buffer_miss"};
+        for(int kind = 0; kind < STATS_HISTOGRAM_NUMBER; kind++){
+            const latency_histogram_t& hist = stats.latency[kind];
+            fprintf(fp, "latency %s count=%lu avg_ns=%lu p50_ns=%lu p99_ns=%lu p999_ns=%lu\n",
+                names[kind], hist.count, hist.count ? hist.total_ns / hist.count : 0,
+                stats_get_percentile(&hist, 0.5), stats_get_percentile(&hist, 0.99), stats_get_percentile(&hist, 0.999));
+        }
+        fflush(fp);
+    }
+}
+
+void stats_get(db_stats_t* stats){
+    memset(stats, 0, sizeof(db_stats_t));
+    //overflow counters are in total too
+    for(int64_t index = 0; index <= STATS_OVERFLOW_TABLE_FILE; index++){
+        io_stats_t table_stats;
+        ST::sum_counters(index, &table_stats);
+        stats->total.reads += table_stats.reads;
+        stats->total.writes += table_stats.writes;
+        stats->total.read_bytes += table_stats.read_bytes;
+        stats->total.write_bytes += table_stats.write_bytes;
+        stats->total.allocs += table_stats.allocs;
+        stats->total.frees += table_stats.frees;
+        stats->total.grows += table_stats.grows;
+        stats->total.buffer_hits += table_stats.buffer_hits;
+        stats->total.buffer_misses += table_stats.buffer_misses;
+        stats->total.evictions += table_stats.evictions;
+        stats->total.dirty_flushes += table_stats.dirty_flushes;
+        stats->total.compressed_hits += table_stats.compressed_hits;
+    }
+
+    pthread_mutex_lock(&ST::shard_latch);
+    for(ST::shard_t* shard : ST::shards){
+        for(int kind = 0; kind < STATS_HISTOGRAM_NUMBER; kind++){
+            latency_histogram_t& hist = stats->latency[kind];
+            for(int i = 0; i < STATS_HISTOGRAM_BUCKETS; i++){
+                uint64_t cnt = shard->histograms[kind][i].load(std::memory_order_relaxed);
+                hist.buckets[i] += cnt;
+                hist.count += cnt;
+            }
+            hist.total_ns += shard->latency_ns[kind].load(std::memory_order_relaxed);
+        }
+    }
+    pthread_mutex_unlock(&ST::shard_latch);
+}
+
+int stats_get_table(int64_t table_id, io_stats_t* stats){
+    memset(stats, 0, sizeof(io_stats_t));
+    if(table_id < 0 || table_id >= STATS_MAX_TABLE_FILE) return -1;
+
+    ST::sum_counters(table_id, stats);
+    return 0;
+}
+
+double stats_get_hit_ratio(const io_stats_t* stats){
+    uint64_t requests = stats->buffer_hits + stats->buffer_misses;
+    return requests ? (double)stats->buffer_hits / requests : 0;
+}
+
+uint64_t stats_get_percentile(const latency_histogram_t* hist, double q){
+    if(!hist->count) return 0;
+    uint64_t rank = (uint64_t)(q * hist->count);
+    uint64_t seen = 0;
+    for(int i = 0; i < STATS_HISTOGRAM_BUCKETS; i++){
+        seen += hist->buckets[i];
+        if(seen > rank) return (2ULL << i) - 1;
+    }
+    return (2ULL << (STATS_HISTOGRAM_BUCKETS - 1)) - 1;
+}
+
+void stats_reset_table(int64_t table_id){
+    if(table_id < 0 || table_id >= STATS_MAX_TABLE_FILE) return;
+
+    pthread_mutex_lock(&ST::shard_latch);
+    for(ST::shard_t* shard : ST::shards){
+        for(int i = 0; i < ST::COUNTER_NUMBER; i++){
+            shard->counters[table_id][i].store(0, std::memory_order_relaxed);
+        }
+    }
+    pthread_mutex_unlock(&ST::shard_latch);
+}
+
+int stats_set_dump(const char* path, int interval_ms){
+    stats_stop_dump();
+    if(!path || interval_ms <= 0) return 0;
+
+    FILE* fp = fopen(path, "a");
+    if(!fp) return -1;
+
+    ST::dump_file = fp;
+    ST::DUMP_INTERVAL_MS = interval_ms;
+    ST::is_dump_thread_stopped = false;
+    if(pthread_create(&ST::dump_thread, NULL, ST::dump_thread_func, NULL)){
+        fclose(fp);
+        ST::dump_file = nullptr;
+        return -1;
+    }
+    ST::is_dump_thread_running = true;
+    return 0;
+}
+
+void stats_stop_dump(){
+    //not running case
+    if(!ST::is_dump_thread_running) return;
+
+    //set stop flag and wake up thread (it writes the last snapshot)
+    pthread_mutex_lock(&ST::dump_latch);
+    ST::is_dump_thread_stopped = true;
+    pthread_cond_signal(&ST::dump_cond);
+    pthread_mutex_unlock(&ST::dump_latch);
+
+    pthread_join(ST::dump_thread, NULL);
+    ST::is_dump_thread_running = false;
+    fclose(ST::dump_file);
+    ST::dump_file = nullptr;
+}
@@ -0,0 +1,408 @@
+#include "storage.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <random>
+
+namespace SB{
+    char* posix_get_path(const char* pathname){
+        return realpath(pathname, NULL);
+    }
+
+    int posix_open_file(const char* pathname, int flags, mode_t mode){
+        return open64(pathname, flags, mode);
+    }
+
+    int posix_close_file(int fd){
+        return close(fd);
+    }
+
+    ssize_t posix_read(int fd, void* buf, size_t count, uint64_t offset){
+        return pread64(fd, buf, count, offset);
+    }
+
+    ssize_t posix_write(int fd, const void* buf, size_t count, uint64_t offset){
+        return pwrite64(fd, buf, count, offset);
+    }
+
+    ssize_t posix_readv(int fd, const struct iovec* iov, int iovcnt, uint64_t offset){
+        return preadv64(fd, iov, iovcnt, offset);
+    }
+
+    ssize_t posix_writev(int fd, const struct iovec* iov, int iovcnt, uint64_t offset){
+        return pwritev64(fd, iov, iovcnt, offset);
+    }
+
+    int posix_sync(int fd){
+        return fdatasync(fd);
+    }
+
+    int posix_truncate(int fd, uint64_t length){
+        return ftruncate64(fd, length);
+    }
+
+    int64_t posix_get_size(int fd){
+        struct stat st;
+        if(fstat(fd, &st) == -1) return -1;
+        return st.st_size;
+    }
+
+    void* posix_map(int fd, size_t length){
+        void* addr = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+        if(addr == MAP_FAILED) return nullptr;
+
+        //point lookup touches one page per level
+        //so disable kernel readahead around faulted page by default
+        //(leaf scan prefetches next leaf explicitly)
+        madvise(addr, length, MADV_RANDOM);
+        return addr;
+    }
+
+    int posix_unmap(void* addr, size_t length){
+        return munmap(addr, length);
+    }
+
+    int posix_remove_file(const char* pathname){
+        return unlink(pathname);
+    }
+
+    //in-memory files by path and by open handle
+    std::unordered_map<std::string, memory_file_t*> memory_files;
+    std::unordered_map<int, memory_file_t*> memory_handles;
+    //protect both maps (file content is protected by each file's latch)
+    pthread_rwlock_t memory_backend_latch = PTHREAD_RWLOCK_INITIALIZER;
+
+    memory_file_t* find_memory_file(int fd){
+        pthread_rwlock_rdlock(&SB::memory_backend_latch);
+        auto it = SB::memory_handles.find(fd);
+        memory_file_t* ret = it == SB::memory_handles.end() ? nullptr : it->second;
+        pthread_rwlock_unlock(&SB::memory_backend_latch);
+        if(!ret) errno = EBADF;
+        return ret;
+    }
+
+    int resize_memory_file(memory_file_t* file, size_t size){
+        if(size > file->capacity){
+            //grow mapping twice at least
+            size_t sys_page = sysconf(_SC_PAGESIZE);
+            size_t capacity = std::max(size, file->capacity * 2);
+            capacity = (capacity + sys_page - 1) / sys_page * sys_page;
+            void* addr = file->data
+                ? mremap(file->data, file->capacity, capacity, MREMAP_MAYMOVE)
+                : mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if(addr == MAP_FAILED){
+                errno = ENOSPC;
+                return -1;
+            }
+            //anonymous memory is zero-filled
+            file->data = reinterpret_cast<uint8_t*>(addr);
+            file->capacity = capacity;
+        }
+        else if(size < file->size){
+            //clear cut area so that it reads zero when file grows again
+            //(whole system pages are returned to kernel)
+            size_t sys_page = sysconf(_SC_PAGESIZE);
+            size_t page_begin = std::min((size + sys_page - 1) / sys_page * sys_page, file->size);
+            memset(file->data + size, 0, page_begin - size);
+            if(page_begin < file->size) madvise(file->data + page_begin, file->size - page_begin, MADV_DONTNEED);
+        }
+        file->size = size;
+        return 0;
+    }
+
+    char* memory_get_path(const char* pathname){
+        pthread_rwlock_rdlock(&SB::memory_backend_latch);
+        char* ret = SB::memory_files.count(pathname) ? strdup(pathname) : nullptr;
+        pthread_rwlock_unlock(&SB::memory_backend_latch);
+        return ret;
+    }
+
+    int memory_open_file(const char* pathname, int flags, mode_t mode){
+        pthread_rwlock_wrlock(&SB::memory_backend_latch);
+        auto it = SB::memory_files.find(pathname);
+        memory_file_t* file;
+        if(it != SB::memory_files.end()) file = it->second;
+        else if(flags & O_CREAT) file = SB::memory_files[pathname] = new memory_file_t();
+        else{
+            pthread_rwlock_unlock(&SB::memory_backend_latch);
+            errno = ENOENT;
+            return -1;
+        }
+
+        //reserve descriptor number so that handle never collides with real file
+        int fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if(fd != -1){
+            SB::memory_handles[fd] = file;
+            file->open_count++;
+        }
+        pthread_rwlock_unlock(&SB::memory_backend_latch);
+        return fd;
+    }
+
+    int memory_close_file(int fd){
+        pthread_rwlock_wrlock(&SB::memory_backend_latch);
+        auto it = SB::memory_handles.find(fd);
+        if(it == SB::memory_handles.end()){
+            pthread_rwlock_unlock(&SB::memory_backend_latch);
+            errno = EBADF;
+            return -1;
+        }
+        memory_file_t* file = it->second;
+        SB::memory_handles.erase(it);
+        if(!--file->open_count && !file->is_linked){
+            //removed file is freed on last close
+            if(file->data) munmap(file->data, file->capacity);
+            delete file;
+        }
+        pthread_rwlock_unlock(&SB::memory_backend_latch);
+        return close(fd);
+    }
+
+    ssize_t memory_read(int fd, void* buf, size_t count, uint64_t offset){
+        memory_file_t* file = SB::find_memory_file(fd);
+        if(!file) return -1;
+
+        pthread_rwlock_rdlock(&file->latch);
+        //short read at end of file
+        size_t len = offset < file->size ? std::min<size_t>(count, file->size - offset) : 0;
+        memcpy(buf, file->data + offset, len);
+        pthread_rwlock_unlock(&file->latch);
+        return len;
+    }
+
+    ssize_t memory_write(int fd, const void* buf, size_t count, uint64_t offset){
+        memory_file_t* file = SB::find_memory_file(fd);
+        if(!file) return -1;
+
+        pthread_rwlock_rdlock(&file->latch);
+        if(offset + count > file->size){
+            //write beyond end of file grows file
+            pthread_rwlock_unlock(&file->latch);
+            pthread_rwlock_wrlock(&file->latch);
+            if(offset + count > file->size && SB::resize_memory_file(file, offset + count)){
+                pthread_rwlock_unlock(&file->latch);
+                return -1;
+            }
+        }
+        memcpy(file->data + offset, buf, count);
+        pthread_rwlock_unlock(&file->latch);
+        return count;
+    }
+
+    ssize_t memory_readv(int fd, const struct iovec* iov, int iovcnt, uint64_t offset){
+        ssize_t total = 0;
+        for(int i = 0; i < iovcnt; i++){
+            ssize_t ret = SB::memory_read(fd, iov[i].iov_base, iov[i].iov_len, offset + total);
+            if(ret == -1) return -1;
+            total += ret;
+            if((size_t)ret < iov[i].iov_len) break; //end of file
+        }
+        return total;
+    }
+
+    ssize_t memory_writev(int fd, const struct iovec* iov, int iovcnt, uint64_t offset){
+        ssize_t total = 0;
+        for(int i = 0; i < iovcnt; i++){
+            if(SB::memory_write(fd, iov[i].iov_base, iov[i].iov_len, offset + total) == -1) return -1;
+            total += iov[i].iov_len;
+        }
+        return total;
+    }
+
+    int memory_sync(int fd){
+        return SB::find_memory_file(fd) ? 0 : -1;
+    }
+
+    int memory_truncate(int fd, uint64_t length){
+        memory_file_t* file = SB::find_memory_file(fd);
+        if(!file) return -1;
+
+        pthread_rwlock_wrlock(&file->latch);
+        int ret = SB::resize_memory_file(file, length);
+        pthread_rwlock_unlock(&file->latch);
+        return ret;
+    }
+
+    int64_t memory_get_size(int fd){
+        memory_file_t* file = SB::find_memory_file(fd);
+        if(!file) return -1;
+
+        pthread_rwlock_rdlock(&file->latch);
+        int64_t ret = file->size;
+        pthread_rwlock_unlock(&file->latch);
+        return ret;
+    }
+
+    void* memory_map(int fd, size_t length){
+        //file content is already in memory
+        //(valid until file is resized, so only for read-only use)
+        memory_file_t* file = SB::find_memory_file(fd);
+        if(!file || length > file->size) return nullptr;
+        return file->data;
+    }
+
+    int memory_unmap(void* addr, size_t length){
+        return 0;
+    }
+
+    int memory_remove_file(const char* pathname){
+        pthread_rwlock_wrlock(&SB::memory_backend_latch);
+        auto it = SB::memory_files.find(pathname);
+        if(it == SB::memory_files.end()){
+            pthread_rwlock_unlock(&SB::memory_backend_latch);
+            errno = ENOENT;
+            return -1;
+        }
+        memory_file_t* file = it->second;
+        SB::memory_files.erase(it);
+        file->is_linked = false;
+        if(!file->open_count){
+            if(file->data) munmap(file->data, file->capacity);
+            delete file;
+        }
+        pthread_rwlock_unlock(&SB::memory_backend_latch);
+        return 0;
+    }
+
+    latency_state_t latency_state;
+
+    void inject_latency(const storage_latency_t& latency){
+        const storage_latency_config_t& config = SB::latency_state.config;
+        thread_local std::mt19937 gen(config.seed + SB::latency_state.number_of_streams++);
+        std::uniform_real_distribution<double> uni(0.0, 1.0);
+
+        uint64_t us = latency.base_us;
+        if(latency.jitter_us){
+            std::exponential_distribution<double> jitter(1.0 / latency.jitter_us);
+            us += (uint64_t)jitter(gen);
+        }
+        if(config.stall_probability > 0 && uni(gen) < config.stall_probability){
+            SB::latency_state.number_of_stalls++;
+            us += config.stall_us;
+        }
+        if(!us) return;
+
+        SB::latency_state.injected_us += us;
+        struct timespec ts = {(time_t)(us / 1000000), (long)(us % 1000000 * 1000)};
+        while(nanosleep(&ts, &ts) == -1 && errno == EINTR);
+    }
+
+    char* latency_get_path(const char* pathname){
+        return SB::latency_state.base->get_path(pathname);
+    }
+
+    int latency_open_file(const char* pathname, int flags, mode_t mode){
+        return SB::latency_state.base->open_file(pathname, flags, mode);
+    }
+
+    int latency_close_file(int fd){
+        return SB::latency_state.base->close_file(fd);
+    }
+
+    ssize_t latency_read(int fd, void* buf, size_t count, uint64_t offset){
+        SB::latency_state.number_of_reads++;
+        SB::inject_latency(SB::latency_state.config.read);
+        return SB::latency_state.base->read(fd, buf, count, offset);
+    }
+
+    ssize_t latency_write(int fd, const void* buf, size_t count, uint64_t offset){
+        SB::latency_state.number_of_writes++;
+        SB::inject_latency(SB::latency_state.config.write);
+        return SB::latency_state.base->write(fd, buf, count, offset);
+    }
+
+    ssize_t latency_readv(int fd, const struct iovec* iov, int iovcnt, uint64_t offset){
+        //one vectored I/O costs one device access
+        SB::latency_state.number_of_reads++;
+        SB::inject_latency(SB::latency_state.config.read);
+        return SB::latency_state.base->readv(fd, iov, iovcnt, offset);
+    }
+
+    ssize_t latency_writev(int fd, const struct iovec* iov, int iovcnt, uint64_t offset){
+        //one vectored I/O costs one device access
+        SB::latency_state.number_of_writes++;
+        SB::inject_latency(SB::latency_state.config.write);
+        return SB::latency_state.base->writev(fd, iov, iovcnt, offset);
+    }
+
+    int latency_sync(int fd){
+        SB::latency_state.number_of_writes++;
+        SB::inject_latency(SB::latency_state.config.write);
+        return SB::latency_state.base->sync(fd);
+    }
+
+    int latency_truncate(int fd, uint64_t length){
+        return SB::latency_state.base->truncate(fd, length);
+    }
+
+    int64_t latency_get_size(int fd){
+        return SB::latency_state.base->get_size(fd);
+    }
+
+    void* latency_map(int fd, size_t length){
+        return SB::latency_state.base->map(fd, length);
+    }
+
+    int latency_unmap(void* addr, size_t length){
+        return SB::latency_state.base->unmap(addr, length);
+    }
+
+    int latency_remove_file(const char* pathname){
+        return SB::latency_state.base->remove_file(pathname);
+    }
+
+    const storage_backend_t posix_backend = {
+        "posix",
+        SB::posix_get_path, SB::posix_open_file, SB::posix_close_file,
+        SB::posix_read, SB::posix_write, SB::posix_readv, SB::posix_writev,
+        SB::posix_sync, SB::posix_truncate, SB::posix_get_size,
+        SB::posix_map, SB::posix_unmap, SB::posix_remove_file,
+    };
+
+    const storage_backend_t memory_backend = {
+        "memory",
+        SB::memory_get_path, SB::memory_open_file, SB::memory_close_file,
+        SB::memory_read, SB::memory_write, SB::memory_readv, SB::memory_writev,
+        SB::memory_sync, SB::memory_truncate, SB::memory_get_size,
+        SB::memory_map, SB::memory_unmap, SB::memory_remove_file,
+    };
+
+    const storage_backend_t latency_backend = {
+        "latency",
+        SB::latency_get_path, SB::latency_open_file, SB::latency_close_file,
+        SB::latency_read, SB::latency_write, SB::latency_readv, SB::latency_writev,
+        SB::latency_sync, SB::latency_truncate, SB::latency_get_size,
+        SB::latency_map, SB::latency_unmap, SB::latency_remove_file,
+    };
+}
+
+const storage_backend_t* storage_get_posix_backend(){
+    return &SB::posix_backend;
+}
+
+const storage_backend_t* storage_get_memory_backend(){
+    return &SB::memory_backend;
+}
+
+const storage_backend_t* storage_get_latency_backend(const storage_backend_t* base, const storage_latency_config_t* config){
+    SB::latency_state.base = base ? base : storage_get_posix_backend();
+    SB::latency_state.config = *config;
+    SB::latency_state.number_of_reads = 0;
+    SB::latency_state.number_of_writes = 0;
+    SB::latency_state.number_of_stalls = 0;
+    SB::latency_state.injected_us = 0;
+    return &SB::latency_backend;
+}
+
+void storage_get_latency_stats(storage_latency_stats_t* stats){
+    stats->number_of_reads = SB::latency_state.number_of_reads;
+    stats->number_of_writes = SB::latency_state.number_of_writes;
+    stats->number_of_stalls = SB::latency_state.number_of_stalls;
+    stats->injected_us = SB::latency_state.injected_us;
+}
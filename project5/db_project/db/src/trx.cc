@@ -175,7 +175,7 @@ namespace TM{
         auto& v = TM::trx_table[trx_id].trx_log;
         for(auto log : v){
             //release implicit lock
-            idx_set_trx_id_in_slot(log->table_id, log->page_id,log->slot_number, 0);
+            idx_set_trx_id_in_slot(log->table_id, log->page_id,log->slot_number, log->key, 0);
         }
     }
 
@@ -186,8 +186,9 @@ namespace TM{
         //rollback in reverse order
         for(auto it = v.rbegin(); it != v.rend() ; ++it){
             TM::trx_log_t *e = *it; //get trx_log object pointer
-            //rollback effect
-            idx_update_by_key(e->table_id, e->key, e->old_value, e->old_size, &(e->new_size));
+            //rollback effect in logged page
+            //(no tree latch under lock manager latch, page can't move while this trx locks it)
+            idx_restore_record_in_slot(e->table_id, e->page_id, e->slot_number, e->key, e->old_value, e->old_size);
         }
     }
 }
@@ -227,15 +228,20 @@ int trx_commit_txn(int trx_id){
     int status_code; //check pthread error
 
     //start critical section
-    status_code = lock_acquire_lock_manager_latch(); //get lock manager latch first (avoid deadlock)
+    //shared lock manager latch keeps deadlock detection and implicit lock conversion
+    //(which look into this trx) away until all locks of this trx are released
+    status_code = lock_acquire_shared_lock_manager_latch(); //get lock manager latch first (avoid deadlock)
     status_code |= pthread_mutex_lock(&TM::transaction_manager_latch);
     if(status_code) return 0; //error
 
+    lock_t* first_lock = nullptr;
+
     //check current trx is valid
     if(TM::is_trx_valid(trx_id)){
         //release phase
-        TM::release_all_locks_in_trx(trx_id);
+        //implicit locks first, explicit locks of the records still block other trx
         TM::release_all_implicit_lock(trx_id);
+        first_lock = TM::find_first_lock_in_trx_table(trx_id);
 
         //delete entry
         TM::remove_trx_log(trx_id);
@@ -246,8 +252,12 @@ int trx_commit_txn(int trx_id){
         trx_id = 0;
     }
 
-    //end critical section
+    //explicit locks are released partition by partition without trx manager latch
+    //(lock acquire takes trx manager latch under partition latch)
     status_code = pthread_mutex_unlock(&TM::transaction_manager_latch);
+    lock_release_all(first_lock);
+
+    //end critical section
     status_code |= lock_release_lock_manager_latch();
     if(status_code) return 0; //error
 
@@ -257,16 +267,18 @@ int trx_commit_txn(int trx_id){
 int trx_abort_txn(int trx_id){
     int status_code; //check pthread error
 
-    //start critical section
-    status_code = lock_acquire_lock_manager_latch(); //get lock manager latch first (avoid deadlock)
+    //start critical section (same latching as commit)
+    status_code = lock_acquire_shared_lock_manager_latch(); //get lock manager latch first (avoid deadlock)
     status_code |= pthread_mutex_lock(&TM::transaction_manager_latch);
     if(status_code) return 0; //error
 
+    lock_t* first_lock = nullptr;
+
     //check current trx is valid
     if(TM::is_trx_valid(trx_id)){
         TM::rollback_trx_log(trx_id); //rollback effects
-        TM::release_all_locks_in_trx(trx_id); //release all lock
         TM::release_all_implicit_lock(trx_id);
+        first_lock = TM::find_first_lock_in_trx_table(trx_id);
 
         //delete entry
         TM::remove_trx_log(trx_id);
@@ -277,8 +289,11 @@ int trx_abort_txn(int trx_id){
         trx_id = 0;
     }
 
-    //end critical section
+    //release all lock
     status_code = pthread_mutex_unlock(&TM::transaction_manager_latch);
+    lock_release_all(first_lock);
+
+    //end critical section
     status_code |= lock_release_lock_manager_latch();
     if(status_code) return 0; //error
     
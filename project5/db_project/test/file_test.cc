@@ -3,6 +3,10 @@
 #include "api.h"
 #include <vector>
 #include <algorithm>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <sys/resource.h>
 
 // When a file is newly created, a file of 10MiB is created and The number of pages
 // corresponding to 10MiB should be created. Check the "Number of pages" entry in the
@@ -253,4 +257,1494 @@ TEST(DiskSpaceManager, FileGrowTest){
     pg_list.clear();
     file_close_table_file();
     remove(path);
-}
\ No newline at end of file
+}
+
+// Open table file with direct I/O flag and check page I/O works
+// with both aligned and unaligned(stack) page buffers.
+TEST(DiskSpaceManager, DirectIO){
+    //init test
+    const char* path = "./DirectIO.db";
+    init_db();
+    int64_t tid = file_open_table_file(path, FILE_DIRECT_IO_FLAG);
+    int fd = DSM::get_file_descriptor(tid);
+
+    //check file is opened with O_DIRECT
+    EXPECT_TRUE(fcntl(fd,F_GETFL) & O_DIRECT);
+
+    pagenum_t pg = file_alloc_page(tid);
+    EXPECT_GT(pg,0);
+
+    //unaligned page(from stack) and aligned page
+    page_t sample, target;
+    page_t* aligned;
+    ASSERT_EQ(posix_memalign(reinterpret_cast<void**>(&aligned), PAGE_SIZE, sizeof(page_t)), 0);
+    memset(&sample,'D',PAGE_SIZE);
+
+    //write unaligned page and read it again in both way
+    file_write_page(tid,pg,&sample);
+    file_read_page(tid,pg,&target);
+    file_read_page(tid,pg,aligned);
+    EXPECT_EQ(memcmp(&sample,&target,PAGE_SIZE),0);
+    EXPECT_EQ(memcmp(&sample,aligned,PAGE_SIZE),0);
+
+    //end test
+    free(aligned);
+    file_close_table_file();
+    remove(path);
+}
+
+// Open table files in each durability mode and check only the default mode uses O_SYNC.
+// After a checkpoint(db_flush_all), buffered changes should be in the file.
+TEST(DiskSpaceManager, DurabilityMode){
+    //init test
+    const char* paths[] = {"./SyncMode.db", "./PeriodicMode.db", "./CheckpointMode.db"};
+    int flags[] = {FILE_DEFAULT_FLAG, FILE_PERIODIC_SYNC_FLAG, FILE_CHECKPOINT_SYNC_FLAG};
+    init_db();
+    file_set_sync_interval(10);
+
+    int64_t tids[3];
+    for(int i=0;i<3;i++){
+        tids[i] = open_table(const_cast<char*>(paths[i]), flags[i]);
+        ASSERT_GE(tids[i],0);
+        int fd = DSM::get_file_descriptor(tids[i]);
+        EXPECT_EQ((fcntl(fd,F_GETFL) & O_SYNC) == O_SYNC, i == 0);
+    }
+
+    //insert one record in checkpoint mode table and take checkpoint
+    char value[] = "durable value durable value durable value durable";
+    ASSERT_EQ(db_insert(tids[2], 7, value, sizeof(value)), 0);
+    ASSERT_EQ(db_flush_all(), 0);
+
+    //read header page directly from file and check root page is written
+    int fd = DSM::get_file_descriptor(tids[2]);
+    FIM::_fim_page_t header_page;
+    ASSERT_EQ(pread64(fd,&header_page,PAGE_SIZE,0),PAGE_SIZE);
+    EXPECT_NE(header_page._header_page.root_page_number,0);
+
+    //end test
+    shutdown_db();
+    file_set_sync_interval(DEFAULT_SYNC_INTERVAL_MS);
+    for(const char* path : paths) remove(path);
+}
+
+// Read-only mmap table should answer lookups and scans from memory mapping
+// and reject every write
+TEST(DiskSpaceManager, ReadOnlyMmap){
+    //init test
+    const char* path = "./ReadOnlyMmap.db";
+    const int num_keys = 3000;
+    char value[] = "read only value read only value read only value!";
+    init_db();
+    int64_t tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid,0);
+    for(int i=0;i<num_keys;i++){
+        ASSERT_EQ(db_insert(tid, i, value, sizeof(value)), 0);
+    }
+    shutdown_db();
+
+    //missing file can't be opened as read-only
+    init_db();
+    EXPECT_LT(open_table(const_cast<char*>("./NoSuchReadOnly.db"), FILE_READ_ONLY_MMAP_FLAG),0);
+
+    tid = open_table(const_cast<char*>(path), FILE_READ_ONLY_MMAP_FLAG);
+    ASSERT_GE(tid,0);
+    ASSERT_NE(file_get_mapped_page(tid,0),nullptr);
+
+    //point lookup
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    for(int i=0;i<num_keys;i++){
+        ASSERT_EQ(db_find(tid, i, ret_val, &val_size), 0);
+        ASSERT_EQ(val_size, sizeof(value));
+        ASSERT_EQ(memcmp(ret_val, value, val_size), 0);
+    }
+    EXPECT_NE(db_find(tid, num_keys, ret_val, &val_size), 0);
+
+    //range scan
+    std::vector<int64_t> keys;
+    auto collect = [](int64_t key, const char* value, uint16_t val_size, void* arg){
+        reinterpret_cast<std::vector<int64_t>*>(arg)->push_back(key);
+    };
+    EXPECT_EQ(db_scan(tid, 100, 2099, collect, &keys), 2000);
+    ASSERT_EQ(keys.size(), 2000);
+    for(int i=0;i<2000;i++) EXPECT_EQ(keys[i], 100+i);
+
+    //every write fails
+    EXPECT_NE(db_insert(tid, num_keys, value, sizeof(value)), 0);
+    EXPECT_NE(db_delete(tid, 0), 0);
+    EXPECT_THROW(file_alloc_page(tid), const char*);
+
+    //end test
+    shutdown_db();
+    remove(path);
+}
+
+// Vectored read of contiguous pages should be same as reading them one by one
+// and readahead in buffer should not change what scan and lookup read
+TEST(DiskSpaceManager, Readahead){
+    //init test
+    const char* path = "./Readahead.db";
+    const int num_keys = 5000;
+    char value[] = "readahead value readahead value readahead value!";
+    init_db(64);
+    int64_t tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid,0);
+    for(int i=0;i<num_keys;i++){
+        ASSERT_EQ(db_insert(tid, i, value, sizeof(value)), 0);
+    }
+    ASSERT_EQ(db_flush_all(), 0);
+
+    //compare vectored read with single page read
+    const int count = 16;
+    page_t* pages;
+    ASSERT_EQ(posix_memalign(reinterpret_cast<void**>(&pages), PAGE_SIZE, count * sizeof(page_t)), 0);
+    page_t* dests[count];
+    for(int i=0;i<count;i++) dests[i] = pages + i;
+    file_read_pages(tid, 1, count, dests);
+    for(int i=0;i<count;i++){
+        page_t page;
+        file_read_page(tid, i+1, &page);
+        EXPECT_EQ(memcmp(&page, dests[i], sizeof(page_t)), 0);
+    }
+    free(pages);
+    EXPECT_THROW(file_read_pages(tid, file_get_number_of_pages(tid) - 1, 2, dests), const char*);
+    shutdown_db();
+
+    //scan and lookup with small buffer (every leaf is a miss)
+    init_db(64);
+    tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid,0);
+    buffer_prefetch_pages(tid, 1, 8);
+
+    std::vector<int64_t> keys;
+    auto collect = [](int64_t key, const char* value, uint16_t val_size, void* arg){
+        reinterpret_cast<std::vector<int64_t>*>(arg)->push_back(key);
+    };
+    EXPECT_EQ(db_scan(tid, 0, num_keys - 1, collect, &keys), num_keys);
+    ASSERT_EQ(keys.size(), num_keys);
+    for(int i=0;i<num_keys;i++) EXPECT_EQ(keys[i], i);
+
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    for(int i=0;i<num_keys;i++){
+        ASSERT_EQ(db_find(tid, i, ret_val, &val_size), 0);
+        ASSERT_EQ(memcmp(ret_val, value, val_size), 0);
+    }
+
+    //end test
+    shutdown_db();
+    remove(path);
+}
+
+// Compaction should move live pages to the front of file in key order,
+// shrink the file and keep every record reachable
+TEST(DiskSpaceManager, Compaction){
+    //init test
+    const char* path = "./Compaction.db";
+    const int num_keys = 20000;
+    char value[] = "compaction value compaction value compaction val";
+    std::vector<int64_t> keys(num_keys);
+    for(int i=0;i<num_keys;i++) keys[i] = i;
+    std::mt19937 gen(2038);
+    std::shuffle(keys.begin(), keys.end(), gen);
+
+    init_db(256);
+    int64_t tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid,0);
+    for(int64_t key : keys){
+        ASSERT_EQ(db_insert(tid, key, value, sizeof(value)), 0);
+    }
+    //delete most of records to scatter free pages
+    std::vector<bool> is_deleted(num_keys, false);
+    for(int i=0;i<num_keys*9/10;i++){
+        ASSERT_EQ(db_delete(tid, keys[i]), 0);
+        is_deleted[keys[i]] = true;
+    }
+    uint64_t number_of_pages = file_get_number_of_pages(tid);
+
+    //run lookups concurrently with compaction
+    struct reader_arg_t{
+        int64_t tid;
+        std::vector<bool>* is_deleted;
+        volatile bool is_stopped;
+        int num_failed;
+    } reader_arg = {tid, &is_deleted, false, 0};
+    auto reader_func = [](void* arg) -> void*{
+        reader_arg_t* reader = reinterpret_cast<reader_arg_t*>(arg);
+        char ret_val[MAX_VALUE_SIZE];
+        uint16_t val_size;
+        for(int i=0; !reader->is_stopped; i=(i+1)%reader->is_deleted->size()){
+            if((*reader->is_deleted)[i]) continue;
+            if(db_find(reader->tid, i, ret_val, &val_size)) reader->num_failed++;
+        }
+        return nullptr;
+    };
+    pthread_t reader_thread;
+    ASSERT_EQ(pthread_create(&reader_thread, NULL, reader_func, &reader_arg), 0);
+
+    int64_t cut = db_compact_table(tid, 100000);
+    reader_arg.is_stopped = true;
+    pthread_join(reader_thread, NULL);
+    EXPECT_EQ(reader_arg.num_failed, 0);
+    ASSERT_GT(cut, 0);
+    EXPECT_EQ(file_get_number_of_pages(tid), number_of_pages - cut);
+    int fd = DSM::get_file_descriptor(tid);
+    EXPECT_EQ(lseek64(fd,0,SEEK_END), file_get_number_of_pages(tid) * PAGE_SIZE);
+
+    //leaf pages are contiguous in key order
+    FIM::_fim_page_t page;
+    pagenum_t leaf_page_number = FIM::find_leaf_page(tid, 0);
+    while(true){
+        buffer_read_page(tid, leaf_page_number, &page._raw_page, BUFFER_NO_LOCK_MODE);
+        pagenum_t right_page_number = page._leaf_page.right_sibling_page_number;
+        if(!right_page_number) break;
+        ASSERT_EQ(right_page_number, leaf_page_number + 1);
+        leaf_page_number = right_page_number;
+    }
+    //last page in file is used
+    EXPECT_EQ(leaf_page_number + 1, file_get_number_of_pages(tid));
+
+    //every record is reachable and file still grows
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    for(int i=0;i<num_keys;i++){
+        EXPECT_EQ(db_find(tid, i, ret_val, &val_size) == 0, !is_deleted[i]);
+    }
+    for(int i=0;i<num_keys;i++){
+        if(is_deleted[i]) ASSERT_EQ(db_insert(tid, i, value, sizeof(value)), 0);
+    }
+    shutdown_db();
+
+    //check after reopen
+    init_db(256);
+    tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid,0);
+    std::vector<int64_t> scanned;
+    auto collect = [](int64_t key, const char* value, uint16_t val_size, void* arg){
+        reinterpret_cast<std::vector<int64_t>*>(arg)->push_back(key);
+    };
+    EXPECT_EQ(db_scan(tid, 0, num_keys - 1, collect, &scanned), num_keys);
+    for(int i=0;i<(int)scanned.size();i++) ASSERT_EQ(scanned[i], i);
+
+    //end test
+    shutdown_db();
+    remove(path);
+}
+
+// LZ codec should restore any input and shrink repetitive input
+TEST(DiskSpaceManager, LZCodec){
+    std::mt19937 gen(2038);
+    std::vector<uint8_t> src(PAGE_SIZE), dst(PAGE_SIZE * 2), restored(PAGE_SIZE);
+
+    for(int kind=0;kind<3;kind++){
+        for(int i=0;i<PAGE_SIZE;i++){
+            if(kind == 0) src[i] = 0; //zero page
+            else if(kind == 1) src[i] = 'A' + (i / 7 + gen() % 2) % 26; //text like
+            else src[i] = gen(); //random
+        }
+        int len = lz_compress(src.data(), PAGE_SIZE, dst.data(), dst.size());
+        ASSERT_GT(len, 0);
+        if(kind == 0) EXPECT_LT(len, PAGE_SIZE / 64);
+        EXPECT_EQ(lz_decompress(dst.data(), len, restored.data(), PAGE_SIZE), PAGE_SIZE);
+        EXPECT_EQ(memcmp(src.data(), restored.data(), PAGE_SIZE), 0);
+
+        //too small output
+        EXPECT_EQ(lz_compress(src.data(), PAGE_SIZE, dst.data(), 8), 0);
+        //broken input
+        EXPECT_LT(lz_decompress(dst.data(), len, restored.data(), PAGE_SIZE / 2), 0);
+    }
+}
+
+// Compressed table should keep records across reopen
+// and write less bytes than raw page file
+TEST(DiskSpaceManager, Compression){
+    //init test
+    const char* path = "./Compression.db";
+    const int num_keys = 5000;
+    char value[] = "compressible value compressible value compressible value";
+    init_db(64);
+    int64_t tid = open_table(const_cast<char*>(path), FILE_COMPRESSION_FLAG | FILE_CHECKPOINT_SYNC_FLAG);
+    ASSERT_GE(tid,0);
+    file_compression_stats_t stats;
+    ASSERT_EQ(file_get_compression_stats(tid, &stats), 0);
+    //new file has all free pages in small slots
+    EXPECT_LT(stats.file_bytes, DEFAULT_PAGE_NUMBER * PAGE_SIZE / 4);
+
+    for(int i=0;i<num_keys;i++){
+        ASSERT_EQ(db_insert(tid, i, value, sizeof(value)), 0);
+    }
+    for(int i=0;i<num_keys;i+=2){
+        ASSERT_EQ(db_delete(tid, i), 0);
+    }
+    ASSERT_EQ(db_flush_all(), 0);
+    ASSERT_EQ(file_get_compression_stats(tid, &stats), 0);
+    EXPECT_GT(stats.logical_write_bytes, 0);
+    EXPECT_LT(stats.physical_write_bytes, stats.logical_write_bytes / 2);
+    EXPECT_GT(stats.physical_read_bytes, 0);
+    shutdown_db();
+
+    //reopen (direct I/O is not used for compressed table)
+    init_db(64);
+    tid = open_table(const_cast<char*>(path), FILE_DIRECT_IO_FLAG);
+    ASSERT_GE(tid,0);
+    EXPECT_EQ(fcntl(DSM::get_file_descriptor(tid),F_GETFL) & O_DIRECT, 0);
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    for(int i=0;i<num_keys;i++){
+        ASSERT_EQ(db_find(tid, i, ret_val, &val_size) == 0, i % 2 == 1);
+        if(i % 2) ASSERT_EQ(memcmp(ret_val, value, val_size), 0);
+    }
+
+    //compaction works on logical pages
+    EXPECT_GT(db_compact_table(tid), 0);
+    for(int i=1;i<num_keys;i+=2){
+        ASSERT_EQ(db_find(tid, i, ret_val, &val_size), 0);
+    }
+    shutdown_db();
+
+    //free slots at the end are cut off when file is truncated
+    //(slots of new file are in page order)
+    const char* trunc_path = "./CompressionTruncate.db";
+    init_db(64);
+    tid = open_table(const_cast<char*>(trunc_path), FILE_COMPRESSION_FLAG | FILE_CHECKPOINT_SYNC_FLAG);
+    ASSERT_GE(tid,0);
+    ASSERT_EQ(file_get_compression_stats(tid, &stats), 0);
+    file_truncate_table_file(tid, 10);
+    EXPECT_EQ(file_get_number_of_pages(tid), 10);
+    file_compression_stats_t truncated;
+    ASSERT_EQ(file_get_compression_stats(tid, &truncated), 0);
+    EXPECT_LT(truncated.file_bytes, stats.file_bytes / 2);
+    EXPECT_EQ((uint64_t)lseek64(DSM::get_file_descriptor(tid),0,SEEK_END), truncated.file_bytes);
+    for(int i=0;i<100;i++){
+        ASSERT_EQ(db_insert(tid, i, value, sizeof(value)), 0);
+    }
+    shutdown_db();
+    init_db(64);
+    tid = open_table(const_cast<char*>(trunc_path), FILE_COMPRESSION_FLAG);
+    ASSERT_GE(tid,0);
+    for(int i=0;i<100;i++){
+        ASSERT_EQ(db_find(tid, i, ret_val, &val_size), 0);
+    }
+    shutdown_db();
+    remove(trunc_path);
+
+    //raw page file is not compressed by flag
+    const char* raw_path = "./CompressionRaw.db";
+    init_db();
+    tid = open_table(const_cast<char*>(raw_path));
+    shutdown_db();
+    init_db();
+    tid = open_table(const_cast<char*>(raw_path), FILE_COMPRESSION_FLAG);
+    EXPECT_EQ(file_get_compression_stats(tid, &stats), -1);
+
+    //end test
+    shutdown_db();
+    remove(path);
+    remove(raw_path);
+}
+
+// Old slot of compressed page is reused only after newer image is synced,
+// and slot with bad checksum is skipped on open without losing later slots
+TEST(DiskSpaceManager, CompressedSlotChecksum){
+    //init test
+    const char* path = "./CompressedSlotChecksum.db";
+    const pagenum_t pagenum = 5;
+    remove(path);
+    init_db();
+    int64_t tid = open_table(const_cast<char*>(path), FILE_COMPRESSION_FLAG | FILE_CHECKPOINT_SYNC_FLAG);
+    ASSERT_GE(tid, 0);
+
+    //random page is stored raw (largest slot)
+    std::mt19937 gen(7);
+    page_t page, ret_page;
+    for(size_t i = 0; i < sizeof(page); i++) page.raw_data[i] = gen();
+    const uint64_t slot_bytes = (uint64_t)DSM::get_slot_sectors(PAGE_SIZE) * COMPRESSION_SECTOR_SIZE;
+
+    //without sync every rewrite appends
+    file_compression_stats_t stats;
+    ASSERT_EQ(file_get_compression_stats(tid, &stats), 0);
+    uint64_t file_bytes = stats.file_bytes;
+    for(int i = 0; i < 3; i++){
+        page.raw_data[0] = i;
+        file_write_page(tid, pagenum, &page);
+    }
+    ASSERT_EQ(file_get_compression_stats(tid, &stats), 0);
+    EXPECT_EQ(stats.file_bytes, file_bytes + 3 * slot_bytes);
+
+    //after sync old slots are reused
+    file_sync_table_files();
+    file_bytes = stats.file_bytes;
+    page.raw_data[0] = 3;
+    file_write_page(tid, pagenum, &page);
+    ASSERT_EQ(file_get_compression_stats(tid, &stats), 0);
+    EXPECT_EQ(stats.file_bytes, file_bytes);
+    shutdown_db();
+
+    //corrupt payload of an old image of the page in the middle of file
+    int fd = open(path, O_RDWR);
+    ASSERT_GE(fd, 0);
+    uint64_t offset = PAGE_SIZE, bad_offset = 0;
+    DSM::slot_header_t header;
+    while(pread(fd, &header, sizeof(header), offset) == sizeof(header) && header.magic == COMPRESSED_SLOT_MAGIC){
+        if(header.pagenum == pagenum && header.length == PAGE_SIZE && !bad_offset) bad_offset = offset;
+        offset += (uint64_t)header.sectors * COMPRESSION_SECTOR_SIZE;
+    }
+    ASSERT_EQ(offset, file_bytes);
+    ASSERT_NE(bad_offset, 0);
+    uint8_t byte;
+    ASSERT_EQ(pread(fd, &byte, 1, bad_offset + sizeof(header) + 100), 1);
+    byte ^= 0xff;
+    ASSERT_EQ(pwrite(fd, &byte, 1, bad_offset + sizeof(header) + 100), 1);
+    close(fd);
+
+    //reopen, scan goes on after bad slot
+    init_db();
+    tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+    ASSERT_EQ(file_get_compression_stats(tid, &stats), 0);
+    EXPECT_EQ(stats.number_of_bad_slots, 1);
+    EXPECT_EQ(stats.file_bytes, file_bytes);
+    file_read_page(tid, pagenum, &ret_page);
+    EXPECT_EQ(memcmp(&ret_page, &page, sizeof(page)), 0);
+
+    //end test
+    shutdown_db();
+    remove(path);
+}
+
+// Page layout follows build-time page size
+// leaf page holds MAX_SLOT_NUMBER smallest records and table file records its page size
+TEST(DiskSpaceManager, PageSize){
+    //init test
+    const char* path = "./PageSize.db";
+    remove(path);
+    init_db();
+    int64_t tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+
+    //fill root leaf page exactly
+    char value[MIN_VALUE_SIZE];
+    memset(value, 'P', sizeof(value));
+    for(int i=0;i<MAX_SLOT_NUMBER;i++){
+        ASSERT_EQ(db_insert(tid, i, value, sizeof(value)), 0);
+    }
+    FIM::_fim_page_t page;
+    buffer_read_page(tid, 0, &page._raw_page, BUFFER_NO_LOCK_MODE);
+    buffer_read_page(tid, page._header_page.root_page_number, &page._raw_page, BUFFER_NO_LOCK_MODE);
+    EXPECT_EQ(page._leaf_page.page_header.is_leaf, 1);
+    EXPECT_EQ(page._leaf_page.page_header.number_of_keys, MAX_SLOT_NUMBER);
+    EXPECT_LT(page._leaf_page.amount_of_free_space, SLOT_SIZE + MIN_VALUE_SIZE);
+
+    //record in last slot can be locked
+    int trx_id = trx_begin();
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    ASSERT_EQ(db_find(tid, MAX_SLOT_NUMBER - 1, ret_val, &val_size, trx_id), 0);
+    ASSERT_EQ(trx_commit(trx_id), trx_id);
+
+    //one more record splits leaf page
+    ASSERT_EQ(db_insert(tid, MAX_SLOT_NUMBER, value, sizeof(value)), 0);
+    buffer_read_page(tid, 0, &page._raw_page, BUFFER_NO_LOCK_MODE);
+    buffer_read_page(tid, page._header_page.root_page_number, &page._raw_page, BUFFER_NO_LOCK_MODE);
+    EXPECT_EQ(page._leaf_page.page_header.is_leaf, 0);
+    shutdown_db();
+
+    //header page records page size
+    int fd = open(path, O_RDWR);
+    ASSERT_NE(fd, -1);
+    DSM::_dsm_page_t header_page;
+    ASSERT_EQ(pread64(fd, &header_page, PAGE_SIZE, 0), PAGE_SIZE);
+    EXPECT_EQ(header_page._header_page.page_size, PAGE_SIZE);
+
+    //file made with other page size is rejected
+    header_page._header_page.page_size = PAGE_SIZE * 2;
+    ASSERT_EQ(pwrite64(fd, &header_page, PAGE_SIZE, 0), PAGE_SIZE);
+    close(fd);
+    init_db();
+    EXPECT_THROW(file_open_table_file(path), const char*);
+
+    //end test
+    shutdown_db();
+    remove(path);
+}
+
+// Many tables share one tablespace file
+// each table has its own tree and survives reopen
+TEST(DiskSpaceManager, Tablespace){
+    //init test
+    const char* path = "./Tablespace.db";
+    remove(path);
+    init_db();
+    int64_t space_id = open_table(const_cast<char*>(path));
+    ASSERT_GE(space_id, 0);
+    uint64_t number_of_pages = file_get_number_of_pages(space_id);
+
+    //create tables over two catalog pages
+    const int num_tables = CATALOG_ENTRY_NUMBER + 2;
+    std::vector<int64_t> tids(num_tables + 1);
+    tids[0] = space_id;
+    for(int i=1;i<=num_tables;i++){
+        tids[i] = db_create_table(space_id);
+        ASSERT_GE(tids[i], 0);
+        EXPECT_EQ(file_get_space_id(tids[i]), space_id);
+        EXPECT_EQ(file_get_table_number(tids[i]), (uint32_t)i);
+    }
+    EXPECT_EQ(file_get_number_of_pages(space_id), number_of_pages);
+
+    //same keys in every table with table specific value
+    const int checked[] = {0, 1, 2, CATALOG_ENTRY_NUMBER, num_tables};
+    const int num_keys = 300;
+    char value[MIN_VALUE_SIZE + 1];
+    for(int t : checked){
+        for(int k=0;k<num_keys;k++){
+            snprintf(value, sizeof(value), "%0*d", MIN_VALUE_SIZE, t * num_keys + k);
+            ASSERT_EQ(db_insert(tids[t], k, value, MIN_VALUE_SIZE), 0);
+        }
+    }
+    //delete half of one table
+    for(int k=0;k<num_keys;k+=2) ASSERT_EQ(db_delete(tids[1], k), 0);
+
+    //transaction works on table in catalog
+    int trx_id = trx_begin();
+    char new_value[MIN_VALUE_SIZE];
+    memset(new_value, 'T', sizeof(new_value));
+    uint16_t old_val_size;
+    ASSERT_EQ(db_update(tids[num_tables], 0, new_value, sizeof(new_value), &old_val_size, trx_id), 0);
+    ASSERT_EQ(trx_commit(trx_id), trx_id);
+
+    //compaction needs single tree
+    EXPECT_LT(db_compact_table(space_id), 0);
+    shutdown_db();
+
+    //reopen and check every table
+    init_db();
+    space_id = open_table(const_cast<char*>(path));
+    ASSERT_GE(space_id, 0);
+    EXPECT_LT(db_get_table(space_id, num_tables + 1), 0);
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    for(int t : checked){
+        int64_t tid = db_get_table(space_id, t);
+        ASSERT_GE(tid, 0);
+        for(int k=0;k<num_keys;k++){
+            if(t == 1 && k % 2 == 0){
+                EXPECT_NE(db_find(tid, k, ret_val, &val_size), 0);
+                continue;
+            }
+            ASSERT_EQ(db_find(tid, k, ret_val, &val_size), 0);
+            if(t == num_tables && k == 0){
+                EXPECT_EQ(memcmp(ret_val, new_value, sizeof(new_value)), 0);
+                continue;
+            }
+            snprintf(value, sizeof(value), "%0*d", MIN_VALUE_SIZE, t * num_keys + k);
+            EXPECT_EQ(memcmp(ret_val, value, MIN_VALUE_SIZE), 0);
+        }
+    }
+    //empty table has no record
+    EXPECT_NE(db_find(db_get_table(space_id, 3), 0, ret_val, &val_size), 0);
+
+    //end test
+    shutdown_db();
+    remove(path);
+}
+
+// Table file can live in memory backend
+// table survives close and reopen in same process and nothing is written to disk
+TEST(DiskSpaceManager, MemoryBackend){
+    //init test
+    const char* path = "./MemoryBackend.db";
+    const int num_keys = 3000;
+    remove(path);
+    file_set_storage_backend(storage_get_memory_backend());
+    init_db(16);
+    int64_t tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+    EXPECT_EQ(file_get_number_of_pages(tid), DEFAULT_PAGE_NUMBER);
+    char value[MIN_VALUE_SIZE];
+    memset(value, 'M', sizeof(value));
+    for(int i=0;i<num_keys;i++){
+        ASSERT_EQ(db_insert(tid, i, value, sizeof(value)), 0);
+    }
+    shutdown_db();
+    EXPECT_EQ(access(path, F_OK), -1);
+
+    //reopen from memory (and read-only mapping points memory directly)
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    for(int flag : {FILE_DEFAULT_FLAG, FILE_READ_ONLY_MMAP_FLAG}){
+        init_db(16);
+        tid = open_table(const_cast<char*>(path), flag);
+        ASSERT_GE(tid, 0);
+        for(int i=0;i<num_keys;i++){
+            ASSERT_EQ(db_find(tid, i, ret_val, &val_size), 0);
+            ASSERT_EQ(memcmp(ret_val, value, val_size), 0);
+        }
+        shutdown_db();
+    }
+
+    //compressed table and compaction work on memory file
+    const char* compressed_path = "./MemoryBackendCompressed.db";
+    init_db(16);
+    tid = open_table(const_cast<char*>(compressed_path), FILE_COMPRESSION_FLAG);
+    ASSERT_GE(tid, 0);
+    for(int i=0;i<num_keys;i++){
+        ASSERT_EQ(db_insert(tid, i, value, sizeof(value)), 0);
+    }
+    for(int i=0;i<num_keys;i+=2){
+        ASSERT_EQ(db_delete(tid, i), 0);
+    }
+    EXPECT_GT(db_compact_table(tid), 0);
+    shutdown_db();
+    init_db(16);
+    tid = open_table(const_cast<char*>(compressed_path));
+    ASSERT_GE(tid, 0);
+    for(int i=0;i<num_keys;i++){
+        ASSERT_EQ(db_find(tid, i, ret_val, &val_size) == 0, i % 2 == 1);
+    }
+    shutdown_db();
+
+    //removed file is gone
+    EXPECT_EQ(file_remove_table_file(path), 0);
+    EXPECT_EQ(file_remove_table_file(compressed_path), 0);
+    EXPECT_EQ(file_remove_table_file(path), -1);
+    init_db();
+    EXPECT_THROW(file_open_table_file(path, FILE_READ_ONLY_MMAP_FLAG), const char*);
+
+    //end test
+    shutdown_db();
+    file_set_storage_backend(nullptr);
+    EXPECT_EQ(access(path, F_OK), -1);
+}
+
+// Latency backend delays reads and writes of base backend
+TEST(DiskSpaceManager, LatencyBackend){
+    //init test
+    const char* path = "./LatencyBackend.db";
+    storage_latency_config_t config = {{100, 0}, {200, 0}, 1.0, 50, 1};
+    file_set_storage_backend(storage_get_latency_backend(storage_get_memory_backend(), &config));
+    auto begin = std::chrono::steady_clock::now();
+    init_db(4);
+    int64_t tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+    char value[MIN_VALUE_SIZE];
+    memset(value, 'L', sizeof(value));
+    for(int i=0;i<500;i++){
+        ASSERT_EQ(db_insert(tid, i, value, sizeof(value)), 0);
+    }
+    shutdown_db();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+
+    //every read and write waited its latency and a stall
+    storage_latency_stats_t stats;
+    storage_get_latency_stats(&stats);
+    EXPECT_GT(stats.number_of_reads, 0);
+    EXPECT_GT(stats.number_of_writes, 0);
+    EXPECT_EQ(stats.number_of_stalls, stats.number_of_reads + stats.number_of_writes);
+    EXPECT_EQ(stats.injected_us, stats.number_of_reads * 150 + stats.number_of_writes * 250);
+    EXPECT_GE((uint64_t)elapsed, stats.injected_us);
+
+    //data reached base backend
+    file_set_storage_backend(storage_get_memory_backend());
+    init_db();
+    tid = open_table(const_cast<char*>(path));
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    for(int i=0;i<500;i++){
+        ASSERT_EQ(db_find(tid, i, ret_val, &val_size), 0);
+    }
+
+    //end test
+    shutdown_db();
+    file_remove_table_file(path);
+    file_set_storage_backend(nullptr);
+}
+
+// I/O statistics count file and buffer activity per table file
+// and periodic dump writes snapshots to file
+TEST(DiskSpaceManager, Stats){
+    //init test
+    const char* path = "./Stats.db";
+    const char* dump_path = "./Stats.log";
+    remove(path);
+    remove(dump_path);
+    db_stats_t before, after;
+    ASSERT_EQ(db_get_stats(&before), 0);
+    init_db(8);
+    ASSERT_EQ(db_set_stats_dump(dump_path, 20), 0);
+    int64_t tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+
+    //new table has clean counters
+    io_stats_t stats;
+    ASSERT_EQ(db_get_table_stats(tid, &stats), 0);
+    EXPECT_EQ(stats.reads + stats.writes + stats.allocs + stats.buffer_hits + stats.buffer_misses, 0);
+
+    //small buffer makes evictions and write-back
+    char value[MIN_VALUE_SIZE];
+    memset(value, 'S', sizeof(value));
+    for(int i=0;i<2000;i++){
+        ASSERT_EQ(db_insert(tid, i, value, sizeof(value)), 0);
+    }
+    ASSERT_EQ(db_flush_all(), 0);
+    ASSERT_EQ(db_get_table_stats(tid, &stats), 0);
+    EXPECT_GT(stats.allocs, 0);
+    EXPECT_GT(stats.buffer_hits, stats.buffer_misses);
+    EXPECT_GT(stats.buffer_misses, 0);
+    EXPECT_GT(stats.evictions, 0);
+    EXPECT_GT(stats.dirty_flushes, 0);
+    EXPECT_GE(stats.write_bytes, stats.dirty_flushes * PAGE_SIZE);
+    //readahead reads and checkpoint writes many pages in one request
+    EXPECT_GE(stats.read_bytes, stats.reads * PAGE_SIZE);
+    EXPECT_EQ(stats.read_bytes % PAGE_SIZE, 0);
+    EXPECT_GE(stats.write_bytes, stats.writes * PAGE_SIZE);
+    EXPECT_EQ(stats.write_bytes % PAGE_SIZE, 0);
+
+    //table in tablespace shares counters of its table file
+    int64_t sub_tid = db_create_table(tid);
+    ASSERT_GE(sub_tid, 0);
+    ASSERT_EQ(db_insert(sub_tid, 0, value, sizeof(value)), 0);
+    io_stats_t sub_stats;
+    ASSERT_EQ(db_get_table_stats(sub_tid, &sub_stats), 0);
+    EXPECT_GE(sub_stats.allocs, stats.allocs + 1);
+
+    //read and write back of a page is one buffer request
+    page_t header;
+    buffer_read_page(tid, 0, &header, BUFFER_WRITE_LOCK_MODE);
+    buffer_write_page(tid, 0, &header);
+    ASSERT_EQ(db_get_table_stats(tid, &stats), 0);
+    EXPECT_EQ(stats.buffer_hits + stats.buffer_misses, sub_stats.buffer_hits + sub_stats.buffer_misses + 1);
+
+    //every file I/O has a latency sample
+    //(header read on open is sampled before counters are cleared)
+    ASSERT_EQ(db_get_stats(&after), 0);
+    EXPECT_GE(after.total.reads, stats.reads);
+    EXPECT_GE(after.latency[STATS_FILE_READ].count - before.latency[STATS_FILE_READ].count,
+        after.total.reads - before.total.reads);
+    EXPECT_GT(after.latency[STATS_BUFFER_MISS].count, before.latency[STATS_BUFFER_MISS].count);
+    EXPECT_GT(stats_get_percentile(&after.latency[STATS_FILE_WRITE], 0.99), 0);
+
+    //table file without own counters is still counted in total
+    ST::add(STATS_MAX_TABLE_FILE + 1, ST::ALLOCS, 3);
+    EXPECT_NE(stats_get_table(STATS_MAX_TABLE_FILE + 1, &stats), 0);
+    db_stats_t overflow;
+    ASSERT_EQ(db_get_stats(&overflow), 0);
+    EXPECT_GE(overflow.total.allocs, after.total.allocs + 3);
+    usleep(50 * 1000);
+    shutdown_db();
+
+    //dump has snapshots with this table
+    FILE* fp = fopen(dump_path, "r");
+    ASSERT_NE(fp, nullptr);
+    char line[1024], table_name[32];
+    snprintf(table_name, sizeof(table_name), "table %ld ", tid);
+    int snapshots = 0, table_lines = 0;
+    while(fgets(line, sizeof(line), fp)){
+        snapshots += !strncmp(line, "# stats", 7);
+        table_lines += !strncmp(line, table_name, strlen(table_name));
+    }
+    fclose(fp);
+    EXPECT_GE(snapshots, 2);
+    EXPECT_GE(table_lines, 1);
+
+    //end test
+    remove(path);
+    remove(dump_path);
+}
+
+// Pages resident at shutdown are saved in warm-up file
+// and prefetched when their table is opened again
+TEST(DiskSpaceManager, BufferWarmUp){
+    //init test
+    const char* path = "./BufferWarmUp.db";
+    const char* warmup_path = "./BufferWarmUp.warmup";
+    const int num_keys = 20000;
+    const int num_buf = 64;
+    remove(path);
+    remove(warmup_path);
+    init_db(num_buf);
+    int64_t tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+    char value[MIN_VALUE_SIZE];
+    memset(value, 'W', sizeof(value));
+    for(int i=0;i<num_keys;i++){
+        ASSERT_EQ(db_insert(tid, i, value, sizeof(value)), 0);
+    }
+    shutdown_db();
+
+    //touch a small hot set
+    std::vector<int64_t> hot_keys;
+    for(int i=0;i<num_keys;i+=num_keys/16) hot_keys.push_back(i);
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    init_db(num_buf, warmup_path);
+    tid = open_table(const_cast<char*>(path));
+    for(int64_t key : hot_keys) ASSERT_EQ(db_find(tid, key, ret_val, &val_size), 0);
+    shutdown_db();
+
+    //warm-up file lists resident pages
+    FILE* fp = fopen(warmup_path, "r");
+    ASSERT_NE(fp, nullptr);
+    char line[PATH_MAX + 64];
+    int number_of_pages = 0;
+    ASSERT_NE(fgets(line, sizeof(line), fp), nullptr);
+    EXPECT_EQ(strncmp(line, WARMUP_FILE_HEADER, strlen(WARMUP_FILE_HEADER)), 0);
+    while(fgets(line, sizeof(line), fp)) number_of_pages += !strncmp(line, "page ", 5);
+    fclose(fp);
+    EXPECT_GT(number_of_pages, (int)hot_keys.size());
+    EXPECT_LE(number_of_pages, num_buf);
+
+    //reopen and wait for background warm-up
+    init_db(num_buf, warmup_path);
+    tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+    io_stats_t stats;
+    for(int i=0;i<200;i++){
+        db_get_table_stats(tid, &stats);
+        if(stats.read_bytes >= (uint64_t)number_of_pages * PAGE_SIZE) break;
+        usleep(10 * 1000);
+    }
+    EXPECT_EQ(stats.read_bytes, (uint64_t)number_of_pages * PAGE_SIZE);
+    //sorted pages are read with few vectored reads
+    EXPECT_LT(stats.reads, (uint64_t)number_of_pages);
+
+    //hot keys are served from buffer (header page is not warmed up)
+    for(int64_t key : hot_keys) ASSERT_EQ(db_find(tid, key, ret_val, &val_size), 0);
+    db_get_table_stats(tid, &stats);
+    EXPECT_LE(stats.buffer_misses, 1);
+
+    //end test
+    shutdown_db();
+    remove(path);
+    remove(warmup_path);
+}
+
+// Buffer pool can grow and shrink while other threads use it
+// growing keeps cached pages and shrinking writes back dirty pages
+TEST(DiskSpaceManager, BufferResize){
+    //init test
+    const char* path = "./BufferResize.db";
+    const int num_keys = 5000;
+    remove(path);
+    init_db(16);
+    int64_t tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+    EXPECT_EQ(buffer_get_size(), 16);
+    EXPECT_NE(db_resize_buffer(0), 0);
+
+    //resize while another thread inserts and finds
+    std::thread worker([&]{
+        char value[MIN_VALUE_SIZE];
+        memset(value, 'R', sizeof(value));
+        char ret_val[MAX_VALUE_SIZE];
+        uint16_t val_size;
+        for(int i=0;i<num_keys;i++){
+            ASSERT_EQ(db_insert(tid, i, value, sizeof(value)), 0);
+            ASSERT_EQ(db_find(tid, i / 2, ret_val, &val_size), 0);
+        }
+    });
+    for(int i=0;i<200;i++){
+        ASSERT_EQ(db_resize_buffer(i % 2 ? 4 : 256), 0);
+    }
+    worker.join();
+
+    //grown pool keeps every page after warm access
+    ASSERT_EQ(db_resize_buffer(1024), 0);
+    EXPECT_EQ(buffer_get_size(), 1024);
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    for(int i=0;i<num_keys;i++) ASSERT_EQ(db_find(tid, i, ret_val, &val_size), 0);
+    io_stats_t before, after;
+    db_get_table_stats(tid, &before);
+    ASSERT_EQ(db_resize_buffer(2048), 0);
+    for(int i=0;i<num_keys;i++) ASSERT_EQ(db_find(tid, i, ret_val, &val_size), 0);
+    db_get_table_stats(tid, &after);
+    EXPECT_EQ(after.buffer_misses, before.buffer_misses);
+
+    //shrink to one frame writes back dirty pages
+    char value[MIN_VALUE_SIZE];
+    memset(value, 'S', sizeof(value));
+    uint16_t old_val_size;
+    int trx_id = trx_begin();
+    for(int i=0;i<num_keys;i+=7) ASSERT_EQ(db_update(tid, i, value, sizeof(value), &old_val_size, trx_id), 0);
+    ASSERT_EQ(trx_commit(trx_id), trx_id);
+    ASSERT_EQ(db_resize_buffer(1), 0);
+    db_get_table_stats(tid, &after);
+    EXPECT_GT(after.dirty_flushes, before.dirty_flushes);
+    ASSERT_EQ(db_resize_buffer(8), 0);
+    shutdown_db();
+
+    //reopen and check data
+    init_db(8);
+    tid = open_table(const_cast<char*>(path));
+    for(int i=0;i<num_keys;i++){
+        ASSERT_EQ(db_find(tid, i, ret_val, &val_size), 0);
+        EXPECT_EQ(ret_val[0], i % 7 ? 'R' : 'S');
+    }
+    shutdown_db();
+
+    //pool of init size only if address space is limited
+    long vm_pages = 0;
+    FILE* fp = fopen("/proc/self/statm", "r");
+    ASSERT_NE(fp, nullptr);
+    ASSERT_EQ(fscanf(fp, "%ld", &vm_pages), 1);
+    fclose(fp);
+    struct rlimit old_limit, limit;
+    ASSERT_EQ(getrlimit(RLIMIT_AS, &old_limit), 0);
+    limit = old_limit;
+    limit.rlim_cur = vm_pages * sysconf(_SC_PAGESIZE) + (2ULL << 30);
+    ASSERT_EQ(setrlimit(RLIMIT_AS, &limit), 0);
+    int status_code = init_db(8);
+    if(!status_code){
+        EXPECT_NE(db_resize_buffer(16), 0);
+        EXPECT_EQ(db_resize_buffer(4), 0);
+        tid = open_table(const_cast<char*>(path));
+        for(int i=0;i<num_keys;i+=97) EXPECT_EQ(db_find(tid, i, ret_val, &val_size), 0);
+        shutdown_db();
+    }
+    ASSERT_EQ(setrlimit(RLIMIT_AS, &old_limit), 0);
+    EXPECT_EQ(status_code, 0);
+
+    //end test
+    remove(path);
+}
+
+// Pinned frames are never evicted and the rest of the pool keeps serving misses
+TEST(DiskSpaceManager, BufferPin){
+    //init test
+    const char* path = "./BufferPin.db";
+    const int num_buf = 16;
+    const int num_keys = 3000;
+    remove(path);
+    init_db(num_buf);
+    int64_t tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+    char value[MIN_VALUE_SIZE];
+    memset(value, 'P', sizeof(value));
+    for(int i=0;i<num_keys;i++){
+        ASSERT_EQ(db_insert(tid, i, value, sizeof(value)), 0);
+    }
+    const pagenum_t number_of_pages = file_get_number_of_pages(tid);
+    ASSERT_GT(number_of_pages, (pagenum_t)num_buf + 1);
+
+    //every frame but one is pinned by two threads
+    std::vector<page_t*> frames(num_buf);
+    std::vector<std::thread> pinners;
+    for(int t=0;t<2;t++){
+        pinners.emplace_back([&, t]{
+            for(int p=1;p<num_buf;p++){
+                page_t* frame = buffer_direct_read_page(tid, p);
+                if(!t) frames[p] = frame;
+            }
+        });
+    }
+    for(auto& th : pinners) th.join();
+
+    //misses go through the only unpinned frame
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    for(int i=0;i<num_keys;i++){
+        ASSERT_EQ(db_find(tid, i, ret_val, &val_size), 0);
+    }
+    page_t page;
+    for(int p=1;p<num_buf;p++){
+        ASSERT_EQ(buffer_direct_read_page(tid, p), frames[p]);
+        buffer_direct_write_page(tid, p, false);
+        buffer_read_page(tid, p, &page, BUFFER_NO_LOCK_MODE);
+        EXPECT_EQ(memcmp(&page, frames[p], sizeof(page_t)), 0);
+    }
+
+    //no victim when every frame is pinned
+    buffer_direct_read_page(tid, num_buf);
+    EXPECT_THROW(buffer_read_page(tid, num_buf + 1, &page, BUFFER_NO_LOCK_MODE), const char*);
+
+    buffer_direct_write_page(tid, num_buf, false);
+    EXPECT_NO_THROW(buffer_read_page(tid, num_buf + 1, &page, BUFFER_NO_LOCK_MODE));
+
+    //frames come back after the last unpin
+    for(int t=0;t<2;t++){
+        for(int p=1;p<num_buf;p++){
+            buffer_direct_write_page(tid, p, false);
+        }
+    }
+    for(pagenum_t p=1;p<number_of_pages;p++){
+        buffer_read_page(tid, p, &page, BUFFER_NO_LOCK_MODE);
+    }
+    for(int p=1;p<=num_buf;p++){
+        buffer_direct_read_page(tid, p);
+    }
+    for(int p=1;p<=num_buf;p++){
+        buffer_direct_write_page(tid, p, false);
+    }
+    for(int i=0;i<num_keys;i++){
+        ASSERT_EQ(db_find(tid, i, ret_val, &val_size), 0);
+    }
+
+    //end test
+    shutdown_db();
+    remove(path);
+}
+
+// Large scan, bulk load and compaction recycle ring frames and keep working set resident
+TEST(DiskSpaceManager, BufferRing){
+    //init test
+    const char* hot_path = "./BufferRingHot.db";
+    const char* big_path = "./BufferRingBig.db";
+    const int num_hot_keys = 500;
+    const int num_big_keys = 20000;
+    remove(hot_path);
+    remove(big_path);
+    init_db(256);
+    int64_t hot_tid = open_table(const_cast<char*>(hot_path));
+    int64_t big_tid = open_table(const_cast<char*>(big_path));
+    ASSERT_GE(hot_tid, 0);
+    ASSERT_GE(big_tid, 0);
+    EXPECT_NE(db_begin_bulk(0), 0);
+
+    //bulk load doesn't need buffer larger than ring
+    char value[MIN_VALUE_SIZE];
+    memset(value, 'B', sizeof(value));
+    ASSERT_EQ(db_begin_bulk(), 0);
+    EXPECT_EQ(buffer_get_ring_size(), DEFAULT_RING_FRAMES);
+    for(int i=0;i<num_big_keys;i++){
+        ASSERT_EQ(db_insert(big_tid, i, value, sizeof(value)), 0);
+    }
+    ASSERT_EQ(db_end_bulk(), 0);
+    EXPECT_EQ(buffer_get_ring_size(), 0);
+    ASSERT_GT(file_get_number_of_pages(big_tid), 256 * 2);
+
+    //working set: every page of hot table
+    memset(value, 'H', sizeof(value));
+    for(int i=0;i<num_hot_keys;i++){
+        ASSERT_EQ(db_insert(hot_tid, i, value, sizeof(value)), 0);
+    }
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    auto read_hot_table = [&]{
+        for(int i=0;i<num_hot_keys;i++) ASSERT_EQ(db_find(hot_tid, i, ret_val, &val_size), 0);
+    };
+    auto count_hot_misses = [&]{
+        io_stats_t before, after;
+        db_get_table_stats(hot_tid, &before);
+        read_hot_table();
+        db_get_table_stats(hot_tid, &after);
+        return after.buffer_misses - before.buffer_misses;
+    };
+    read_hot_table();
+
+    //full scan switches to ring
+    std::vector<int64_t> keys;
+    auto collect = [](int64_t key, const char* value, uint16_t val_size, void* arg){
+        reinterpret_cast<std::vector<int64_t>*>(arg)->push_back(key);
+    };
+    EXPECT_EQ(db_scan(big_tid, 0, num_big_keys - 1, collect, &keys), num_big_keys);
+    EXPECT_EQ(buffer_get_ring_size(), 0);
+    EXPECT_EQ(count_hot_misses(), 0);
+
+    //point lookups of whole table in bulk mode
+    ASSERT_EQ(db_begin_bulk(8), 0);
+    for(int i=0;i<num_big_keys;i++){
+        ASSERT_EQ(db_find(big_tid, i, ret_val, &val_size), 0);
+        ASSERT_EQ(ret_val[0], 'B');
+    }
+    ASSERT_EQ(db_end_bulk(), 0);
+    EXPECT_EQ(count_hot_misses(), 0);
+
+    //same pass without bulk mode evicts working set
+    for(int i=0;i<num_big_keys;i++){
+        ASSERT_EQ(db_find(big_tid, i, ret_val, &val_size), 0);
+    }
+    EXPECT_GT(count_hot_misses(), 0);
+
+    //compaction after deleting most records
+    for(int i=0;i<num_big_keys;i++){
+        if(i % 8) ASSERT_EQ(db_delete(big_tid, i), 0);
+    }
+    read_hot_table();
+    EXPECT_GT(db_compact_table(big_tid), 0);
+    EXPECT_EQ(buffer_get_ring_size(), 0);
+    EXPECT_EQ(count_hot_misses(), 0);
+    shutdown_db();
+
+    //check after reopen
+    init_db(64);
+    big_tid = open_table(const_cast<char*>(big_path));
+    ASSERT_GE(big_tid, 0);
+    for(int i=0;i<num_big_keys;i++){
+        EXPECT_EQ(db_find(big_tid, i, ret_val, &val_size) == 0, i % 8 == 0);
+    }
+
+    //end test
+    shutdown_db();
+    remove(hot_path);
+    remove(big_path);
+}
+
+// Victim selection honors per table frame quotas
+TEST(DiskSpaceManager, BufferQuota){
+    //init test
+    const char* hot_path = "./BufferQuotaHot.db";
+    const char* big_path = "./BufferQuotaBig.db";
+    const int num_hot_keys = 500;
+    const int num_big_keys = 20000;
+    remove(hot_path);
+    remove(big_path);
+    init_db(128);
+    int64_t hot_tid = open_table(const_cast<char*>(hot_path));
+    int64_t big_tid = open_table(const_cast<char*>(big_path));
+    ASSERT_GE(hot_tid, 0);
+    ASSERT_GE(big_tid, 0);
+    EXPECT_NE(db_set_table_quota(hot_tid, -1), 0);
+    EXPECT_NE(db_set_table_quota(hot_tid, 20, 10), 0);
+
+    //max quota: big table replaces its own pages
+    ASSERT_EQ(db_set_table_quota(big_tid, 0, 16), 0);
+    char value[MIN_VALUE_SIZE];
+    memset(value, 'B', sizeof(value));
+    for(int i=0;i<num_big_keys;i++){
+        ASSERT_EQ(db_insert(big_tid, i, value, sizeof(value)), 0);
+    }
+    EXPECT_LE(db_get_table_frames(big_tid), 16);
+    memset(value, 'H', sizeof(value));
+    for(int i=0;i<num_hot_keys;i++){
+        ASSERT_EQ(db_insert(hot_tid, i, value, sizeof(value)), 0);
+    }
+
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    auto read_big_table = [&]{
+        for(int i=0;i<num_big_keys;i++) ASSERT_EQ(db_find(big_tid, i, ret_val, &val_size), 0);
+    };
+    auto count_hot_misses = [&]{
+        io_stats_t before, after;
+        db_get_table_stats(hot_tid, &before);
+        for(int i=0;i<num_hot_keys;i++) EXPECT_EQ(db_find(hot_tid, i, ret_val, &val_size), 0);
+        db_get_table_stats(hot_tid, &after);
+        return after.buffer_misses - before.buffer_misses;
+    };
+    count_hot_misses();
+    EXPECT_GT(db_get_table_frames(hot_tid), 0);
+
+    read_big_table();
+    EXPECT_LE(db_get_table_frames(big_tid), 16);
+    EXPECT_EQ(count_hot_misses(), 0);
+
+    //min quota: hot table keeps its pages against big table without limit
+    ASSERT_EQ(db_set_table_quota(big_tid, 0, 0), 0);
+    ASSERT_EQ(db_set_table_quota(hot_tid, db_get_table_frames(hot_tid)), 0);
+    read_big_table();
+    EXPECT_GT(db_get_table_frames(big_tid), 16);
+    EXPECT_EQ(count_hot_misses(), 0);
+
+    //same pass without quota evicts hot table
+    ASSERT_EQ(db_set_table_quota(hot_tid, 0), 0);
+    read_big_table();
+    EXPECT_GT(count_hot_misses(), 0);
+
+    //lowered max: big table doesn't grow any more and its pages above max are evicted first
+    ASSERT_EQ(db_set_table_quota(big_tid, 0, 16), 0);
+    count_hot_misses();
+    int big_frames = db_get_table_frames(big_tid);
+    read_big_table();
+    EXPECT_LE(db_get_table_frames(big_tid), big_frames);
+    EXPECT_EQ(count_hot_misses(), 0);
+
+    //per table hit ratio
+    io_stats_t hot_stats, big_stats;
+    ASSERT_EQ(db_get_table_stats(hot_tid, &hot_stats), 0);
+    ASSERT_EQ(db_get_table_stats(big_tid, &big_stats), 0);
+    EXPECT_GT(stats_get_hit_ratio(&hot_stats), stats_get_hit_ratio(&big_stats));
+    EXPECT_LE(stats_get_hit_ratio(&hot_stats), 1.0);
+
+    //end test
+    shutdown_db();
+    remove(hot_path);
+    remove(big_path);
+}
+
+// Evicted pages are kept compressed and misses are served from there
+TEST(DiskSpaceManager, CompressedCache){
+    //init test
+    const char* path = "./CompressedCache.db";
+    const int num_keys = 5000;
+    remove(path);
+    init_db(32);
+    buffer_set_readahead_pages(0);
+    int64_t tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+    ASSERT_EQ(db_set_compressed_cache_size(4 << 20), 0);
+
+    char value[MIN_VALUE_SIZE];
+    for(int i=0;i<num_keys;i++){
+        memset(value, 'A' + i % 26, sizeof(value));
+        ASSERT_EQ(db_insert(tid, i, value, sizeof(value)), 0);
+    }
+    size_t number_of_pages, bytes;
+    buffer_get_compressed_cache_usage(&number_of_pages, &bytes);
+    EXPECT_GT(number_of_pages, 32);
+    EXPECT_LT(bytes, number_of_pages * PAGE_SIZE / 2);
+
+    //every page is in memory (buffer or compressed cache)
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    auto check_records = [&](int step){
+        for(int i=0;i<num_keys;i++){
+            bool is_deleted = step && i % step == 0;
+            ASSERT_EQ(db_find(tid, i, ret_val, &val_size) == 0, !is_deleted);
+            if(!is_deleted) ASSERT_EQ(ret_val[0], 'A' + i % 26);
+        }
+    };
+    io_stats_t before, after;
+    db_get_table_stats(tid, &before);
+    check_records(0);
+    db_get_table_stats(tid, &after);
+    EXPECT_GT(after.buffer_misses, before.buffer_misses);
+    EXPECT_EQ(after.reads, before.reads);
+    EXPECT_EQ(after.compressed_hits - before.compressed_hits, after.buffer_misses - before.buffer_misses);
+
+    //changed, freed and moved pages aren't served stale
+    for(int i=0;i<num_keys;i+=3) ASSERT_EQ(db_delete(tid, i), 0);
+    check_records(3);
+    EXPECT_GT(db_compact_table(tid), 0);
+    check_records(3);
+
+    //shrink drops pages
+    db_set_compressed_cache_size(8 * PAGE_SIZE);
+    buffer_get_compressed_cache_usage(&number_of_pages, &bytes);
+    EXPECT_LE(bytes, 8 * PAGE_SIZE);
+    db_set_compressed_cache_size(0);
+    buffer_get_compressed_cache_usage(&number_of_pages, &bytes);
+    EXPECT_EQ(number_of_pages, 0);
+    EXPECT_EQ(bytes, 0);
+    check_records(3);
+    shutdown_db();
+
+    //check after reopen
+    init_db(32);
+    tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+    check_records(3);
+
+    //end test
+    shutdown_db();
+    remove(path);
+}
+
+// Checkpoint writes dirty pages in file order with vectored writes
+TEST(DiskSpaceManager, CheckpointFlush){
+    //init test
+    const char* paths[2] = {"./CheckpointFlush1.db", "./CheckpointFlush2.db"};
+    const int num_keys = 5000;
+    storage_latency_config_t config = {{0, 0}, {0, 0}, 0, 0, 1};
+    file_set_storage_backend(storage_get_latency_backend(storage_get_memory_backend(), &config));
+    init_db(4096);
+    int64_t tids[2];
+    char value[MIN_VALUE_SIZE];
+    for(int t=0;t<2;t++){
+        tids[t] = open_table(const_cast<char*>(paths[t]), FILE_CHECKPOINT_SYNC_FLAG);
+        ASSERT_GE(tids[t], 0);
+        memset(value, 'A' + t, sizeof(value));
+        for(int i=0;i<num_keys;i++){
+            ASSERT_EQ(db_insert(tids[t], i, value, sizeof(value)), 0);
+        }
+    }
+
+    //many dirty pages in few vectored writes (and one sync per file)
+    db_stats_t before, after;
+    storage_latency_stats_t io_before, io_after;
+    db_get_stats(&before);
+    storage_get_latency_stats(&io_before);
+    ASSERT_EQ(db_flush_all(), 0);
+    db_get_stats(&after);
+    storage_get_latency_stats(&io_after);
+    uint64_t dirty_flushes = after.total.dirty_flushes - before.total.dirty_flushes;
+    EXPECT_GT(dirty_flushes, 64);
+    EXPECT_LT(io_after.number_of_writes - io_before.number_of_writes, dirty_flushes / 4);
+
+    //nothing is left dirty
+    db_get_stats(&before);
+    ASSERT_EQ(db_flush_all(), 0);
+    db_get_stats(&after);
+    EXPECT_EQ(after.total.dirty_flushes, before.total.dirty_flushes);
+
+    //changes after checkpoint are written by the next one
+    for(int i=0;i<num_keys;i+=2) ASSERT_EQ(db_delete(tids[1], i), 0);
+    db_get_stats(&before);
+    ASSERT_EQ(db_flush_all(), 0);
+    db_get_stats(&after);
+    EXPECT_GT(after.total.dirty_flushes, before.total.dirty_flushes);
+    shutdown_db();
+
+    //check after reopen
+    init_db(64);
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    for(int t=0;t<2;t++){
+        tids[t] = open_table(const_cast<char*>(paths[t]));
+        ASSERT_GE(tids[t], 0);
+        for(int i=0;i<num_keys;i++){
+            bool is_deleted = t == 1 && i % 2 == 0;
+            ASSERT_EQ(db_find(tids[t], i, ret_val, &val_size) == 0, !is_deleted);
+            if(!is_deleted) ASSERT_EQ(ret_val[0], 'A' + t);
+        }
+    }
+
+    //end test
+    shutdown_db();
+    for(int t=0;t<2;t++) file_remove_table_file(paths[t]);
+    file_set_storage_backend(nullptr);
+}
+
+// Buffer pool works in every huge page mode
+// mode falls back when system doesn't have such huge pages
+TEST(DiskSpaceManager, HugePage){
+    //init test
+    const char* path = "./HugePage.db";
+    const int num_keys = 3000;
+    EXPECT_NE(db_set_huge_page_mode(BUFFER_HUGE_PAGE_EXPLICIT + 1), 0);
+
+    char value[MIN_VALUE_SIZE];
+    memset(value, 'H', sizeof(value));
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    for(int mode : {BUFFER_HUGE_PAGE_NONE, BUFFER_HUGE_PAGE_TRANSPARENT, BUFFER_HUGE_PAGE_EXPLICIT}){
+        remove(path);
+        ASSERT_EQ(db_set_huge_page_mode(mode), 0);
+        ASSERT_EQ(init_db(1000), 0);
+        EXPECT_LE(buffer_get_huge_page_mode(), mode);
+        //frames are still aligned for direct I/O
+        int64_t tid = open_table(const_cast<char*>(path), FILE_DIRECT_IO_FLAG);
+        ASSERT_GE(tid, 0);
+        for(int i=0;i<num_keys;i++){
+            ASSERT_EQ(db_insert(tid, i, value, sizeof(value)), 0);
+        }
+        //explicit huge pages can't grow beyond reserved ones
+        if(buffer_get_huge_page_mode() == BUFFER_HUGE_PAGE_EXPLICIT) EXPECT_NE(db_resize_buffer(1000000), 0);
+        else EXPECT_EQ(db_resize_buffer(2000), 0);
+        EXPECT_EQ(db_resize_buffer(100), 0);
+        for(int i=0;i<num_keys;i++){
+            ASSERT_EQ(db_find(tid, i, ret_val, &val_size), 0);
+        }
+        shutdown_db();
+    }
+
+    //end test
+    db_set_huge_page_mode(BUFFER_HUGE_PAGE_NONE);
+    remove(path);
+}
+
+// Threads waiting for page latch sleep on futex and are woken by unlock
+TEST(DiskSpaceManager, PageLatchWait){
+    //init test
+    const char* path = "./PageLatchWait.db";
+    const int num_waiters = 4;
+    remove(path);
+    init_db(16);
+    static int64_t tid;
+    tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+    static pagenum_t pagenum;
+    pagenum = file_get_number_of_pages(tid) - 1;
+
+    //hold page latch exclusively
+    page_t page;
+    buffer_read_page(tid, pagenum, &page, BUFFER_WRITE_LOCK_MODE);
+    std::atomic<uint32_t>* latch = nullptr;
+    for(int i=0;i<buffer_get_size();i++){
+        BM::ctrl_blk* blk = &BM::ctrl_blk_list[i];
+        if(blk->table_id == file_get_space_id(tid) && blk->pagenum == pagenum) latch = &blk->latch;
+    }
+    ASSERT_NE(latch, nullptr);
+    EXPECT_TRUE(latch->load() & LATCH_EXCLUSIVE);
+
+    //readers spin a while and then sleep on latch word
+    static std::atomic<int> number_of_reads;
+    static uint8_t read_bytes[num_waiters];
+    number_of_reads = 0;
+    std::vector<std::thread> waiters;
+    for(int t=0;t<num_waiters;t++){
+        waiters.emplace_back([t]{
+            page_t page;
+            buffer_read_page(tid, pagenum, &page, BUFFER_NO_LOCK_MODE);
+            read_bytes[t] = page.raw_data[PAGE_SIZE - 1];
+            number_of_reads++;
+        });
+    }
+    usleep(100 * 1000);
+    EXPECT_EQ(number_of_reads, 0);
+    EXPECT_TRUE(latch->load() & LATCH_WAITERS);
+
+    //unlock wakes every sleeping reader, and they see the change
+    page.raw_data[PAGE_SIZE - 1] = 'L';
+    buffer_write_page(tid, pagenum, &page);
+    for(auto& th : waiters) th.join();
+    EXPECT_EQ(number_of_reads, num_waiters);
+    for(int t=0;t<num_waiters;t++){
+        EXPECT_EQ(read_bytes[t], 'L');
+    }
+    EXPECT_EQ(latch->load(), 0);
+
+    //end test
+    shutdown_db();
+    remove(path);
+}
+
+// Lock-free hits and evictions of the same page race without torn or wrong reads
+TEST(DiskSpaceManager, BufferHitEvict){
+    //init test
+    const char* path = "./BufferHitEvict.db";
+    const int num_buf = 16;
+    const int num_rounds = 20;
+    remove(path);
+    init_db(num_buf);
+    static int64_t tid;
+    tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+
+    //every page has its own content
+    static pagenum_t number_of_pages;
+    number_of_pages = std::min<pagenum_t>(file_get_number_of_pages(tid), num_buf * 8);
+    page_t page;
+    for(pagenum_t p=1;p<number_of_pages;p++){
+        buffer_read_page(tid, p, &page, BUFFER_WRITE_LOCK_MODE);
+        memset(page.raw_data + sizeof(pagenum_t), (int)(p % 251), PAGE_SIZE - sizeof(pagenum_t));
+        buffer_write_page(tid, p, &page);
+    }
+
+    //hitters read few hot pages while evictors sweep the file through small buffer
+    //so hot pages are evicted and read again under the hitters
+    static std::atomic<int> number_of_bad_reads;
+    static std::atomic<bool> is_done;
+    number_of_bad_reads = 0;
+    is_done = false;
+    auto check_page = [](pagenum_t p){
+        page_t page;
+        buffer_read_page(tid, p, &page, BUFFER_NO_LOCK_MODE);
+        for(size_t i=sizeof(pagenum_t);i<PAGE_SIZE;i++){
+            if(page.raw_data[i] != p % 251){
+                number_of_bad_reads++;
+                return;
+            }
+        }
+    };
+    std::vector<std::thread> hitters, evictors;
+    for(int t=0;t<4;t++){
+        hitters.emplace_back([t, check_page]{
+            for(uint64_t i=0;!is_done;i++) check_page(1 + (i + t) % 4);
+        });
+    }
+    for(int t=0;t<2;t++){
+        evictors.emplace_back([num_rounds, check_page]{
+            for(int r=0;r<num_rounds;r++){
+                for(pagenum_t p=1;p<number_of_pages;p++) check_page(p);
+            }
+        });
+    }
+    for(auto& th : evictors) th.join();
+    is_done = true;
+    for(auto& th : hitters) th.join();
+    EXPECT_EQ(number_of_bad_reads, 0);
+
+    //end test
+    shutdown_db();
+    remove(path);
+}
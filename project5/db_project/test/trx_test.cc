@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <random>
 #include <pthread.h>
+#include <atomic>
 
 void* txn_func(void *arg){
     void **argv = (void**)arg;
@@ -446,4 +447,329 @@ TEST(TransactionManager, RANDOM_MULTI_THREAD_TEST){
     shutdown_db();
     remove(path);
     delete[] path;
-}
\ No newline at end of file
+}
+TEST(TransactionManager, PARTITIONED_LOCK_TABLE_TEST){
+    const int num = 4000; //number of record
+    const int thread_number = 8;
+    const char* path = "./PLT_test.db";
+
+    remove(path);
+    init_db();
+    static int64_t tid;
+    tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+    char value[MIN_VALUE_SIZE + 1] = {};
+    memset(value, 'A', MIN_VALUE_SIZE);
+    for(int i=0; i<num; i++) ASSERT_EQ(db_insert(tid, i, value, MIN_VALUE_SIZE), 0);
+
+    //first and last key are in different leaf pages (so in different partitions mostly)
+    //trx 1 waits for trx 2 in one partition and trx 2 makes cycle in the other
+    static int trx1, trx2;
+    trx1 = trx_begin();
+    trx2 = trx_begin();
+    uint16_t old_size;
+    memset(value, 'B', MIN_VALUE_SIZE);
+    ASSERT_EQ(db_update(tid, 0, value, MIN_VALUE_SIZE, &old_size, trx1), 0);
+    memset(value, 'C', MIN_VALUE_SIZE);
+    ASSERT_EQ(db_update(tid, num - 1, value, MIN_VALUE_SIZE, &old_size, trx2), 0);
+
+    pthread_t waiter;
+    pthread_create(&waiter, 0, [](void*) -> void*{
+        char value[MIN_VALUE_SIZE];
+        uint16_t old_size;
+        memset(value, 'B', MIN_VALUE_SIZE);
+        //sleeps until trx 2 is aborted
+        EXPECT_EQ(db_update(tid, num - 1, value, MIN_VALUE_SIZE, &old_size, trx1), 0);
+        EXPECT_EQ(trx_commit(trx1), trx1);
+        return nullptr;
+    }, nullptr);
+    usleep(100 * 1000);
+    //deadlock is found across partitions and trx 2 is aborted
+    EXPECT_NE(db_update(tid, 0, value, MIN_VALUE_SIZE, &old_size, trx2), 0);
+    pthread_join(waiter, nullptr);
+
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    for(int64_t key : {(int64_t)0, (int64_t)num - 1}){
+        ASSERT_EQ(db_find(tid, key, ret_val, &val_size), 0);
+        EXPECT_EQ(ret_val[0], 'B');
+        EXPECT_EQ(ret_val[MIN_VALUE_SIZE - 1], 'B');
+    }
+
+    //disjoint keys updated from many threads at once, many lock lists in many partitions
+    pthread_t threads[thread_number];
+    for(int t=0; t<thread_number; t++){
+        pthread_create(&threads[t], 0, [](void* arg) -> void*{
+            int64_t begin = (int64_t)arg * (num / thread_number);
+            char value[MIN_VALUE_SIZE];
+            uint16_t old_size;
+            memset(value, 'a' + (int)(int64_t)arg, MIN_VALUE_SIZE);
+            for(int64_t key = begin; key < begin + num / thread_number; key += 10){
+                int trx_id = trx_begin();
+                for(int64_t i = key; i < key + 10; i++){
+                    EXPECT_EQ(db_update(tid, i, value, MIN_VALUE_SIZE, &old_size, trx_id), 0);
+                }
+                EXPECT_EQ(trx_commit(trx_id), trx_id);
+            }
+            return nullptr;
+        }, (void*)(int64_t)t);
+    }
+    for(int t=0; t<thread_number; t++) pthread_join(threads[t], nullptr);
+
+    for(int i=0; i<num; i++){
+        ASSERT_EQ(db_find(tid, i, ret_val, &val_size), 0);
+        EXPECT_EQ(ret_val[0], 'a' + i / (num / thread_number));
+    }
+
+    shutdown_db();
+    remove(path);
+}
+
+TEST(TransactionManager, LOCK_OBJECT_POOL_TEST){
+    const int num = 100; //number of record
+    const char* path = "./LOP_test.db";
+
+    remove(path);
+    init_db();
+    int64_t tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+    char value[MIN_VALUE_SIZE];
+    memset(value, 'A', MIN_VALUE_SIZE);
+    for(int i=0; i<num; i++) ASSERT_EQ(db_insert(tid, i, value, MIN_VALUE_SIZE), 0);
+
+    //lock objects of committed trx are recycled instead of new allocation
+    uint16_t old_size;
+    for(int t=0; t<200; t++){
+        int trx_id = trx_begin();
+        for(int i=0; i<10; i++) ASSERT_EQ(db_update(tid, (t + i) % num, value, MIN_VALUE_SIZE, &old_size, trx_id), 0);
+        ASSERT_EQ(trx_commit(trx_id), trx_id);
+    }
+    uint64_t lock_objects, slabs;
+    lock_get_pool_stats(&lock_objects, &slabs);
+    EXPECT_EQ(lock_objects, 2000);
+    //one slab in partition of each leaf page (few pages) is enough
+    EXPECT_LE(slabs, 4);
+
+    shutdown_db();
+    lock_get_pool_stats(&lock_objects, &slabs);
+    EXPECT_EQ(slabs, 0);
+    remove(path);
+}
+
+TEST(TransactionManager, RECORD_QUEUE_TEST){
+    const char* path = "./RQT_test.db";
+
+    remove(path);
+    init_db();
+    static int64_t tid;
+    tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+    char value[MIN_VALUE_SIZE];
+    memset(value, 'A', MIN_VALUE_SIZE);
+    for(int i=0; i<10; i++) ASSERT_EQ(db_insert(tid, i, value, MIN_VALUE_SIZE), 0);
+
+    //trx 1 reads records 0-2 of the page (S locks compressed into one object)
+    static int trx1, trx2;
+    trx1 = trx_begin();
+    trx2 = trx_begin();
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    for(int i=0; i<3; i++) ASSERT_EQ(db_find(tid, i, ret_val, &val_size, trx1), 0);
+
+    //other record of the same page doesn't wait
+    uint16_t old_size;
+    memset(value, 'B', MIN_VALUE_SIZE);
+    ASSERT_EQ(db_update(tid, 5, value, MIN_VALUE_SIZE, &old_size, trx2), 0);
+
+    //record covered by compressed S lock waits until trx 1 commits
+    static std::atomic<bool> is_updated;
+    is_updated = false;
+    pthread_t waiter;
+    pthread_create(&waiter, 0, [](void*) -> void*{
+        char value[MIN_VALUE_SIZE];
+        uint16_t old_size;
+        memset(value, 'B', MIN_VALUE_SIZE);
+        EXPECT_EQ(db_update(tid, 2, value, MIN_VALUE_SIZE, &old_size, trx2), 0);
+        is_updated = true;
+        EXPECT_EQ(trx_commit(trx2), trx2);
+        return nullptr;
+    }, nullptr);
+    usleep(100 * 1000);
+    EXPECT_FALSE(is_updated);
+    ASSERT_EQ(db_find(tid, 1, ret_val, &val_size, trx1), 0);
+    EXPECT_EQ(trx_commit(trx1), trx1);
+    pthread_join(waiter, nullptr);
+    EXPECT_TRUE(is_updated);
+
+    for(int key : {2, 5}){
+        ASSERT_EQ(db_find(tid, key, ret_val, &val_size), 0);
+        EXPECT_EQ(ret_val[0], 'B');
+    }
+
+    shutdown_db();
+    remove(path);
+}
+
+TEST(TransactionManager, TREE_LATCH_TEST){
+    const char* path = "./TLT_test.db";
+
+    remove(path);
+    init_db();
+    static int64_t tid;
+    tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+    char value[MIN_VALUE_SIZE];
+    memset(value, 'A', MIN_VALUE_SIZE);
+    for(int i=0; i<10; i++) ASSERT_EQ(db_insert(tid, i, value, MIN_VALUE_SIZE), 0);
+
+    //trx 1 holds X lock of record 0 and trx 2 waits for it
+    static int trx1, trx2;
+    trx1 = trx_begin();
+    trx2 = trx_begin();
+    uint16_t old_size;
+    memset(value, 'B', MIN_VALUE_SIZE);
+    ASSERT_EQ(db_update(tid, 0, value, MIN_VALUE_SIZE, &old_size, trx1), 0);
+
+    static std::atomic<bool> is_updated, is_inserted;
+    is_updated = is_inserted = false;
+    pthread_t waiter, inserter;
+    pthread_create(&waiter, 0, [](void*) -> void*{
+        char value[MIN_VALUE_SIZE];
+        uint16_t old_size;
+        memset(value, 'C', MIN_VALUE_SIZE);
+        EXPECT_EQ(db_update(tid, 0, value, MIN_VALUE_SIZE, &old_size, trx2), 0);
+        is_updated = true;
+        EXPECT_EQ(trx_commit(trx2), trx2);
+        return nullptr;
+    }, nullptr);
+    usleep(100 * 1000);
+
+    //lock wait doesn't hold tree latch, so insert into the same table goes on
+    //key inserted before waited record moves it to next slot, waiter finds it again
+    pthread_create(&inserter, 0, [](void*) -> void*{
+        char value[MIN_VALUE_SIZE];
+        memset(value, 'D', MIN_VALUE_SIZE);
+        EXPECT_EQ(db_insert(tid, 100, value, MIN_VALUE_SIZE), 0);
+        EXPECT_EQ(db_insert(tid, -1, value, MIN_VALUE_SIZE), 0);
+        is_inserted = true;
+        return nullptr;
+    }, nullptr);
+    usleep(100 * 1000);
+    EXPECT_TRUE(is_inserted);
+    EXPECT_FALSE(is_updated);
+
+    EXPECT_EQ(trx_commit(trx1), trx1);
+    pthread_join(waiter, nullptr);
+    pthread_join(inserter, nullptr);
+    EXPECT_TRUE(is_updated);
+
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    ASSERT_EQ(db_find(tid, 0, ret_val, &val_size), 0);
+    EXPECT_EQ(ret_val[0], 'C');
+    for(int key : {-1, 100}){
+        ASSERT_EQ(db_find(tid, key, ret_val, &val_size), 0);
+        EXPECT_EQ(ret_val[0], 'D');
+    }
+
+    //same for shared lock wait (trx 4 waits for trx 3's X lock of record 0)
+    static int trx3, trx4;
+    static std::atomic<bool> is_found;
+    trx3 = trx_begin();
+    trx4 = trx_begin();
+    is_found = false;
+    memset(value, 'E', MIN_VALUE_SIZE);
+    ASSERT_EQ(db_update(tid, 0, value, MIN_VALUE_SIZE, &old_size, trx3), 0);
+    pthread_create(&waiter, 0, [](void*) -> void*{
+        char ret_val[MAX_VALUE_SIZE];
+        uint16_t val_size;
+        EXPECT_EQ(db_find(tid, 0, ret_val, &val_size, trx4), 0);
+        EXPECT_EQ(ret_val[0], 'E');
+        is_found = true;
+        EXPECT_EQ(trx_commit(trx4), trx4);
+        return nullptr;
+    }, nullptr);
+    usleep(100 * 1000);
+    memset(value, 'D', MIN_VALUE_SIZE);
+    ASSERT_EQ(db_insert(tid, -2, value, MIN_VALUE_SIZE), 0);
+    usleep(100 * 1000);
+    EXPECT_FALSE(is_found);
+    EXPECT_EQ(trx_commit(trx3), trx3);
+    pthread_join(waiter, nullptr);
+    EXPECT_TRUE(is_found);
+
+    shutdown_db();
+    remove(path);
+}
+
+TEST(TransactionManager, WAIT_SLOT_TEST){
+    const char* path = "./WST_test.db";
+
+    remove(path);
+    init_db();
+    static int64_t tid;
+    tid = open_table(const_cast<char*>(path));
+    ASSERT_GE(tid, 0);
+    char value[MIN_VALUE_SIZE];
+    memset(value, 'A', MIN_VALUE_SIZE);
+    for(int i=0; i<10; i++) ASSERT_EQ(db_insert(tid, i, value, MIN_VALUE_SIZE), 0);
+
+    //trx 1 and 2 hold S locks of record 0
+    static int trx1, trx2, trx3, trx4;
+    trx1 = trx_begin();
+    trx2 = trx_begin();
+    trx3 = trx_begin();
+    trx4 = trx_begin();
+    char ret_val[MAX_VALUE_SIZE];
+    uint16_t val_size;
+    ASSERT_EQ(db_find(tid, 0, ret_val, &val_size, trx1), 0);
+    ASSERT_EQ(db_find(tid, 0, ret_val, &val_size, trx2), 0);
+
+    //trx 3 waits for both S locks, trx 4 waits for trx 3's X lock
+    static std::atomic<int> number_of_updates;
+    number_of_updates = 0;
+    pthread_t waiter3, waiter4;
+    pthread_create(&waiter3, 0, [](void*) -> void*{
+        char value[MIN_VALUE_SIZE];
+        uint16_t old_size;
+        memset(value, 'C', MIN_VALUE_SIZE);
+        EXPECT_EQ(db_update(tid, 0, value, MIN_VALUE_SIZE, &old_size, trx3), 0);
+        number_of_updates++;
+        return nullptr;
+    }, nullptr);
+    usleep(100 * 1000);
+    pthread_create(&waiter4, 0, [](void*) -> void*{
+        char value[MIN_VALUE_SIZE];
+        uint16_t old_size;
+        memset(value, 'D', MIN_VALUE_SIZE);
+        EXPECT_EQ(db_update(tid, 0, value, MIN_VALUE_SIZE, &old_size, trx4), 0);
+        number_of_updates++;
+        EXPECT_EQ(trx_commit(trx4), trx4);
+        return nullptr;
+    }, nullptr);
+    usleep(100 * 1000);
+    EXPECT_EQ(number_of_updates, 0);
+
+    //release of one S lock leaves trx 3 parked (the other still conflicts)
+    EXPECT_EQ(trx_commit(trx1), trx1);
+    usleep(100 * 1000);
+    EXPECT_EQ(number_of_updates, 0);
+
+    //last conflicting release wakes trx 3 only
+    EXPECT_EQ(trx_commit(trx2), trx2);
+    pthread_join(waiter3, nullptr);
+    EXPECT_EQ(number_of_updates, 1);
+    usleep(100 * 1000);
+    EXPECT_EQ(number_of_updates, 1);
+
+    //trx 3's commit wakes trx 4
+    EXPECT_EQ(trx_commit(trx3), trx3);
+    pthread_join(waiter4, nullptr);
+    EXPECT_EQ(number_of_updates, 2);
+
+    ASSERT_EQ(db_find(tid, 0, ret_val, &val_size), 0);
+    EXPECT_EQ(ret_val[0], 'D');
+
+    shutdown_db();
+    remove(path);
+}